@@ -25,6 +25,7 @@
 
 # include <string>
 # include <map>
+# include <vector>
 
 # include <srdfdom/model.h>
 # include <hpp/model/humanoid-robot.hh>
@@ -52,6 +53,51 @@ namespace hpp
 	typedef urdf::Parser::BodyType BodyType;
 	typedef urdf::Parser::RobotPtrType RobotPtrType;
 
+	/// \brief Order in which collision pairs are added to the robot.
+	///
+	/// Collision tests stop at the first pair in collision, so that
+	/// testing likely or cheap pairs first makes them end sooner on
+	/// average.
+	enum PairOrder {
+	  /// Order of the joints in the joint vector, the default.
+	  JOINT_ORDER,
+	  /// Increasing estimated cost of a test.
+	  CHEAPEST_FIRST,
+	  /// Increasing clearance between bounding spheres, so that pairs
+	  /// most likely to collide are tested first.
+	  CLOSEST_FIRST
+	};
+
+	/// \brief Estimated cost of testing a pair of bodies for collision.
+	///
+	/// Estimates are computed from the collision objects of the bodies,
+	/// at the current configuration of the robot when the pairs are
+	/// added, or when pairCosts is first called if pairs follow the
+	/// joint order. Forward kinematics is computed at this
+	/// configuration first.
+	struct PairCost
+	{
+	  JointPtr_t joint1, joint2;
+	  /// Number of triangles of the collision objects of both bodies.
+	  std::size_t triangles;
+	  /// Sum of the depths of the deepest bounding volume hierarchy of
+	  /// each body, 0 for bodies made of primitives.
+	  std::size_t depth;
+	  /// Number of collision objects that are primitives rather than
+	  /// meshes.
+	  std::size_t primitives;
+	  /// Number of bounding volume tests needed to separate the
+	  /// bodies when they are apart: the sum, over the pairs of
+	  /// objects, of the depths of both objects, primitives counting
+	  /// for one.
+	  double cost;
+	  /// Smallest distance between the bounding spheres of an object
+	  /// of each body, negative if they overlap. Infinite if a body
+	  /// has no collision object.
+	  double clearance;
+	};
+	typedef std::vector <PairCost> PairCosts_t;
+
 	/// \brief Default constructor.
 	explicit Parser ();
 	/// \brief Destructor.
@@ -88,13 +134,92 @@ namespace hpp
 				 const std::string& srdfParameterName,
 				 RobotPtrType robot);
 
+	/// Parse URDF and SRDF robot descriptions held in memory
+	/// \param robotDescription content of the URDF file,
+	/// \param semanticDescription content of the SRDF file,
+	/// \param robot the robot being constructed.
+	void parseString (const std::string& robotDescription,
+			  const std::string& semanticDescription,
+			  RobotPtrType robot);
+
+	/// Parse URDF and SRDF robot descriptions without modifying the robot
+	///
+	/// The robot is modified by processSemanticDescription, so that
+	/// descriptions can be parsed while the robot is being built.
+	/// \param robotDescription content of the URDF file,
+	/// \param semanticDescription content of the SRDF file,
+	/// \param robot the robot being constructed.
+	void parseDescription (const std::string& robotDescription,
+			       const std::string& semanticDescription,
+			       RobotPtrType robot);
+
+	/// \brief Update collision pairs from a modified SRDF file.
+	///
+	/// The disabled collision pairs are compared to those previously
+	/// loaded by this parser for the same robot. Pairs that are not
+	/// disabled anymore are added, newly disabled pairs are removed.
+	/// Pairs of the robot and pairCosts keep the order set by
+	/// pairOrder. Collision geometries updated in place by
+	/// urdf::Parser::update keep their pairs.
+	///
+	/// \param robotResourceName URDF resource name
+	/// \param semanticResourceName SRDF resource name
+	void update (const std::string& robotResourceName,
+		     const std::string& semanticResourceName);
+
 	/// \brief Process information parsed from a file or a parameter
 	void processSemanticDescription ();
 
+	/// \brief Number of pairs not added by the last parse or update
+	/// because one of the bodies has no collision object.
+	///
+	/// \param type COLLISION or DISTANCE, pairs being filtered for each
+	///        request on the inner objects of the bodies for this request.
+	std::size_t emptyPairs (Request_t type) const;
+
+	/// \brief Set order in which the next parse adds collision pairs.
+	void pairOrder (PairOrder order);
+
+	/// \brief Get order in which collision pairs are added.
+	PairOrder pairOrder () const;
+
+	/// \brief Estimated costs of the pairs considered by the last parse
+	/// and the following updates, in the order they were added to the
+	/// robot.
+	///
+	/// Pairs that were not added because a body has no collision object
+	/// are included.
+	const PairCosts_t& pairCosts () const;
+
       protected:
 	/// \brief Add collision pairs to robot.
+	///
+	/// Only bodies with collision objects are paired. Pairs are added
+	/// in the order set by pairOrder.
 	void addCollisionPairs ();
 
+	/// \brief Add pair of joints for each request for which both bodies
+	/// have inner objects.
+	void addCollisionPair (const JointPtr_t& joint1,
+			       const JointPtr_t& joint2);
+
+	/// \brief Estimate costs of pairs.
+	///
+	/// \note Clearances use the current positions of the collision
+	///       objects, forward kinematics must be up to date.
+	///
+	/// \param pairs pairs whose joints are set, other fields are
+	///        computed.
+	void estimatePairCosts (PairCosts_t& pairs) const;
+
+	/// \brief Sort pairs by pairOrder.
+	///
+	/// Sorting is stable, pairs with the same estimates keep their
+	/// order.
+	/// \pre costs of pairs are estimated, unless pairOrder is
+	///      JOINT_ORDER.
+	void sortPairCosts (PairCosts_t& pairs) const;
+
 	/// \brief Check if given body pair is disabled.
 	bool isCollisionPairDisabled (const std::string& bodyName_1,
 				      const std::string& bodyName_2);
@@ -108,6 +233,13 @@ namespace hpp
 	::urdf::Model urdfModel_;
 	::srdf::Model srdfModel_;
 	RobotPtrType robot_;
+	std::size_t emptyCollisionPairs_;
+	std::size_t emptyDistancePairs_;
+	PairOrder pairOrder_;
+	/// Estimated lazily by pairCosts for JOINT_ORDER.
+	mutable PairCosts_t pairCosts_;
+	/// Whether costs of pairCosts_ are estimated.
+	mutable bool costsEstimated_;
 
       }; // class Parser
 
@@ -0,0 +1,156 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hpp-model-urdf.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/// \brief Declaration of GeometryLoader.
+
+#ifndef HPP_MODEL_URDF_GEOMETRY_LOADER
+# define HPP_MODEL_URDF_GEOMETRY_LOADER
+
+# include <map>
+# include <set>
+# include <string>
+
+# include <boost/function.hpp>
+# include <boost/thread/condition_variable.hpp>
+# include <boost/thread/future.hpp>
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/thread.hpp>
+
+# include <hpp/model/urdf/parser.hh>
+# include <hpp/model/srdf/parser.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      class GeometryLoader;
+      typedef boost::shared_ptr <GeometryLoader> GeometryLoaderPtr_t;
+
+      /// \brief Collision geometries of a robot loaded after its
+      /// kinematic tree.
+      ///
+      /// Mesh import and bounding volume hierarchy construction run in a
+      /// background thread, or on demand body by body. The robot itself
+      /// is only modified by wait and load, in the thread calling them,
+      /// so that kinematic queries may run on the robot meanwhile.
+      class GeometryLoader
+      {
+      public:
+	typedef boost::function <void ()> Callback_t;
+
+	/// Create loader and parse kinematic tree of robot
+	///
+	/// \param robot Empty robot created before calling the function.
+	/// \param rootJointType type of root joint among "anchor",
+	///        "freeflyer", "planar",
+	/// \param urdfPath, srdfPath resource names of the robot
+	///        description,
+	/// \param background whether to build geometries in a background
+	///        thread. Otherwise geometries are only built by load and
+	///        wait.
+	/// \param callback called by the background thread once all
+	///        geometries are built. Geometries are not attached to the
+	///        robot yet, see wait. The callback must not call wait.
+	static GeometryLoaderPtr_t create (const DevicePtr_t& robot,
+					   const std::string& rootJointType,
+					   const std::string& urdfPath,
+					   const std::string& srdfPath,
+					   bool background = true,
+					   const Callback_t& callback =
+					   Callback_t ());
+
+	/// Stop background thread
+	~GeometryLoader ();
+
+	/// Future that becomes ready when all geometries are built
+	///
+	/// Exceptions raised while building geometries are stored in
+	/// the future, by load and wait if there is no background thread.
+	/// \note Geometries built are not attached to the robot, and
+	///       collision pairs are only added by wait.
+	boost::shared_future <void> built () const
+	{
+	  return future_;
+	}
+
+	/// Whether all geometries are built
+	///
+	/// \note Built geometries are attached to the robot by load or
+	///       wait, collision pairs only by wait.
+	bool ready () const;
+
+	/// Add collision geometry of a body to the robot
+	///
+	/// The geometry is built immediately if the background thread has
+	/// not done it yet.
+	/// \param jointName name of the joint holding the body.
+	void load (const std::string& jointName);
+
+	/// Add all collision geometries to the robot and register
+	/// collision pairs
+	///
+	/// Blocks until the background thread is done.
+	/// \throw the exception raised while building geometries if any.
+	/// \throw std::runtime_error if called by the callback given to
+	///        create, which runs in the background thread.
+	void wait ();
+
+      private:
+	typedef Parser::UrdfLinkConstPtrType UrdfLinkConstPtrType;
+	typedef std::map <std::string, UrdfLinkConstPtrType> Links_t;
+	typedef std::pair <UrdfLinkConstPtrType,
+			   Parser::CollisionGeometries_t> Geometry_t;
+	typedef std::map <std::string, Geometry_t> Geometries_t;
+
+	GeometryLoader (const DevicePtr_t& robot,
+			const std::string& rootJointType,
+			const std::string& urdfPath,
+			const std::string& srdfPath);
+
+	/// Body of the background thread.
+	void build (Callback_t callback);
+
+	void attach (const std::string& jointName, const Geometry_t& geometry);
+
+	DevicePtr_t robot_;
+	Parser urdfParser_;
+	srdf::Parser srdfParser_;
+	std::string urdfPath_;
+	std::string srdfPath_;
+
+	/// Links whose geometry is not built yet, by joint name.
+	Links_t pending_;
+	/// Geometries being built.
+	std::set <std::string> building_;
+	/// Geometries built but not added to the robot.
+	Geometries_t built_;
+	mutable boost::mutex mutex_;
+	boost::condition_variable condition_;
+
+	boost::promise <void> promise_;
+	boost::shared_future <void> future_;
+	boost::thread thread_;
+	bool done_;
+      }; // class GeometryLoader
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_GEOMETRY_LOADER
@@ -0,0 +1,120 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hpp-model-urdf.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/// \brief Memory used by the collision geometries of a robot.
+
+#ifndef HPP_MODEL_URDF_MEMORY_FOOTPRINT
+# define HPP_MODEL_URDF_MEMORY_FOOTPRINT
+
+# include <iosfwd>
+# include <string>
+# include <vector>
+
+# include <hpp/model/fwd.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Memory used by the geometry of a collision object.
+      struct GeometryFootprint
+      {
+	/// Name of the collision object.
+	std::string name;
+	/// Name of the body holding the collision object.
+	std::string body;
+	/// Number of vertices, triangles and bounding volumes, 0 for
+	/// primitive shapes.
+	std::size_t vertices, triangles, boundingVolumes;
+	/// Bytes used by vertices, triangles, bounding volume hierarchy
+	/// (nodes and primitive indices) and geometry object itself.
+	std::size_t vertexBytes, triangleBytes, bvhBytes, objectBytes;
+	/// Whether the geometry is shared with a collision object listed
+	/// before. Bytes are then only counted once in totals.
+	bool shared;
+	/// Whether vertices and triangles are read from a shared memory
+	/// segment, see Parser::sharedMeshStore. Their bytes are then
+	/// counted in sharedMeshBytes rather than in vertexBytes and
+	/// triangleBytes.
+	bool sharedMesh;
+	std::size_t sharedMeshBytes;
+
+	GeometryFootprint ();
+
+	/// Sum of bytes owned by the process, shared meshes excluded.
+	std::size_t bytes () const;
+      }; // struct GeometryFootprint
+
+      /// \brief Memory used by the collision geometries of a body.
+      struct BodyFootprint
+      {
+	std::string name;
+	std::size_t objects;
+	/// Bytes of the geometries that are not shared.
+	std::size_t bytes;
+
+	BodyFootprint ();
+      }; // struct BodyFootprint
+
+      /// \brief Memory used by the collision geometries of a robot.
+      struct MemoryFootprint
+      {
+	/// One entry per collision object, in order of joints.
+	std::vector <GeometryFootprint> geometries;
+	/// One entry per body.
+	std::vector <BodyFootprint> bodies;
+	/// Number of collision and distance pairs.
+	std::size_t collisionPairs, distancePairs;
+	/// Bytes used by collision and distance pair lists.
+	std::size_t pairBytes;
+	/// Totals over geometries, counting shared geometries once.
+	/// Vertices and triangles of shared meshes are not included.
+	std::size_t vertices, triangles, boundingVolumes;
+	std::size_t geometryBytes;
+	/// Totals over meshes read from a shared memory segment, counting
+	/// each mesh once. They are not included in bytes.
+	std::size_t sharedVertices, sharedTriangles, sharedMeshBytes;
+
+	MemoryFootprint ();
+
+	/// Total bytes used by geometries and pairs.
+	std::size_t bytes () const;
+
+	/// Geometries using the most memory, in decreasing order
+	///
+	/// \param n maximal number of geometries returned.
+	std::vector <GeometryFootprint> largest (std::size_t n) const;
+      }; // struct MemoryFootprint
+
+      /// \brief Compute memory used by the collision geometries of a robot.
+      ///
+      /// Walks the bodies of the robot, their collision objects, fcl
+      /// geometries and the collision and distance pairs. Sizes are those
+      /// of the stored arrays and objects, allocator overhead is ignored.
+      MemoryFootprint memoryFootprint (const DevicePtr_t& robot);
+
+      /// \brief Print totals, bodies and the 10 largest geometries.
+      std::ostream& operator<< (std::ostream& os,
+				const MemoryFootprint& footprint);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_MEMORY_FOOTPRINT
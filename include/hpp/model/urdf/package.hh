@@ -0,0 +1,71 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hpp-model-urdf.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/// \brief Resolution of package:// resources.
+
+#ifndef HPP_MODEL_URDF_PACKAGE
+# define HPP_MODEL_URDF_PACKAGE
+
+# include <map>
+# include <string>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// Map from package names to their location in the file system.
+      typedef std::map <std::string, std::string> PackagePaths_t;
+
+      /// Get location of a ros package
+      ///
+      /// The package is looked up in ROS_PACKAGE_PATH the first time it
+      /// is requested. The result is cached for the life of the process.
+      /// \param package name of the package,
+      /// \return path of the package, empty string if the package is not
+      ///         found.
+      /// \note This function is thread safe.
+      std::string packagePath (const std::string& package);
+
+      /// Set location of packages
+      ///
+      /// Packages in the map are never looked up in ROS_PACKAGE_PATH.
+      /// Other packages are still resolved as in packagePath.
+      /// \param paths map from package names to their location, replaces
+      ///        the map set by a previous call. An empty map removes all
+      ///        overrides.
+      void setPackagePaths (const PackagePaths_t& paths);
+
+      /// Forget cached package locations
+      ///
+      /// Call this function after modifying ROS_PACKAGE_PATH or installing
+      /// packages. Locations set by setPackagePaths are kept.
+      void clearPackagePathCache ();
+
+      /// Convert a package:// resource name into a file:// one
+      ///
+      /// \param uri resource name using the resource_retriever format.
+      /// \return uri unchanged if it does not use the package:// scheme or
+      ///         if the package is not found.
+      std::string resolvePackageUri (const std::string& uri);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_PACKAGE
@@ -27,17 +27,25 @@
 # include <string>
 # include <map>
 
+# include <boost/thread/mutex.hpp>
+
 # include <urdf/model.h>
 
 # include <hpp/fcl/BV/OBBRSS.h>
 # include <hpp/fcl/BVH/BVH_model.h>
+# include <hpp/fcl/collision_object.h>
+
+# include <hpp/util/pointer.hh>
 
 # include <hpp/model/body.hh>
 # include <hpp/model/humanoid-robot.hh>
 # include <hpp/model/object-factory.hh>
+# include <hpp/model/urdf/resource-resolver.hh>
+# include <hpp/model/urdf/topology.hh>
 
-class aiNode;
-class aiScene;
+namespace fcl {
+  HPP_PREDEF_CLASS (CollisionGeometry);
+}
 
 namespace hpp
 {
@@ -45,8 +53,27 @@ namespace hpp
   {
     namespace urdf
     {
+      class GeometryLoader;
+      struct MeshBuffers;
+      class MeshArena;
+      class ResourcePrefetcher;
+      class SharedMeshStore;
+
       /// \brief Parse an URDF file and return a
       /// hpp::model::HumanoidRobotPtr_t.
+      ///
+      /// A parser holds the state of the loads of one robot. Concurrency
+      /// guarantees are the following:
+      /// \li parsers share no mutable state, so that robots can be
+      ///     loaded by separate parsers in separate threads without
+      ///     locking. Package locations are cached in a thread safe way
+      ///     and the assimp logger, created in debug mode, is created
+      ///     once per process.
+      /// \li mesh import and bounding volume hierarchy construction use
+      ///     buffers local to each call, so that collision geometries
+      ///     of one parser can be built in several threads, as done by
+      ///     GeometryLoader.
+      /// \li other methods of a parser must not be called concurrently.
       class Parser
       {
       public:
@@ -59,8 +86,12 @@ namespace hpp
 	typedef DevicePtr_t RobotPtrType;
 	typedef Joint JointType;
 	typedef Body BodyType;
+	/// Polyhedron type with default bounding volume, see boundingVolume.
 	typedef fcl::BVHModel< fcl::OBBRSS > PolyhedronType;
 	typedef boost::shared_ptr <PolyhedronType> PolyhedronPtrType;
+	/// Geometries of a collision element, several for split meshes.
+	typedef std::vector <fcl::CollisionGeometryPtr_t>
+	CollisionGeometries_t;
 
 	typedef Transform3f MatrixHomogeneousType;
 
@@ -69,6 +100,34 @@ namespace hpp
 	/// \brief Map of URDF joints.
 	typedef std::map<std::string, UrdfJointPtrType> MapJointType;
 
+	/// \brief Size of a mesh before and after welding.
+	struct MeshStatistics
+	{
+	  /// Resource name of the mesh.
+	  std::string resource;
+	  /// Number of vertices and triangles read from the resource.
+	  std::size_t originalVertices, originalTriangles;
+	  /// Number of vertices and triangles given to fcl.
+	  std::size_t vertices, triangles;
+	  /// Bytes of the resources of the mesh as read from storage and
+	  /// after decompression of .gz and .zst resources.
+	  std::size_t storedBytes, bytes;
+	};
+	typedef std::vector <MeshStatistics> MeshStatistics_t;
+
+	/// \brief Use of the scratch buffers of mesh import.
+	struct ScratchStatistics
+	{
+	  /// Number of meshes imported.
+	  std::size_t meshes;
+	  /// Number of times a scratch buffer was allocated or grown.
+	  std::size_t allocations;
+	  /// Maximal number of bytes held by scratch buffers.
+	  std::size_t peakBytes;
+	  /// Number of assimp importers created.
+	  std::size_t importers;
+	};
+
 	/// \brief Default constructor.
 	///
 	/// \param rootJointType type of root joint among "anchor", "freeflyer",
@@ -92,13 +151,243 @@ namespace hpp
 	/// resource_retriever format.
 	void parse (const std::string& resourceName);
 
+	/// \brief Parse an URDF file incrementally and build the robot.
+	///
+	/// Unlike parse, the file is neither loaded in a string nor
+	/// turned into a DOM. Links and joints are read one at a time and
+	/// the corresponding joints and bodies are created as soon as
+	/// their parent is available, so that peak memory stays close to
+	/// the size of the robot being built. This is meant for very large
+	/// generated models. The robot is the same as the one built by
+	/// parse.
+	///
+	/// Parsed elements are released once their joint or body is
+	/// created. Only joints and the inertial and collision elements of
+	/// links are kept for update, without links between them.
+	///
+	/// \param resourceName resource name using the
+	/// resource_retriever format. Resources that are not local files
+	/// are handled by parse.
+	/// \note FLOATING joints are not supported by this method.
+	void parseStream (const std::string& resourceName);
+
 	/// Parse a ROS parameter containing a urdf robot description
 	/// \param parameterName name of the ROS parameter
 	void parseFromParameter (const std::string& parameterName);
 
+	/// \brief Parse an URDF robot description held in memory.
+	///
+	/// \param robotDescription content of an URDF file. Meshes are
+	/// retrieved through the resource resolver, if any.
+	void parseString (const std::string& robotDescription);
+
+	/// \brief Parse an URDF description of a static scene into
+	/// obstacles.
+	///
+	/// No joint or body is created and the robot of the parser is not
+	/// used. Links attached to the root link by FIXED joints are placed
+	/// in world frame, the root link being at the origin. Their
+	/// collision geometries are expressed in world frame and merged
+	/// into a few polyhedra, so that the scene costs a few broadphase
+	/// entries instead of one per link. Meshes are loaded and welded as
+	/// for robots, boxes are tessellated exactly, cylinders and spheres
+	/// slightly larger than the primitive so that they are contained in
+	/// their tessellation.
+	///
+	/// Links attached by another type of joint are not static and are
+	/// skipped with their subtree.
+	///
+	/// \param resourceName resource name using the resource_retriever
+	///        format,
+	/// \param maxTriangles maximal number of triangles of a polyhedron.
+	///        Geometries are then grouped by position along the largest
+	///        dimension of the scene. 0, the default, merges all
+	///        geometries into a single polyhedron. A geometry larger than
+	///        maxTriangles is only split by splitMeshes.
+	/// \return collision objects at identity position, named after the
+	///         URDF model, with an index suffix if there are several.
+	ObjectVector_t parseEnvironment (const std::string& resourceName,
+					 std::size_t maxTriangles = 0);
+
+	/// \brief Parse an URDF description of a static scene held in
+	/// memory into obstacles.
+	///
+	/// See parseEnvironment.
+	ObjectVector_t parseEnvironmentString (const std::string& description,
+					       std::size_t maxTriangles = 0);
+
 	/// \brief Build the robot from the urdf description
 	void buildRobot ();
 
+	/// \brief Update the robot from a modified URDF file.
+	///
+	/// The new description is compared to the one previously loaded
+	/// by this parser. Only the changed items are updated:
+	/// \li positions and bounds of joints,
+	/// \li mass and inertia of bodies,
+	/// \li collision geometries, modified in place so that collision
+	///     objects and collision pairs remain valid. Split meshes keep
+	///     their number of chunks, see splitMeshes. Meshes are reloaded
+	///     when their resource name, scale or content changed. Meshes
+	///     that are not local files are not versioned when loaded
+	///     without shared mesh store, see sharedMeshStore: the first
+	///     update reloads them,
+	/// \li origins of collision geometries in their link frame.
+	///
+	/// Changed meshes are loaded before the robot is modified, so that
+	/// the robot is left unchanged if one of them cannot be loaded.
+	///
+	/// \param resourceName resource name using the
+	/// resource_retriever format.
+	/// \return names of the links whose collision geometry or its origin
+	///         changed.
+	/// \throw std::runtime_error if the kinematic tree, a joint axis,
+	///        the origin of a floating joint or a type of collision
+	///        geometry changed, the robot must then be fully reloaded,
+	///        or if a mesh cannot be loaded. The robot is left
+	///        unchanged.
+	std::vector <std::string> update (const std::string& resourceName);
+
+	/// \brief Defer creation of collision geometries.
+	///
+	/// When set before parsing, bodies are created without collision
+	/// objects. Geometries are then created by loadGeometry.
+	void deferGeometry (bool defer);
+
+	/// \brief Create deferred collision geometry of a joint body.
+	///
+	/// Does nothing if the geometry is already loaded.
+	void loadGeometry (const std::string& jointName);
+
+	/// \brief Create all deferred collision geometries.
+	void loadGeometry ();
+
+	/// \brief Set bounding volume type of mesh collision geometries.
+	///
+	/// \param type one of fcl::BV_AABB, fcl::BV_OBB, fcl::BV_RSS,
+	///        fcl::BV_kIOS, fcl::BV_OBBRSS. Default is fcl::BV_OBBRSS.
+	/// \throw std::runtime_error for other types.
+	/// \note Only geometries created after the call are affected. fcl
+	///       does not test hierarchies of different types against each
+	///       other, so that meshes paired for collision checking must be
+	///       created with the same type.
+	/// \note fcl computes no distance between meshes whose hierarchies
+	///       are made of fcl::BV_AABB or fcl::BV_OBB.
+	void boundingVolume (fcl::NODE_TYPE type);
+
+	/// \brief Get bounding volume type of mesh collision geometries.
+	fcl::NODE_TYPE boundingVolume () const;
+
+	/// \brief Set distance below which mesh vertices are merged.
+	///
+	/// Meshes are welded before building the bounding volume
+	/// hierarchy: coincident vertices are merged, degenerate and
+	/// duplicate triangles are removed. Default is 1e-6.
+	/// \param tolerance distance in the robot frame, i.e. after
+	///        scaling. A non positive value disables welding.
+	void weldTolerance (double tolerance);
+
+	/// \brief Get distance below which mesh vertices are merged.
+	double weldTolerance () const;
+
+	/// \brief Set whether STL and OBJ meshes are read without assimp.
+	///
+	/// Built-in readers fill the mesh buffers directly from the
+	/// resource bytes. Other formats are always imported by assimp.
+	/// Default is true.
+	void nativeMeshReaders (bool native);
+
+	/// \brief Get whether STL and OBJ meshes are read without assimp.
+	bool nativeMeshReaders () const;
+
+	/// \brief Set resolver of mesh resources.
+	///
+	/// Meshes and the files they refer to are first looked up by the
+	/// resolver, then retrieved as usual if the resolver does not know
+	/// them. An empty resolver, the default, is never called.
+	void resourceResolver (const ResourceResolver_t& resolver);
+
+	/// \brief Get resolver of mesh resources.
+	const ResourceResolver_t& resourceResolver () const;
+
+	/// \brief Share collision meshes with other processes of the host.
+	///
+	/// Welded vertices and triangles of meshes are stored in a named
+	/// shared memory segment. A process loading a mesh already stored
+	/// by another process maps it instead of importing it, so that it
+	/// only owns the bounding volume hierarchy. Meshes are identified
+	/// by resource name, version (size and modification time of files,
+	/// hash of other resources), scale and welding options, so that a
+	/// modified mesh is stored again. The segment is created by the
+	/// first process opening it and persists until it is removed by
+	/// removeSharedMeshStore.
+	///
+	/// \param name name of the segment, empty to stop sharing meshes,
+	/// \param size size in bytes of the segment if it is created.
+	/// \throw boost::interprocess::interprocess_exception if the
+	///        segment cannot be opened.
+	/// \note Only geometries created after the call are affected. Meshes
+	///       that do not fit in the segment are loaded privately.
+	void sharedMeshStore (const std::string& name,
+			      std::size_t size = std::size_t (1) << 30);
+
+	/// \brief Get name of the segment where meshes are shared, empty if
+	/// meshes are not shared.
+	std::string sharedMeshStore () const;
+
+	/// \brief Remove a segment of shared meshes from the system.
+	///
+	/// Processes using the segment keep it until they exit.
+	/// \return whether the segment existed.
+	static bool removeSharedMeshStore (const std::string& name);
+
+	/// \brief Split large meshes and build their hierarchies in
+	/// parallel.
+	///
+	/// Building the bounding volume hierarchy of a mesh uses one
+	/// core. Meshes of more than maxTriangles triangles are split
+	/// spatially into chunks of at most maxTriangles triangles, whose
+	/// hierarchies are built concurrently. Each chunk becomes a
+	/// collision object of the body, named after the link with the
+	/// index of the chunk as suffix. Each triangle belongs to one
+	/// chunk, so that collision checks give the same results. Groups
+	/// of parseEnvironment larger than maxTriangles are split as well.
+	///
+	/// \param maxTriangles maximal number of triangles of a chunk. 0,
+	///        the default, never splits meshes.
+	/// \param nbThreads number of threads building the chunks of a
+	///        mesh, 0 for the number of cores.
+	/// \note Only geometries created after the call are affected. Split
+	///       meshes are not stored in the shared mesh store.
+	void splitMeshes (std::size_t maxTriangles, std::size_t nbThreads = 0);
+
+	/// \brief Get maximal number of triangles of a mesh that is not
+	/// split, 0 if meshes are never split.
+	std::size_t splitMeshes () const;
+
+	/// \brief Flat description of the kinematic tree of the robot.
+	///
+	/// Computed when the robot has been built by the last parse and
+	/// after each update. Modifications of the robot made otherwise are
+	/// not reflected, see urdf::topology.
+	const Topology& topology () const;
+
+	/// \brief Size of meshes loaded since the last parse, before and
+	/// after welding.
+	///
+	/// \note Do not call while geometries are being built by a
+	/// GeometryLoader.
+	const MeshStatistics_t& meshStatistics () const;
+
+	/// \brief Use of scratch buffers by mesh import since the last
+	/// parse.
+	///
+	/// Meshes are flattened and welded in scratch buffers reused
+	/// across the meshes of a load, together with the assimp importer
+	/// of each set of buffers. Buffers are freed at the end of
+	/// parsing, or when all deferred geometries are loaded.
+	ScratchStatistics scratchStatistics () const;
+
 	/// \brief Set special joints in robot.
 	void setSpecialJoints ();
 	/// \brief Fill gaze.
@@ -125,15 +414,42 @@ namespace hpp
 	/// \brief Parse URDF model and get joints.
 	///
 	/// Each joint in the URDF model is used to build the
-	/// corresponding hpp::model::JointPtr_t object.
+	/// corresponding hpp::model::JointPtr_t object. The URDF tree is
+	/// walked from its root with an explicit stack, so that the
+	/// position of each joint is computed once from the one of its
+	/// parent, whatever the depth of the tree.
 	void parseJoints ();
 
-	/// \brief Connect recursively joints to their children.
+	/// \brief Create the joint corresponding to an URDF joint.
+	///
+	/// \param joint URDF joint,
+	/// \param position position of the URDF joint frame in world frame.
+	/// \return the created joint, 0 for FLOATING joints.
+	JointPtr_t createJoint (const UrdfJointConstPtrType& joint,
+				MatrixHomogeneousType position);
+
+	/// \brief Connect joints to their children.
+	///
+	/// The URDF tree is walked depth first from its root with an
+	/// explicit stack. URDF joints without corresponding joint are
+	/// skipped, their children being connected to the closest ancestor.
+	/// \param rootJoint joint holding the root link.
 	void connectJoints (const JointPtr_t& rootJoint);
 
 	/// \brief Parse bodies and add them to joints.
 	void addBodiesToJoints();
 
+	/// \brief Create body of a link and add it to joint.
+	///
+	/// The body position is computed from the parent joint of the link,
+	/// the root joint is used if the link has no parent joint.
+	void addBodyToJoint (const UrdfLinkConstPtrType& link,
+			     const JointPtr_t& joint);
+
+	/// \brief Set mass, center of mass and inertia matrix of body
+	/// from link inertial information.
+	void setBodyInertia (const UrdfLinkConstPtrType& link, Body* body);
+
 	/// \brief compute body absolute position.
 	///
 	/// \param link link for which absolute position is computed
@@ -142,21 +458,55 @@ namespace hpp
 	MatrixHomogeneousType computeBodyAbsolutePosition
 	(const UrdfLinkConstPtrType& link, const ::urdf::Pose& pose);
 
-	/// \brief Load polyhedron from resource.
-	void loadPolyhedronFromResource
-	(const std::string& filename, const ::urdf::Vector3& scale,
-	 const Parser::PolyhedronPtrType& polyhedron);
+	/// \brief Position of a node of a link in the frame of the joint
+	/// holding the link.
+	///
+	/// \param pose origin of a visual or collision node.
+	MatrixHomogeneousType positionInJointFrame
+	(const UrdfLinkConstPtrType& link, const ::urdf::Pose& pose);
 
-	void meshFromAssimpScene (const std::string& name,
-				  const ::urdf::Vector3& scale,
-				  const aiScene* scene,
-				  const PolyhedronPtrType& mesh);
+	/// \brief Start retrieving the collision meshes of the model in
+	/// the background.
+	///
+	/// Meshes are then fetched while the kinematic tree is built.
+	void prefetchMeshes ();
 
-	void buildMesh (const ::urdf::Vector3& scale,
-			const aiScene* scene,
-			const aiNode* node,
-			std::vector<unsigned>& subMeshIndexes,
-			const PolyhedronPtrType& mesh);
+	/// \brief Load mesh from resource and record its statistics.
+	///
+	/// Prefetched resources are used if available.
+	/// \retval mesh buffers acquired from meshArena_ by the caller.
+	/// \note Thread safe.
+	void loadMesh (const std::string& resourceName,
+		       const ::urdf::Vector3& scale, MeshBuffers& mesh);
+
+	/// \brief Version of a mesh resource, see resourceVersion.
+	///
+	/// \note Thread safe.
+	std::string meshVersion (const std::string& resourceName) const;
+
+	/// \brief Check that a new description can be applied by update.
+	///
+	/// \retval joints joint of this parser for each URDF joint of
+	///         model, the rotation joint for floating joints.
+	/// \throw std::runtime_error if the robot must be fully reloaded.
+	void checkUpdate (const ::urdf::Model& model, MapHppJointType& joints);
+
+	/// New collision geometry of a link, see prepareSolidComponent.
+	struct SolidComponentUpdate;
+
+	/// \brief Load the new collision geometry of a link.
+	///
+	/// The robot is not modified, so that update can fail before
+	/// applying any change.
+	/// \retval update collision objects of the link and new vertices
+	///         and triangles of meshes, one chunk per object.
+	void prepareSolidComponent (const UrdfLinkConstPtrType& link,
+				    const JointPtr_t& joint,
+				    SolidComponentUpdate& update);
+
+	/// \brief Replace collision geometry and origin of a link by those
+	/// prepared by prepareSolidComponent.
+	void updateSolidComponent (const SolidComponentUpdate& update);
 
 	/// \brief Add solid component to body.
 	///
@@ -165,14 +515,23 @@ namespace hpp
 	void addSolidComponentToJoint (const UrdfLinkConstPtrType& link,
 				       const JointPtr_t& joint);
 
-	// returns, in a vector, the children of a joint, or a
-	// subchildren if no children si present in the actuated
-	// joints map.
-	std::vector<std::string> getChildrenJoint
-	(const std::string& jointName);
-
-	void getChildrenJoint (const std::string& jointName,
-			       std::vector<std::string>& result);
+	/// \brief Create FCL geometry of link collision element.
+	///
+	/// \return the geometry, one per chunk for split meshes, none for
+	///         unsupported types.
+	/// \note The robot is not modified. Thread safe: mesh buffers are
+	///       local to the call.
+	CollisionGeometries_t createGeometry
+	(const UrdfLinkConstPtrType& link);
+
+	/// \brief Number of chunks of a mesh, see splitMeshes.
+	std::size_t meshChunks (std::size_t nbTriangles) const;
+
+	/// \brief Create collision objects from geometries and add them to
+	/// the body of joint.
+	void addGeometryToJoint (const UrdfLinkConstPtrType& link,
+				 const JointPtr_t& joint,
+				 const CollisionGeometries_t& geometries);
 
 	/// Create free-flyer joints and add them to joints map.
 	/// If robot is provided, set root joint.
@@ -214,8 +573,11 @@ namespace hpp
 	MatrixHomogeneousType poseToMatrix (::urdf::Pose p);
 
 	/// \brief Get joint position in given reference frame.
+	///
+	/// Transforms of model are composed walking up from the joint to
+	/// the reference joint, or to the root of the tree.
 	MatrixHomogeneousType getPoseInReferenceFrame
-	(const std::string& referenceJointName,
+	(const ::urdf::Model& model, const std::string& referenceJointName,
 	 const std::string& currentJointName);
 
 	::urdf::Model model_;
@@ -238,9 +600,39 @@ namespace hpp
 	std::string rightFootJointName_;
 	std::string gazeJointName_;
 	/// \}
-	std::vector <fcl::Vec3f> vertices_;
-	std::vector <fcl::Triangle> triangles_;
+	bool deferGeometry_;
+	/// Links whose collision geometry is deferred, by joint name.
+	std::map <std::string, UrdfLinkConstPtrType> pendingGeometry_;
+	/// Bounding volume type of meshes.
+	fcl::NODE_TYPE boundingVolume_;
+	double weldTolerance_;
+	bool nativeMeshReaders_;
+	/// Maximal number of triangles of a mesh chunk, 0 if meshes are
+	/// not split.
+	std::size_t splitTriangles_;
+	/// Number of threads building chunks, 0 for the number of cores.
+	std::size_t splitThreads_;
+	ResourceResolver_t resourceResolver_;
+	MeshStatistics_t meshStatistics_;
+	/// Versions of the mesh resources loaded since the last parse, by
+	/// resource name, see resourceVersion.
+	std::map <std::string, std::string> meshVersions_;
+	/// Number of collision objects created for each link, by link
+	/// name, more than one for split meshes.
+	std::map <std::string, std::size_t> linkChunks_;
+	/// Protects meshStatistics_, meshVersions_ and linkChunks_.
+	boost::mutex meshStatisticsMutex_;
+	Topology topology_;
+	/// Scratch buffers of mesh import.
+	boost::shared_ptr <MeshArena> meshArena_;
+	/// Meshes of the current load retrieved in the background, null
+	/// when no load is in progress.
+	boost::shared_ptr <ResourcePrefetcher> prefetcher_;
+	/// Meshes shared with other processes, empty if not shared.
+	boost::shared_ptr <SharedMeshStore> meshStore_;
 	ObjectFactory objectFactory_;
+
+	friend class GeometryLoader;
       }; // class Parser
     } // end of namespace urdf.
   } // end of namespace model.
@@ -0,0 +1,60 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hpp-model-urdf.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/// \brief Resolution of mesh resources by the user.
+
+#ifndef HPP_MODEL_URDF_RESOURCE_RESOLVER
+# define HPP_MODEL_URDF_RESOURCE_RESOLVER
+
+# include <map>
+# include <string>
+
+# include <boost/function.hpp>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// Function giving the content of a resource
+      ///
+      /// \param uri resource name as written in the robot description,
+      /// \retval content bytes of the resource.
+      /// \return false if the resource is unknown to the resolver. It is
+      ///         then retrieved through resource_retriever.
+      /// \note Resolvers may be called concurrently by several threads
+      ///       when geometries are built in the background.
+      typedef boost::function <bool (const std::string& uri,
+				     std::string& content)>
+      ResourceResolver_t;
+
+      /// Map from resource names to their content.
+      typedef std::map <std::string, std::string> ResourceBlobs_t;
+
+      /// Build a resolver serving resources from memory
+      ///
+      /// \param blobs map from resource names to their content. The map
+      ///        is copied once, resources are then read from the copy
+      ///        without further copy.
+      ResourceResolver_t blobResolver (const ResourceBlobs_t& blobs);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_RESOURCE_RESOLVER
@@ -0,0 +1,141 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hpp-model-urdf.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/// \brief Kinematic tree of a robot stored in flat arrays.
+
+#ifndef HPP_MODEL_URDF_TOPOLOGY
+# define HPP_MODEL_URDF_TOPOLOGY
+
+# include <utility>
+# include <vector>
+
+# include <hpp/model/fwd.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Kinematic tree of a robot stored in flat arrays.
+      ///
+      /// Joints are indexed in depth first order, the root joint having
+      /// index 0 and each joint being followed by its subtree. All arrays
+      /// have one element per joint. The subtree of joint i is the range
+      /// [i, subtreeEnd [i]), so that ancestor and subtree queries are
+      /// comparisons of indices.
+      ///
+      /// Configuration bounds are stored in arrays of the size of the
+      /// configuration, so that configurations can be sampled and clamped
+      /// without a virtual call per component.
+      ///
+      /// Arrays are a snapshot of the robot taken by topology. They are
+      /// not updated when joints, bounds or bodies of the robot are
+      /// modified afterwards: call topology again to refresh them.
+      ///
+      /// Mass tables hold the parts of composite rigid body quantities
+      /// that do not depend on the configuration, so that dynamics code
+      /// can update subtree quantities incrementally.
+      struct Topology
+      {
+	/// Parent of the root joint.
+	static const std::size_t noParent = std::size_t (-1);
+
+	/// Joints in depth first order, children in their order in the
+	/// parent joint.
+	std::vector <JointPtr_t> joints;
+	/// Index of the parent joint, noParent for the root joint.
+	std::vector <std::size_t> parent;
+	/// Index past the last joint of the subtree.
+	std::vector <std::size_t> subtreeEnd;
+	/// Rank and size of the joint in configuration vectors.
+	std::vector <std::size_t> rankInConfiguration, configSize;
+	/// Rank and size of the joint in velocity vectors.
+	std::vector <std::size_t> rankInVelocity, numberDof;
+	/// Position of the joint in its parent joint frame when the
+	/// parent joint is at its zero configuration. Initial position for
+	/// the root joint.
+	std::vector <Transform3f> positionInParentFrame;
+	/// Mass of the body of the joint, 0 for joints without body.
+	std::vector <double> mass;
+	/// Sum of the masses of the bodies of the subtree.
+	std::vector <double> subtreeMass;
+	/// Mass times center of mass of the body, in joint frame. The
+	/// first moment of a subtree is the one of its joint plus the
+	/// first moments of the child subtrees moved by their joints.
+	std::vector <vector3_t> firstMoment;
+	/// Inertia matrix of the body about the joint origin, in joint
+	/// frame.
+	std::vector <matrix3_t> inertia;
+
+	/// Bounds of the configuration, indexed by rank in configuration
+	/// vectors. Unbounded components have infinite bounds.
+	/// \{
+	std::vector <double> lowerBound, upperBound;
+	/// \}
+	/// Whether each component of the configuration is bounded, as
+	/// bytes so that the array is contiguous.
+	std::vector <unsigned char> bounded;
+	/// Maximal ranges [first, second) of consecutive bounded components
+	/// of the configuration, in increasing order.
+	std::vector <std::pair <std::size_t, std::size_t> > boundedRanges;
+
+	/// Number of joints.
+	std::size_t size () const
+	{
+	  return joints.size ();
+	}
+
+	/// Whether joint i is joint j or one of its ancestors.
+	bool isAncestor (std::size_t i, std::size_t j) const
+	{
+	  return i <= j && j < subtreeEnd [i];
+	}
+
+	/// Number of joints in the subtree of joint i, i included.
+	std::size_t subtreeSize (std::size_t i) const
+	{
+	  return subtreeEnd [i] - i;
+	}
+
+	/// Size of configuration vectors.
+	std::size_t configurationSize () const
+	{
+	  return lowerBound.size ();
+	}
+
+	/// Total mass of the robot.
+	double totalMass () const
+	{
+	  return subtreeMass.empty () ? 0 : subtreeMass [0];
+	}
+
+	void clear ();
+      }; // struct Topology
+
+      /// \brief Compute flat description of the kinematic tree of a robot.
+      ///
+      /// The tree is walked with an explicit stack, so that deep trees do
+      /// not overflow the call stack.
+      /// \return an empty topology if the robot has no root joint.
+      Topology topology (const DevicePtr_t& robot);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_TOPOLOGY
@@ -24,6 +24,7 @@
 
 #include <hpp/model/urdf/parser.hh>
 #include <hpp/model/srdf/parser.hh>
+#include <hpp/model/urdf/geometry-loader.hh>
 
 namespace hpp
 {
@@ -54,6 +55,24 @@ namespace hpp
 			   const std::string& urdfSuffix,
 			   const std::string& srdfSuffix);
 
+      /// Load robot model by name, collision geometries being built
+      /// asynchronously
+      ///
+      /// The kinematic tree and bodies are available when the function
+      /// returns. Collision objects and collision pairs are added by
+      /// GeometryLoader::wait or, body by body, by GeometryLoader::load.
+      ///
+      /// \param robot, rootJointType, package, modelName, urdfSuffix,
+      ///        srdfSuffix see loadRobotModel,
+      /// \param background, callback see GeometryLoader::create.
+      GeometryLoaderPtr_t loadRobotModelAsync
+      (const DevicePtr_t& robot, const std::string& rootJointType,
+       const std::string& package, const std::string& modelName,
+       const std::string& urdfSuffix, const std::string& srdfSuffix,
+       bool background = true,
+       const GeometryLoader::Callback_t& callback =
+       GeometryLoader::Callback_t ());
+
       /// Load robot model from ROS parameter
       ///
       /// \param robot Empty robot created before calling the function.
@@ -69,6 +88,24 @@ namespace hpp
 					const std::string& urdfParameter,
 					const std::string& srdfParameter);
 
+      /// Load robot model from URDF and SRDF descriptions held in memory
+      ///
+      /// \param robot Empty robot created before calling the function.
+      ///        Users can pass an instance of a class deriving from Device.
+      /// \param rootJointType type of root joint among "anchor", "freeflyer",
+      /// "planar",
+      /// \param urdfDescription content of the urdf file,
+      /// \param srdfDescription content of the srdf file,
+      /// \param resolver resolver of mesh resources, see
+      ///        Parser::resourceResolver. Use blobResolver to serve meshes
+      ///        from memory.
+      void loadRobotModelFromString (const DevicePtr_t& robot,
+				     const std::string& rootJointType,
+				     const std::string& urdfDescription,
+				     const std::string& srdfDescription,
+				     const ResourceResolver_t& resolver =
+				     ResourceResolver_t ());
+
       /// Load humanoid robot model by name
       ///
       /// \param robot Empty robot created before calling the function.
@@ -109,6 +146,21 @@ namespace hpp
        const std::string& urdfParameter,
        const std::string& srdfParameter);
 
+      /// Load humanoid robot model from URDF and SRDF descriptions held
+      /// in memory
+      ///
+      /// \param robot Empty robot created before calling the function.
+      ///        Users can pass an instance of a class deriving from
+      ///        HumanoidRobot.
+      /// \param rootJointType, urdfDescription, srdfDescription, resolver
+      ///        see loadRobotModelFromString.
+      void loadHumanoidModelFromString
+      (const model::HumanoidRobotPtr_t& robot,
+       const std::string& rootJointType,
+       const std::string& urdfDescription,
+       const std::string& srdfDescription,
+       const ResourceResolver_t& resolver = ResourceResolver_t ());
+
       /// Load only urdf model file
       ///
       /// \param robot Empty robot created before calling the function.
@@ -0,0 +1,233 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/srdf/pair-cost.cc
+///
+/// \brief Cost estimation and ordering of collision pairs.
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include <boost/foreach.hpp>
+
+#include <hpp/fcl/BV/BV.h>
+#include <hpp/fcl/BVH/BVH_model.h>
+#include <hpp/fcl/collision_object.h>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/srdf/parser.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace srdf
+    {
+      namespace
+      {
+	/// \brief Summary of a collision object.
+	struct ObjectCost
+	{
+	  /// Depth of the bounding volume hierarchy, 1 for primitives.
+	  std::size_t depth;
+	  /// Bounding sphere in world frame.
+	  fcl::Vec3f center;
+	  double radius;
+	};
+
+	/// \brief Summary of the collision objects of a body.
+	struct BodyCost
+	{
+	  BodyCost () : triangles (0), depth (0), primitives (0), objects ()
+	  {}
+
+	  std::size_t triangles;
+	  /// Depth of the deepest hierarchy, 0 if there are only
+	  /// primitives.
+	  std::size_t depth;
+	  std::size_t primitives;
+	  std::vector <ObjectCost> objects;
+	};
+
+	template <typename BV>
+	std::size_t bvhDepth (const fcl::CollisionGeometry* geometry,
+			      std::size_t& triangles)
+	{
+	  const fcl::BVHModel <BV>* model =
+	    static_cast <const fcl::BVHModel <BV>*> (geometry);
+	  triangles = model->num_tris;
+	  if (model->getNumBVs () == 0) return 0;
+	  // Nodes to visit with their depth.
+	  std::size_t depth = 0;
+	  std::vector <std::pair <int, std::size_t> > stack;
+	  stack.push_back (std::make_pair (0, 1));
+	  while (!stack.empty ()) {
+	    const fcl::BVNode <BV>& node = model->getBV (stack.back ().first);
+	    std::size_t nodeDepth = stack.back ().second;
+	    stack.pop_back ();
+	    depth = std::max (depth, nodeDepth);
+	    if (!node.isLeaf ()) {
+	      stack.push_back (std::make_pair (node.leftChild (),
+					       nodeDepth + 1));
+	      stack.push_back (std::make_pair (node.rightChild (),
+					       nodeDepth + 1));
+	    }
+	  }
+	  return depth;
+	}
+
+	/// Depth of the hierarchy of a geometry, 0 for primitives.
+	std::size_t geometryDepth (const fcl::CollisionGeometry* geometry,
+				   std::size_t& triangles)
+	{
+	  triangles = 0;
+	  switch (geometry->getNodeType ()) {
+	  case fcl::BV_AABB:
+	    return bvhDepth <fcl::AABB> (geometry, triangles);
+	  case fcl::BV_OBB:
+	    return bvhDepth <fcl::OBB> (geometry, triangles);
+	  case fcl::BV_RSS:
+	    return bvhDepth <fcl::RSS> (geometry, triangles);
+	  case fcl::BV_kIOS:
+	    return bvhDepth <fcl::kIOS> (geometry, triangles);
+	  case fcl::BV_OBBRSS:
+	    return bvhDepth <fcl::OBBRSS> (geometry, triangles);
+	  default:
+	    return 0;
+	  }
+	}
+
+	BodyCost bodyCost (const Body* body)
+	{
+	  BodyCost result;
+	  BOOST_FOREACH (const CollisionObjectPtr_t& object,
+			 body->innerObjects (COLLISION)) {
+	    const fcl::CollisionObjectPtr_t& fclObject = object->fcl ();
+	    const fcl::CollisionGeometry* geometry =
+	      fclObject->collisionGeometry ().get ();
+	    std::size_t triangles;
+	    std::size_t depth = geometryDepth (geometry, triangles);
+	    if (geometry->getObjectType () != fcl::OT_BVH) ++result.primitives;
+	    result.triangles += triangles;
+	    result.depth = std::max (result.depth, depth);
+
+	    ObjectCost objectCost;
+	    objectCost.depth = std::max <std::size_t> (depth, 1);
+	    objectCost.center =
+	      fclObject->getTransform ().transform (geometry->aabb_center);
+	    objectCost.radius = geometry->aabb_radius;
+	    result.objects.push_back (objectCost);
+	  }
+	  return result;
+	}
+
+	bool cheaper (const Parser::PairCost& a, const Parser::PairCost& b)
+	{
+	  return a.cost < b.cost;
+	}
+
+	bool closer (const Parser::PairCost& a, const Parser::PairCost& b)
+	{
+	  return a.clearance < b.clearance;
+	}
+
+	/// Order in which addCollisionPairs creates pairs: by rank of the
+	/// first joint in the joint vector, then of the second one.
+	struct JointOrder
+	{
+	  explicit JointOrder (const JointVector_t& joints) : ranks ()
+	  {
+	    for (std::size_t i = 0; i < joints.size (); ++i) {
+	      ranks [joints [i]] = i;
+	    }
+	  }
+
+	  std::size_t rank (const JointPtr_t& joint) const
+	  {
+	    return ranks.find (joint)->second;
+	  }
+
+	  bool operator() (const Parser::PairCost& a,
+			   const Parser::PairCost& b) const
+	  {
+	    std::size_t a1 = rank (a.joint1), b1 = rank (b.joint1);
+	    return a1 < b1 || (a1 == b1 && rank (a.joint2) < rank (b.joint2));
+	  }
+
+	  std::map <JointPtr_t, std::size_t> ranks;
+	};
+      } // end of anonymous namespace.
+
+      void Parser::estimatePairCosts (PairCosts_t& pairs) const
+      {
+	// Bodies appear in many pairs, their summary is computed once.
+	std::map <const Body*, BodyCost> bodies;
+	BOOST_FOREACH (PairCost& pair, pairs) {
+	  const Body* body [2] = { pair.joint1->linkedBody (),
+				   pair.joint2->linkedBody () };
+	  const BodyCost* cost [2];
+	  for (std::size_t i = 0; i < 2; ++i) {
+	    std::map <const Body*, BodyCost>::iterator it =
+	      bodies.find (body [i]);
+	    if (it == bodies.end ()) {
+	      it = bodies.insert (std::make_pair (body [i],
+						  bodyCost (body [i]))).first;
+	    }
+	    cost [i] = &it->second;
+	  }
+
+	  pair.triangles = cost [0]->triangles + cost [1]->triangles;
+	  pair.depth = cost [0]->depth + cost [1]->depth;
+	  pair.primitives = cost [0]->primitives + cost [1]->primitives;
+	  pair.cost = 0;
+	  pair.clearance = std::numeric_limits <double>::infinity ();
+	  BOOST_FOREACH (const ObjectCost& object1, cost [0]->objects) {
+	    BOOST_FOREACH (const ObjectCost& object2, cost [1]->objects) {
+	      pair.cost += object1.depth + object2.depth;
+	      double clearance = (object1.center - object2.center).length ()
+		- object1.radius - object2.radius;
+	      pair.clearance = std::min (pair.clearance, clearance);
+	    }
+	  }
+	}
+	hppDout (info, "Estimated cost of " << pairs.size () << " pairs");
+      }
+
+      void Parser::sortPairCosts (PairCosts_t& pairs) const
+      {
+	switch (pairOrder_) {
+	case CHEAPEST_FIRST:
+	  std::stable_sort (pairs.begin (), pairs.end (), cheaper);
+	  break;
+	case CLOSEST_FIRST:
+	  std::stable_sort (pairs.begin (), pairs.end (), closer);
+	  break;
+	default:
+	  std::stable_sort (pairs.begin (), pairs.end (),
+			    JointOrder (robot_->getJointVector ()));
+	  break;
+	}
+      }
+    } // end of namespace srdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -22,20 +22,24 @@
  * \brief Implementation of URDF Parser for hpp-model.
  */
 
+#include <set>
 #include <sstream>
 #include <boost/foreach.hpp>
-#include <resource_retriever/retriever.h>
 #include <ros/node_handle.h>
 
 #include <urdf/model.h>
 
 #include <hpp/util/assertion.hh>
 #include <hpp/util/debug.hh>
+#include <hpp/model/body.hh>
 #include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
 #include <hpp/model/joint.hh>
 
 #include <hpp/model/srdf/parser.hh>
 
+#include "../urdf/resource.hh"
+
 namespace hpp
 {
   namespace model
@@ -45,7 +49,12 @@ namespace hpp
       Parser::Parser ()
 	: urdfModel_ (),
 	  srdfModel_ (),
-	  robot_ ()
+	  robot_ (),
+	  emptyCollisionPairs_ (0),
+	  emptyDistancePairs_ (0),
+	  pairOrder_ (JOINT_ORDER),
+	  pairCosts_ (),
+	  costsEstimated_ (false)
       {}
 
       Parser::~Parser ()
@@ -66,9 +75,70 @@ namespace hpp
 	  }
       }
 
+      std::size_t Parser::emptyPairs (Request_t type) const
+      {
+	return type == COLLISION ? emptyCollisionPairs_ : emptyDistancePairs_;
+      }
+
+      void Parser::pairOrder (PairOrder order)
+      {
+	pairOrder_ = order;
+      }
+
+      Parser::PairOrder Parser::pairOrder () const
+      {
+	return pairOrder_;
+      }
+
+      const Parser::PairCosts_t& Parser::pairCosts () const
+      {
+	if (!costsEstimated_ && robot_) {
+	  robot_->computeForwardKinematics ();
+	  estimatePairCosts (pairCosts_);
+	  costsEstimated_ = true;
+	}
+	return pairCosts_;
+      }
+
+      namespace
+      {
+	/// Whether both bodies of a pair have inner objects for a request.
+	bool hasObjects (const Parser::PairCost& pair, Request_t type)
+	{
+	  return !pair.joint1->linkedBody ()->innerObjects (type).empty () &&
+	    !pair.joint2->linkedBody ()->innerObjects (type).empty ();
+	}
+
+	bool samePair (const Parser::PairCost& a, const Parser::PairCost& b)
+	{
+	  return a.joint1 == b.joint1 && a.joint2 == b.joint2;
+	}
+      } // end of anonymous namespace.
+
+      void Parser::addCollisionPair (const JointPtr_t& joint1,
+				     const JointPtr_t& joint2)
+      {
+	PairCost pair;
+	pair.joint1 = joint1;
+	pair.joint2 = joint2;
+	if (!hasObjects (pair, COLLISION)) {
+	  ++emptyCollisionPairs_;
+	} else {
+	  robot_->addCollisionPairs (joint1, joint2, COLLISION);
+	}
+	if (!hasObjects (pair, DISTANCE)) {
+	  ++emptyDistancePairs_;
+	} else {
+	  robot_->addCollisionPairs (joint1, joint2, DISTANCE);
+	}
+      }
+
       void Parser::addCollisionPairs ()
       {
 	JointVector_t joints = robot_->getJointVector ();
+	emptyCollisionPairs_ = 0;
+	emptyDistancePairs_ = 0;
+	pairCosts_.clear ();
 
 	// Cycle through all joint pairs
 	for (JointVector_t::iterator it1 = joints.begin ();
@@ -97,13 +167,31 @@ namespace hpp
 		  hppDout (info, "Handling pair: ("  << bodyName1 << ","
 			   << bodyName2 << ")");
 
-		  robot_->addCollisionPairs (joint1, joint2, COLLISION);
-		  robot_->addCollisionPairs (joint1, joint2, DISTANCE);
+		  PairCost pair;
+		  pair.joint1 = joint1;
+		  pair.joint2 = joint2;
+		  pairCosts_.push_back (pair);
 		}
 	      }
 	    }
 	  }
 	}
+	// Pairs are created in joint order, costs are only estimated when
+	// pairs are sorted by cost or by pairCosts. Clearances are
+	// estimated from the positions of the collision objects, which are
+	// only up to date after forward kinematics.
+	costsEstimated_ = pairOrder_ != JOINT_ORDER;
+	if (costsEstimated_) {
+	  robot_->computeForwardKinematics ();
+	  estimatePairCosts (pairCosts_);
+	  sortPairCosts (pairCosts_);
+	}
+	BOOST_FOREACH (const PairCost& pair, pairCosts_) {
+	  addCollisionPair (pair.joint1, pair.joint2);
+	}
+	hppDout (notice, "Skipped " << emptyCollisionPairs_
+		 << " collision pairs and " << emptyDistancePairs_
+		 << " distance pairs without collision objects.");
       }
 
       bool
@@ -189,22 +277,32 @@ namespace hpp
 		     const std::string& semanticResourceName,
 		     Parser::RobotPtrType robot)
       {
-	resource_retriever::Retriever resourceRetriever;
+	urdf::Resource robotResource =
+	  urdf::retrieveResource (robotResourceName);
+	std::string robotDescription
+	  (reinterpret_cast <const char*> (robotResource.data ()),
+	   robotResource.size ());
 
-	resource_retriever::MemoryResource robotResource =
-	  resourceRetriever.get(robotResourceName);
-	std::string robotDescription;
-	robotDescription.resize(robotResource.size);
-	for (unsigned i = 0; i < robotResource.size; ++i)
-	  robotDescription[i] = robotResource.data.get()[i];
+	urdf::Resource semanticResource =
+	  urdf::retrieveResource (semanticResourceName);
+	std::string semanticDescription
+	  (reinterpret_cast <const char*> (semanticResource.data ()),
+	   semanticResource.size ());
+	parseString (robotDescription, semanticDescription, robot);
+      }
 
-	resource_retriever::MemoryResource semanticResource =
-	  resourceRetriever.get(semanticResourceName);
-	std::string semanticDescription;
-	semanticDescription.resize(semanticResource.size);
-	for (unsigned i = 0; i < semanticResource.size; ++i)
-	  semanticDescription[i] = semanticResource.data.get()[i];
+      void Parser::parseString (const std::string& robotDescription,
+				const std::string& semanticDescription,
+				Parser::RobotPtrType robot)
+      {
+	parseDescription (robotDescription, semanticDescription, robot);
+	processSemanticDescription ();
+      }
 
+      void Parser::parseDescription (const std::string& robotDescription,
+				     const std::string& semanticDescription,
+				     Parser::RobotPtrType robot)
+      {
 	// Reset the attributes to avoid problems when loading
 	// multiple robots using the same object.
 	urdfModel_.clear ();
@@ -224,7 +322,6 @@ namespace hpp
 	    throw std::runtime_error ("Failed to open SRDF file:\n"
 				      + semanticDescription);
 	  }
-	processSemanticDescription ();
       }
 
       void Parser::parseFromParameter (const std::string& urdfParameterName,
@@ -261,6 +358,146 @@ namespace hpp
 	}
       }
 
+      namespace
+      {
+	typedef std::set <std::pair <std::string, std::string> >
+	CollisionPairSet_t;
+
+	CollisionPairSet_t disabledPairs (const ::srdf::Model& model)
+	{
+	  CollisionPairSet_t result;
+	  BOOST_FOREACH (const Parser::CollisionPairType& colPair,
+			 model.getDisabledCollisionPairs ()) {
+	    if (colPair.link1_ < colPair.link2_)
+	      result.insert (std::make_pair (colPair.link1_, colPair.link2_));
+	    else
+	      result.insert (std::make_pair (colPair.link2_, colPair.link1_));
+	  }
+	  return result;
+	}
+      } // end of anonymous namespace.
+
+      void Parser::update (const std::string& robotResourceName,
+			   const std::string& semanticResourceName)
+      {
+	if (!robot_) {
+	  throw std::runtime_error ("No robot has been loaded by this parser");
+	}
+	urdf::Resource robotResource =
+	  urdf::retrieveResource (robotResourceName);
+	std::string robotDescription
+	  (reinterpret_cast <const char*> (robotResource.data ()),
+	   robotResource.size ());
+
+	urdf::Resource semanticResource =
+	  urdf::retrieveResource (semanticResourceName);
+	std::string semanticDescription
+	  (reinterpret_cast <const char*> (semanticResource.data ()),
+	   semanticResource.size ());
+
+	::urdf::Model urdfModel;
+	::srdf::Model srdfModel;
+	if (!urdfModel.initString (robotDescription))
+	  {
+	    throw std::runtime_error ("Failed to open URDF file:\n"+
+				      robotDescription);
+	  }
+	if (!srdfModel.initString (urdfModel, semanticDescription))
+	  {
+	    throw std::runtime_error ("Failed to open SRDF file:\n"
+				      + semanticDescription);
+	  }
+
+	CollisionPairSet_t previous = disabledPairs (srdfModel_);
+	CollisionPairSet_t current = disabledPairs (srdfModel);
+	urdfModel_ = urdfModel;
+	srdfModel_ = srdfModel;
+
+	// Joints holding bodies, ordered as in addCollisionPairs.
+	JointVector_t joints = robot_->getJointVector ();
+	std::map <std::string, std::size_t> bodyRank;
+	for (std::size_t i = 0; i < joints.size (); ++i) {
+	  if (joints [i]->linkedBody ())
+	    bodyRank [joints [i]->linkedBody ()->name ()] = i;
+	}
+
+	// Pairs that are not disabled anymore are added, newly disabled
+	// pairs are removed. Other pairs are left untouched.
+	PairCosts_t enabled;
+	for (int enable = 0; enable < 2; ++enable) {
+	  const CollisionPairSet_t& from = enable ? previous : current;
+	  const CollisionPairSet_t& to = enable ? current : previous;
+	  for (CollisionPairSet_t::const_iterator it = from.begin ();
+	       it != from.end (); ++it) {
+	    if (to.count (*it)) continue;
+	    std::map <std::string, std::size_t>::const_iterator b1 =
+	      bodyRank.find (it->first);
+	    std::map <std::string, std::size_t>::const_iterator b2 =
+	      bodyRank.find (it->second);
+	    if (b1 == bodyRank.end () || b2 == bodyRank.end ()) continue;
+	    PairCost pair;
+	    pair.joint1 = joints [std::max (b1->second, b2->second)];
+	    pair.joint2 = joints [std::min (b1->second, b2->second)];
+	    if (enable) {
+	      hppDout (info, "Enabling pair: (" << it->first << ","
+		       << it->second << ")");
+	      enabled.push_back (pair);
+	    } else {
+	      hppDout (info, "Disabling pair: (" << it->first << ","
+		       << it->second << ")");
+	      robot_->removeCollisionPairs (pair.joint1, pair.joint2,
+					    COLLISION);
+	      robot_->removeCollisionPairs (pair.joint1, pair.joint2,
+					    DISTANCE);
+	      for (PairCosts_t::iterator cost = pairCosts_.begin ();
+		   cost != pairCosts_.end (); ++cost) {
+		if (samePair (*cost, pair)) {
+		  pairCosts_.erase (cost);
+		  break;
+		}
+	      }
+	    }
+	  }
+	}
+
+	emptyCollisionPairs_ = 0;
+	emptyDistancePairs_ = 0;
+	BOOST_FOREACH (const PairCost& pair, enabled) {
+	  if (!hasObjects (pair, COLLISION)) ++emptyCollisionPairs_;
+	  if (!hasObjects (pair, DISTANCE)) ++emptyDistancePairs_;
+	}
+	if (enabled.empty ()) return;
+	if (costsEstimated_) {
+	  robot_->computeForwardKinematics ();
+	  estimatePairCosts (enabled);
+	}
+	PairCosts_t pairs (pairCosts_);
+	pairs.insert (pairs.end (), enabled.begin (), enabled.end ());
+	sortPairCosts (pairs);
+	// Pairs of the robot are ordered again by adding anew the pairs
+	// that follow the first enabled one.
+	std::size_t first = 0;
+	while (first < pairCosts_.size () &&
+	       samePair (pairs [first], pairCosts_ [first])) ++first;
+	for (std::size_t i = first; i < pairCosts_.size (); ++i) {
+	  robot_->removeCollisionPairs (pairCosts_ [i].joint1,
+					pairCosts_ [i].joint2, COLLISION);
+	  robot_->removeCollisionPairs (pairCosts_ [i].joint1,
+					pairCosts_ [i].joint2, DISTANCE);
+	}
+	for (std::size_t i = first; i < pairs.size (); ++i) {
+	  if (hasObjects (pairs [i], COLLISION)) {
+	    robot_->addCollisionPairs (pairs [i].joint1, pairs [i].joint2,
+				       COLLISION);
+	  }
+	  if (hasObjects (pairs [i], DISTANCE)) {
+	    robot_->addCollisionPairs (pairs [i].joint1, pairs [i].joint2,
+				       DISTANCE);
+	  }
+	}
+	pairCosts_.swap (pairs);
+      }
+
       void Parser::processSemanticDescription ()
       {
 	// Add collision pairs.
@@ -0,0 +1,208 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/geometry-loader.cc
+///
+/// \brief Implementation of GeometryLoader.
+
+#include <stdexcept>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/urdf/geometry-loader.hh>
+
+#include "mesh.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      GeometryLoaderPtr_t
+      GeometryLoader::create (const DevicePtr_t& robot,
+			      const std::string& rootJointType,
+			      const std::string& urdfPath,
+			      const std::string& srdfPath,
+			      bool background,
+			      const Callback_t& callback)
+      {
+	GeometryLoaderPtr_t loader (new GeometryLoader (robot, rootJointType,
+							urdfPath, srdfPath));
+	// Build kinematic tree and bodies without collision objects.
+	loader->urdfParser_.deferGeometry (true);
+	loader->urdfParser_.parse (urdfPath);
+	hppDout (notice, "Finished parsing URDF file.");
+	loader->pending_.swap (loader->urdfParser_.pendingGeometry_);
+	if (background) {
+	  loader->thread_ = boost::thread (&GeometryLoader::build,
+					   loader.get (), callback);
+	}
+	return loader;
+      }
+
+      GeometryLoader::GeometryLoader (const DevicePtr_t& robot,
+				      const std::string& rootJointType,
+				      const std::string& urdfPath,
+				      const std::string& srdfPath)
+	: robot_ (robot),
+	  urdfParser_ (rootJointType, robot),
+	  srdfParser_ (),
+	  urdfPath_ (urdfPath),
+	  srdfPath_ (srdfPath),
+	  pending_ (),
+	  building_ (),
+	  built_ (),
+	  promise_ (),
+	  future_ (promise_.get_future ()),
+	  thread_ (),
+	  done_ (false)
+      {}
+
+      GeometryLoader::~GeometryLoader ()
+      {
+	if (thread_.joinable ()) {
+	  thread_.interrupt ();
+	  thread_.join ();
+	}
+      }
+
+      bool GeometryLoader::ready () const
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	return pending_.empty () && building_.empty ();
+      }
+
+      void GeometryLoader::build (Callback_t callback)
+      {
+	std::string jointName;
+	try {
+	  while (true) {
+	    boost::this_thread::interruption_point ();
+	    UrdfLinkConstPtrType link;
+	    {
+	      boost::mutex::scoped_lock lock (mutex_);
+	      if (pending_.empty ()) break;
+	      jointName = pending_.begin ()->first;
+	      link = pending_.begin ()->second;
+	      pending_.erase (pending_.begin ());
+	      building_.insert (jointName);
+	    }
+	    // Parser::createGeometry is thread safe.
+	    Parser::CollisionGeometries_t geometry =
+	      urdfParser_.createGeometry (link);
+	    {
+	      boost::mutex::scoped_lock lock (mutex_);
+	      building_.erase (jointName);
+	      built_ [jointName] = Geometry_t (link, geometry);
+	    }
+	    condition_.notify_all ();
+	  }
+	} catch (const boost::thread_interrupted&) {
+	  return;
+	} catch (...) {
+	  hppDout (error, "Failed to build geometry of joint " << jointName);
+	  {
+	    boost::mutex::scoped_lock lock (mutex_);
+	    building_.erase (jointName);
+	  }
+	  condition_.notify_all ();
+	  promise_.set_exception (boost::current_exception ());
+	  return;
+	}
+	promise_.set_value ();
+	hppDout (notice, "Finished building collision geometries.");
+	if (callback) callback ();
+      }
+
+      void GeometryLoader::attach (const std::string& jointName,
+				   const Geometry_t& geometry)
+      {
+	urdfParser_.addGeometryToJoint (geometry.first,
+					urdfParser_.findJoint (jointName),
+					geometry.second);
+      }
+
+      void GeometryLoader::load (const std::string& jointName)
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	// Wait for the background thread if it is building this geometry.
+	while (building_.count (jointName)) condition_.wait (lock);
+
+	Geometries_t::iterator built = built_.find (jointName);
+	if (built != built_.end ()) {
+	  Geometry_t geometry = built->second;
+	  built_.erase (built);
+	  lock.unlock ();
+	  attach (jointName, geometry);
+	  return;
+	}
+	Links_t::iterator pending = pending_.find (jointName);
+	if (pending == pending_.end ()) {
+	  // Already added or without collision geometry.
+	  return;
+	}
+	UrdfLinkConstPtrType link = pending->second;
+	pending_.erase (pending);
+	lock.unlock ();
+	Parser::CollisionGeometries_t geometry;
+	try {
+	  geometry = urdfParser_.createGeometry (link);
+	} catch (...) {
+	  // Without background thread, the future reports the first error.
+	  if (!thread_.joinable () && !future_.is_ready ()) {
+	    promise_.set_exception (boost::current_exception ());
+	  }
+	  throw;
+	}
+	attach (jointName, Geometry_t (link, geometry));
+      }
+
+      void GeometryLoader::wait ()
+      {
+	if (boost::this_thread::get_id () == thread_.get_id ()) {
+	  throw std::runtime_error ("GeometryLoader::wait cannot be called"
+				    " by the callback");
+	}
+	if (done_) return;
+	if (thread_.joinable ()) {
+	  future_.get ();
+	  thread_.join ();
+	}
+	while (true) {
+	  std::string jointName;
+	  {
+	    boost::mutex::scoped_lock lock (mutex_);
+	    if (!built_.empty ()) jointName = built_.begin ()->first;
+	    else if (!pending_.empty ()) jointName = pending_.begin ()->first;
+	    else break;
+	  }
+	  load (jointName);
+	}
+	if (!future_.is_ready ()) promise_.set_value ();
+	urdfParser_.meshArena_->clear ();
+	urdfParser_.prefetcher_.reset ();
+	hppDout (notice, "Added collision geometries.");
+
+	// Set Collision Check Pairs
+	srdfParser_.parse (urdfPath_, srdfPath_, robot_);
+	hppDout (notice, "Finished parsing SRDF file.");
+	done_ = true;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -0,0 +1,484 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/http-fetcher.cc
+///
+/// \brief Implementation of concurrent retrieval of http resources.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/once.hpp>
+
+#include <curl/curl.h>
+
+#include <hpp/util/debug.hh>
+
+#include "http-fetcher.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	boost::once_flag curlInitialized = BOOST_ONCE_INIT;
+
+	void initializeCurl ()
+	{
+	  curl_global_init (CURL_GLOBAL_ALL);
+	}
+
+	boost::once_flag instanceCreated = BOOST_ONCE_INIT;
+	boost::scoped_ptr <HttpFetcher> sharedFetcher;
+
+	std::string defaultCacheDirectory ()
+	{
+	  if (const char* cache = std::getenv ("HPP_MODEL_URDF_HTTP_CACHE")) {
+	    return cache;
+	  }
+	  if (const char* cache = std::getenv ("XDG_CACHE_HOME")) {
+	    return std::string (cache) + "/hpp-model-urdf/http";
+	  }
+	  if (const char* home = std::getenv ("HOME")) {
+	    return std::string (home) + "/.cache/hpp-model-urdf/http";
+	  }
+	  return std::string ();
+	}
+
+	void createSharedFetcher ()
+	{
+	  sharedFetcher.reset (new HttpFetcher (defaultCacheDirectory ()));
+	}
+
+	/// Create directory and its parents.
+	/// \return false if the directory does not exist afterwards.
+	bool makeDirectories (const std::string& path)
+	{
+	  for (std::size_t end = path.find ('/', 1); ;
+	       end = path.find ('/', end + 1)) {
+	    std::string directory = path.substr (0, end);
+	    if (mkdir (directory.c_str (), 0755) != 0 && errno != EEXIST) {
+	      return false;
+	    }
+	    if (end == std::string::npos) break;
+	  }
+	  struct stat status;
+	  return stat (path.c_str (), &status) == 0 &&
+	    S_ISDIR (status.st_mode);
+	}
+
+	/// Name of the cache entry of a resource, FNV-1a hash of its uri.
+	std::string cacheKey (const std::string& uri)
+	{
+	  unsigned long long hash = 14695981039346656037ULL;
+	  for (std::size_t i = 0; i < uri.size (); ++i) {
+	    hash ^= (unsigned char) uri [i];
+	    hash *= 1099511628211ULL;
+	  }
+	  char key [17];
+	  std::sprintf (key, "%016llx", hash);
+	  return key;
+	}
+
+	/// Validators of a cached resource.
+	struct CacheEntry
+	{
+	  std::string uri;
+	  std::string etag;
+	  std::string lastModified;
+	};
+
+	bool readCacheEntry (const std::string& path, CacheEntry& entry)
+	{
+	  std::ifstream file ((path + ".meta").c_str ());
+	  return std::getline (file, entry.uri) &&
+	    std::getline (file, entry.etag) &&
+	    std::getline (file, entry.lastModified);
+	}
+
+	/// Write file atomically, so that other processes never read a
+	/// partial file.
+	bool writeFile (const std::string& path, const char* data,
+			std::size_t size)
+	{
+	  std::ostringstream tmp;
+	  tmp << path << ".tmp." << getpid ();
+	  FILE* file = std::fopen (tmp.str ().c_str (), "wb");
+	  if (!file) return false;
+	  bool written = std::fwrite (data, 1, size, file) == size;
+	  written = std::fclose (file) == 0 && written;
+	  if (!written || std::rename (tmp.str ().c_str (), path.c_str ())) {
+	    std::remove (tmp.str ().c_str ());
+	    return false;
+	  }
+	  return true;
+	}
+
+	/// Store a resource and its validators. The content is written
+	/// first, so that validators never describe another content.
+	void writeCacheEntry (const std::string& path, const CacheEntry& entry,
+			      const std::string& content)
+	{
+	  std::string meta = entry.uri + '\n' + entry.etag + '\n' +
+	    entry.lastModified + '\n';
+	  if (!writeFile (path, content.data (), content.size ()) ||
+	      !writeFile (path + ".meta", meta.data (), meta.size ())) {
+	    hppDout (error, "Failed to cache " << entry.uri << " in " << path);
+	  }
+	}
+
+	/// Remove leading and trailing white spaces.
+	std::string trim (const std::string& s)
+	{
+	  std::size_t begin = s.find_first_not_of (" \t\r\n");
+	  if (begin == std::string::npos) return std::string ();
+	  std::size_t end = s.find_last_not_of (" \t\r\n");
+	  return s.substr (begin, end - begin + 1);
+	}
+
+	bool startsWithNoCase (const char* s, std::size_t n, const char* prefix)
+	{
+	  std::size_t length = std::strlen (prefix);
+	  return n >= length && strncasecmp (s, prefix, length) == 0;
+	}
+
+	bool storeResult (const std::string&, const Resource& resource,
+			  const std::string& error, Resource& result,
+			  std::string& resultError)
+	{
+	  result = resource;
+	  resultError = error;
+	  return true;
+	}
+      } // end of anonymous namespace.
+
+      struct HttpFetcher::Transfer
+      {
+	Transfer () : easy (0), headers (0), body (), received (),
+		      cachePath (), cached (false)
+	{
+	  error [0] = 0;
+	}
+
+	std::string uri;
+	CURL* easy;
+	curl_slist* headers;
+	boost::shared_ptr <std::string> body;
+	/// Validators of the response.
+	CacheEntry received;
+	/// Path of the cache entry, empty if resources are not cached.
+	std::string cachePath;
+	/// Whether validators of a cached resource were sent.
+	bool cached;
+	char error [CURL_ERROR_SIZE];
+
+	static size_t writeBody (char* data, size_t size, size_t n,
+				 void* transfer)
+	{
+	  static_cast <Transfer*> (transfer)->body->append (data, size * n);
+	  return size * n;
+	}
+
+	static size_t writeHeader (char* data, size_t size, size_t n,
+				   void* userData)
+	{
+	  Transfer* transfer = static_cast <Transfer*> (userData);
+	  std::size_t length = size * n;
+	  // Headers of all the responses are received when redirections
+	  // are followed, only those of the last one are kept.
+	  if (startsWithNoCase (data, length, "HTTP/")) {
+	    transfer->received.etag.clear ();
+	    transfer->received.lastModified.clear ();
+	    transfer->body->clear ();
+	  } else if (startsWithNoCase (data, length, "ETag:")) {
+	    transfer->received.etag = trim (std::string (data + 5, length - 5));
+	  } else if (startsWithNoCase (data, length, "Last-Modified:")) {
+	    transfer->received.lastModified =
+	      trim (std::string (data + 14, length - 14));
+	  }
+	  return length;
+	}
+
+	/// Release libcurl handles.
+	void release (CURLM* multi)
+	{
+	  if (easy) {
+	    curl_multi_remove_handle (multi, easy);
+	    curl_easy_cleanup (easy);
+	    easy = 0;
+	  }
+	  curl_slist_free_all (headers);
+	  headers = 0;
+	}
+      }; // struct HttpFetcher::Transfer
+
+      /// Data shared by the transfers of all the calls.
+      struct HttpFetcher::Share
+      {
+	Share () : handle (0)
+	{}
+
+	CURLSH* handle;
+	/// One mutex per type of shared data.
+	boost::mutex mutexes [CURL_LOCK_DATA_LAST];
+
+	static void lock (CURL*, curl_lock_data data, curl_lock_access,
+			  void* share)
+	{
+	  static_cast <Share*> (share)->mutexes [data].lock ();
+	}
+
+	static void unlock (CURL*, curl_lock_data data, void* share)
+	{
+	  static_cast <Share*> (share)->mutexes [data].unlock ();
+	}
+      }; // struct HttpFetcher::Share
+
+      HttpFetcher::HttpFetcher (const std::string& cacheDirectory,
+				std::size_t maxConnections)
+	: cacheDirectory_ (cacheDirectory), maxConnections_ (maxConnections),
+	  share_ (new Share ()), statistics_ (), mutex_ ()
+      {
+	boost::call_once (curlInitialized, initializeCurl);
+	if (!cacheDirectory_.empty () && !makeDirectories (cacheDirectory_)) {
+	  hppDout (error, "Failed to create http cache " << cacheDirectory_
+		   << ", resources are not cached");
+	  cacheDirectory_.clear ();
+	}
+	CURLSH* share = curl_share_init ();
+	if (!share) {
+	  throw std::runtime_error ("Failed to initialize libcurl");
+	}
+	share_->handle = share;
+	curl_share_setopt (share, CURLSHOPT_LOCKFUNC, &Share::lock);
+	curl_share_setopt (share, CURLSHOPT_UNLOCKFUNC, &Share::unlock);
+	curl_share_setopt (share, CURLSHOPT_USERDATA, share_.get ());
+	curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	// Keep connections open between calls.
+	curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif // LIBCURL_VERSION_NUM >= 0x073900
+      }
+
+      const long HttpFetcher::connectTimeout;
+      const long HttpFetcher::lowSpeedLimit;
+      const long HttpFetcher::lowSpeedTime;
+
+      HttpFetcher::~HttpFetcher ()
+      {
+	curl_share_cleanup (share_->handle);
+      }
+
+      HttpFetcher& HttpFetcher::instance ()
+      {
+	boost::call_once (instanceCreated, createSharedFetcher);
+	return *sharedFetcher;
+      }
+
+      bool HttpFetcher::isHttp (const std::string& uri)
+      {
+	return uri.compare (0, 7, "http://") == 0 ||
+	  uri.compare (0, 8, "https://") == 0;
+      }
+
+      void HttpFetcher::start (Transfer& transfer, void* multi)
+      {
+	transfer.body.reset (new std::string ());
+	transfer.easy = curl_easy_init ();
+	if (!transfer.easy) {
+	  throw std::runtime_error ("Failed to initialize libcurl");
+	}
+	CURL* easy = transfer.easy;
+	curl_easy_setopt (easy, CURLOPT_URL, transfer.uri.c_str ());
+	curl_easy_setopt (easy, CURLOPT_PRIVATE, &transfer);
+	curl_easy_setopt (easy, CURLOPT_SHARE, share_->handle);
+	curl_easy_setopt (easy, CURLOPT_ERRORBUFFER, transfer.error);
+	curl_easy_setopt (easy, CURLOPT_WRITEFUNCTION, &Transfer::writeBody);
+	curl_easy_setopt (easy, CURLOPT_WRITEDATA, &transfer);
+	curl_easy_setopt (easy, CURLOPT_HEADERFUNCTION,
+			  &Transfer::writeHeader);
+	curl_easy_setopt (easy, CURLOPT_HEADERDATA, &transfer);
+	curl_easy_setopt (easy, CURLOPT_FOLLOWLOCATION, 1L);
+	// Signals cannot be used in threads.
+	curl_easy_setopt (easy, CURLOPT_NOSIGNAL, 1L);
+	// Unreachable or stalled servers do not block the fetch.
+	curl_easy_setopt (easy, CURLOPT_CONNECTTIMEOUT, connectTimeout);
+	curl_easy_setopt (easy, CURLOPT_LOW_SPEED_LIMIT, lowSpeedLimit);
+	curl_easy_setopt (easy, CURLOPT_LOW_SPEED_TIME, lowSpeedTime);
+
+	transfer.received.uri = transfer.uri;
+	if (!cacheDirectory_.empty ()) {
+	  transfer.cachePath = cacheDirectory_ + '/' + cacheKey (transfer.uri);
+	  CacheEntry entry;
+	  if (readCacheEntry (transfer.cachePath, entry) &&
+	      entry.uri == transfer.uri) {
+	    if (!entry.etag.empty ()) {
+	      transfer.headers = curl_slist_append
+		(transfer.headers, ("If-None-Match: " + entry.etag).c_str ());
+	    }
+	    if (!entry.lastModified.empty ()) {
+	      transfer.headers = curl_slist_append
+		(transfer.headers,
+		 ("If-Modified-Since: " + entry.lastModified).c_str ());
+	    }
+	    transfer.cached = transfer.headers != 0;
+	    curl_easy_setopt (easy, CURLOPT_HTTPHEADER, transfer.headers);
+	  }
+	}
+	curl_multi_add_handle (multi, easy);
+      }
+
+      void HttpFetcher::finish (Transfer& transfer, void* multi, int code,
+				Resource& resource, std::string& error)
+      {
+	long status = 0;
+	long connections = 0;
+	curl_easy_getinfo (transfer.easy, CURLINFO_RESPONSE_CODE, &status);
+	curl_easy_getinfo (transfer.easy, CURLINFO_NUM_CONNECTS, &connections);
+	transfer.release (multi);
+	bool notModified = code == CURLE_OK && status == 304 && transfer.cached;
+	{
+	  boost::mutex::scoped_lock lock (mutex_);
+	  ++statistics_.requests;
+	  statistics_.connections += connections;
+	  statistics_.bytes += transfer.body->size ();
+	  if (notModified) ++statistics_.notModified;
+	}
+
+	if (code != CURLE_OK) {
+	  error = "Failed to retrieve " + transfer.uri + ": " +
+	    (transfer.error [0] ? transfer.error :
+	     curl_easy_strerror (CURLcode (code)));
+	} else if (notModified) {
+	  try {
+	    resource = mapFile (transfer.cachePath);
+	  } catch (const std::exception& e) {
+	    error = "Failed to read cached " + transfer.uri + ": " + e.what ();
+	  }
+	} else if (status >= 200 && status < 300) {
+	  const std::string& body = *transfer.body;
+	  if (!transfer.cachePath.empty () &&
+	      (!transfer.received.etag.empty () ||
+	       !transfer.received.lastModified.empty ())) {
+	    writeCacheEntry (transfer.cachePath, transfer.received, body);
+	  }
+	  resource = Resource (reinterpret_cast <const uint8_t*> (body.data ()),
+			       body.size (), transfer.body);
+	} else {
+	  std::ostringstream message;
+	  message << "Failed to retrieve " << transfer.uri << ": HTTP status "
+		  << status;
+	  error = message.str ();
+	}
+      }
+
+      void HttpFetcher::fetch (const std::vector <std::string>& uris,
+			       const Callback_t& callback, const Stop_t& stop)
+      {
+	// Each call has its own multi handle, so that calls of several
+	// threads do not wait for each other. Connections are kept by
+	// share_.
+	CURLM* multi = curl_multi_init ();
+	if (!multi) {
+	  throw std::runtime_error ("Failed to initialize libcurl");
+	}
+	curl_multi_setopt (multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			   long (maxConnections_));
+#ifdef CURLPIPE_MULTIPLEX
+	curl_multi_setopt (multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif // CURLPIPE_MULTIPLEX
+	// Transfers are referenced by libcurl, the vector is never
+	// resized.
+	std::vector <Transfer> transfers (uris.size ());
+	try {
+	  for (std::size_t i = 0; i < uris.size (); ++i) {
+	    transfers [i].uri = uris [i];
+	    start (transfers [i], multi);
+	  }
+	  bool stopped = false;
+	  int running = 1;
+	  while (!stopped) {
+	    curl_multi_perform (multi, &running);
+	    int left;
+	    while (CURLMsg* message = curl_multi_info_read (multi, &left)) {
+	      if (message->msg != CURLMSG_DONE) continue;
+	      char* data;
+	      curl_easy_getinfo (message->easy_handle, CURLINFO_PRIVATE, &data);
+	      Transfer& transfer = *reinterpret_cast <Transfer*> (data);
+	      Resource resource;
+	      std::string error;
+	      // The message is released with the handle.
+	      finish (transfer, multi, message->data.result, resource, error);
+	      if (!callback (transfer.uri, resource, error)) {
+		stopped = true;
+		break;
+	      }
+	    }
+	    if (running == 0 || (stop && stop ())) break;
+	    curl_multi_wait (multi, 0, 0, 100, 0);
+	  }
+	} catch (...) {
+	  for (std::size_t i = 0; i < transfers.size (); ++i) {
+	    transfers [i].release (multi);
+	  }
+	  curl_multi_cleanup (multi);
+	  throw;
+	}
+	// Release aborted transfers.
+	for (std::size_t i = 0; i < transfers.size (); ++i) {
+	  transfers [i].release (multi);
+	}
+	curl_multi_cleanup (multi);
+	hppDout (info, "Fetched " << uris.size () << " http resources");
+      }
+
+      Resource HttpFetcher::fetch (const std::string& uri)
+      {
+	Resource resource;
+	std::string error;
+	fetch (std::vector <std::string> (1, uri),
+	       boost::bind (&storeResult, _1, _2, _3, boost::ref (resource),
+			    boost::ref (error)));
+	if (!error.empty ()) throw std::runtime_error (error);
+	return resource;
+      }
+
+      HttpFetcher::Statistics HttpFetcher::statistics () const
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	return statistics_;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
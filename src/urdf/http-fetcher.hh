@@ -0,0 +1,160 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/http-fetcher.hh
+///
+/// \brief Concurrent retrieval of http resources.
+
+#ifndef HPP_MODEL_URDF_HTTP_FETCHER
+# define HPP_MODEL_URDF_HTTP_FETCHER
+
+# include <string>
+# include <vector>
+
+# include <boost/function.hpp>
+# include <boost/scoped_ptr.hpp>
+# include <boost/thread/mutex.hpp>
+
+# include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Retrieve http and https resources with libcurl.
+      ///
+      /// Transfers of a call are performed concurrently by a libcurl
+      /// multi handle. Connections are kept open between calls, so that
+      /// successive resources of a server reuse the same connections.
+      ///
+      /// Responses carrying an ETag or Last-Modified header are stored in
+      /// a cache directory. Cached resources are revalidated by
+      /// conditional requests and read from the cache when the server
+      /// answers 304 Not Modified.
+      /// \note Thread safe, calls of several threads run concurrently.
+      ///       Connections are shared between calls with libcurl 7.57 or
+      ///       later.
+      class HttpFetcher
+      {
+      public:
+	/// \brief Function called when a transfer completes.
+	///
+	/// \param uri resource name,
+	/// \param resource bytes of the resource, empty on failure,
+	/// \param error empty on success.
+	/// \return false to abort the remaining transfers.
+	typedef boost::function <bool (const std::string& uri,
+				       const Resource& resource,
+				       const std::string& error)> Callback_t;
+
+	/// \brief Function polled while transfers are running.
+	///
+	/// \return true to abort the remaining transfers.
+	typedef boost::function <bool ()> Stop_t;
+
+	/// \brief Counters of the transfers performed since creation.
+	struct Statistics
+	{
+	  Statistics () : requests (0), notModified (0), connections (0),
+			  bytes (0)
+	  {}
+
+	  /// Requests sent.
+	  std::size_t requests;
+	  /// Resources read from the cache after revalidation.
+	  std::size_t notModified;
+	  /// Connections opened.
+	  std::size_t connections;
+	  /// Bytes of response bodies received.
+	  std::size_t bytes;
+	}; // struct Statistics
+
+	/// \param cacheDirectory directory of cached resources, created
+	///        if needed. Resources are not cached if empty.
+	/// \param maxConnections maximum number of concurrent connections
+	///        to a host opened by a call.
+	HttpFetcher (const std::string& cacheDirectory,
+		     std::size_t maxConnections = 8);
+
+	~HttpFetcher ();
+
+	/// \brief Fetcher shared by the parsers.
+	///
+	/// Resources are cached in $HPP_MODEL_URDF_HTTP_CACHE if set,
+	/// in the hpp-model-urdf/http directory of $XDG_CACHE_HOME or
+	/// $HOME/.cache otherwise.
+	static HttpFetcher& instance ();
+
+	/// \brief Whether uri uses the http or https scheme.
+	static bool isHttp (const std::string& uri);
+
+	/// \brief Retrieve resources concurrently.
+	///
+	/// Returns once callback has been called for every resource, or
+	/// once it returned false, or once stop returned true.
+	/// \param uris resource names, without duplicates,
+	/// \param stop polled at least every 100 milliseconds, so that
+	///        slow transfers can be aborted before any of them
+	///        completes. Never stops if empty.
+	/// \note Connections time out after connectTimeout seconds,
+	///       transfers after lowSpeedTime seconds below lowSpeedLimit
+	///       bytes per second.
+	void fetch (const std::vector <std::string>& uris,
+		    const Callback_t& callback, const Stop_t& stop = Stop_t ());
+
+	/// \brief Retrieve a resource.
+	///
+	/// \throw std::runtime_error if the resource cannot be retrieved.
+	Resource fetch (const std::string& uri);
+
+	Statistics statistics () const;
+
+	/// Seconds allowed to connect to a server.
+	static const long connectTimeout = 10;
+	/// Transfers slower than lowSpeedLimit bytes per second during
+	/// lowSpeedTime seconds are aborted.
+	static const long lowSpeedLimit = 1024;
+	static const long lowSpeedTime = 30;
+
+      private:
+	struct Transfer;
+	struct Share;
+
+	HttpFetcher (const HttpFetcher&);
+	HttpFetcher& operator= (const HttpFetcher&);
+
+	/// Add a transfer to a libcurl multi handle.
+	void start (Transfer& transfer, void* multi);
+	void finish (Transfer& transfer, void* multi, int code,
+		     Resource& resource, std::string& error);
+
+	std::string cacheDirectory_;
+	std::size_t maxConnections_;
+	/// libcurl share handle, kept for its connection cache.
+	boost::scoped_ptr <Share> share_;
+	Statistics statistics_;
+	/// Protects statistics_.
+	mutable boost::mutex mutex_;
+      }; // class HttpFetcher
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_HTTP_FETCHER
@@ -0,0 +1,260 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/memory-footprint.cc
+///
+/// \brief Implementation of memory footprint report.
+
+#include <algorithm>
+#include <ostream>
+#include <set>
+
+#include <hpp/fcl/BV/BV.h>
+#include <hpp/fcl/BVH/BVH_model.h>
+#include <hpp/fcl/collision_object.h>
+#include <hpp/fcl/shape/geometric_shapes.h>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/memory-footprint.hh>
+
+#include "shared-mesh-store.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	template <typename BV>
+	void bvhFootprint (const fcl::CollisionGeometry* geometry,
+			   GeometryFootprint& footprint)
+	{
+	  const fcl::BVHModel <BV>* model =
+	    static_cast <const fcl::BVHModel <BV>*> (geometry);
+	  footprint.vertices = model->num_vertices;
+	  footprint.triangles = model->num_tris;
+	  footprint.boundingVolumes = model->getNumBVs ();
+	  footprint.vertexBytes = model->num_vertices * sizeof (fcl::Vec3f);
+	  footprint.triangleBytes = model->num_tris * sizeof (fcl::Triangle);
+	  // Nodes and one primitive index per triangle.
+	  footprint.bvhBytes = model->getNumBVs () * sizeof (fcl::BVNode <BV>)
+	    + model->num_tris * sizeof (unsigned int);
+	  footprint.objectBytes = sizeof (fcl::BVHModel <BV>);
+	}
+
+	void geometryFootprint (const fcl::CollisionGeometry* geometry,
+				GeometryFootprint& footprint)
+	{
+	  switch (geometry->getNodeType ()) {
+	  case fcl::BV_AABB:
+	    bvhFootprint <fcl::AABB> (geometry, footprint);
+	    break;
+	  case fcl::BV_OBB:
+	    bvhFootprint <fcl::OBB> (geometry, footprint);
+	    break;
+	  case fcl::BV_RSS:
+	    bvhFootprint <fcl::RSS> (geometry, footprint);
+	    break;
+	  case fcl::BV_kIOS:
+	    bvhFootprint <fcl::kIOS> (geometry, footprint);
+	    break;
+	  case fcl::BV_OBBRSS:
+	    bvhFootprint <fcl::OBBRSS> (geometry, footprint);
+	    break;
+	  case fcl::GEOM_BOX:
+	    footprint.objectBytes = sizeof (fcl::Box);
+	    break;
+	  case fcl::GEOM_SPHERE:
+	    footprint.objectBytes = sizeof (fcl::Sphere);
+	    break;
+	  case fcl::GEOM_CAPSULE:
+	    footprint.objectBytes = sizeof (fcl::Capsule);
+	    break;
+	  case fcl::GEOM_CYLINDER:
+	    footprint.objectBytes = sizeof (fcl::Cylinder);
+	    break;
+	  default:
+	    footprint.objectBytes = sizeof (fcl::CollisionGeometry);
+	  }
+	}
+
+	bool moreBytes (const GeometryFootprint& a, const GeometryFootprint& b)
+	{
+	  return a.bytes () > b.bytes ();
+	}
+
+	/// Bytes of a list of collision pairs.
+	std::size_t pairBytes (const CollisionPairs_t& pairs)
+	{
+	  // Each element of a std::list holds two pointers to its
+	  // neighbours.
+	  return pairs.size () *
+	    (sizeof (CollisionPair_t) + 2 * sizeof (void*));
+	}
+      } // end of anonymous namespace.
+
+      GeometryFootprint::GeometryFootprint ()
+	: name (), body (), vertices (0), triangles (0), boundingVolumes (0),
+	  vertexBytes (0), triangleBytes (0), bvhBytes (0), objectBytes (0),
+	  shared (false), sharedMesh (false), sharedMeshBytes (0)
+      {}
+
+      std::size_t GeometryFootprint::bytes () const
+      {
+	return vertexBytes + triangleBytes + bvhBytes + objectBytes;
+      }
+
+      BodyFootprint::BodyFootprint ()
+	: name (), objects (0), bytes (0)
+      {}
+
+      MemoryFootprint::MemoryFootprint ()
+	: geometries (), bodies (), collisionPairs (0), distancePairs (0),
+	  pairBytes (0), vertices (0), triangles (0), boundingVolumes (0),
+	  geometryBytes (0), sharedVertices (0), sharedTriangles (0),
+	  sharedMeshBytes (0)
+      {}
+
+      std::size_t MemoryFootprint::bytes () const
+      {
+	return geometryBytes + pairBytes;
+      }
+
+      std::vector <GeometryFootprint> MemoryFootprint::largest
+      (std::size_t n) const
+      {
+	std::vector <GeometryFootprint> result;
+	for (std::vector <GeometryFootprint>::const_iterator it =
+	       geometries.begin (); it != geometries.end (); ++it) {
+	  if (!it->shared) result.push_back (*it);
+	}
+	n = std::min (n, result.size ());
+	std::partial_sort (result.begin (), result.begin () + n,
+			   result.end (), moreBytes);
+	result.resize (n);
+	return result;
+      }
+
+      MemoryFootprint memoryFootprint (const DevicePtr_t& robot)
+      {
+	MemoryFootprint footprint;
+	std::set <const CollisionObject*> objects;
+	std::set <const fcl::CollisionGeometry*> geometries;
+	std::set <const fcl::Vec3f*> sharedMeshes;
+	const Request_t requests [] = { COLLISION, DISTANCE };
+
+	const JointVector_t& joints = robot->getJointVector ();
+	for (JointVector_t::const_iterator itJoint = joints.begin ();
+	     itJoint != joints.end (); ++itJoint) {
+	  Body* body = (*itJoint)->linkedBody ();
+	  if (!body) continue;
+	  BodyFootprint bodyFootprint;
+	  bodyFootprint.name = body->name ();
+	  for (std::size_t r = 0; r < 2; ++r) {
+	    const ObjectVector_t& inner = body->innerObjects (requests [r]);
+	    for (ObjectVector_t::const_iterator it = inner.begin ();
+		 it != inner.end (); ++it) {
+	      if (!objects.insert (it->get ()).second) continue;
+	      const fcl::CollisionGeometry* geometry =
+		(*it)->fcl ()->collisionGeometry ().get ();
+	      GeometryFootprint object;
+	      object.name = (*it)->name ();
+	      object.body = body->name ();
+	      object.shared = !geometries.insert (geometry).second;
+	      geometryFootprint (geometry, object);
+	      SharedMesh mesh;
+	      if (sharedPolyhedronMesh (geometry, mesh)) {
+		object.sharedMesh = true;
+		object.sharedMeshBytes = object.vertexBytes +
+		  object.triangleBytes;
+		object.vertexBytes = 0;
+		object.triangleBytes = 0;
+	      }
+	      ++bodyFootprint.objects;
+	      if (!object.shared) {
+		bodyFootprint.bytes += object.bytes ();
+		if (!object.sharedMesh) {
+		  footprint.vertices += object.vertices;
+		  footprint.triangles += object.triangles;
+		} else if (sharedMeshes.insert (mesh.vertices).second) {
+		  // Meshes stored under one key are mapped by several
+		  // geometries.
+		  footprint.sharedVertices += object.vertices;
+		  footprint.sharedTriangles += object.triangles;
+		  footprint.sharedMeshBytes += object.sharedMeshBytes;
+		}
+		footprint.boundingVolumes += object.boundingVolumes;
+		footprint.geometryBytes += object.bytes ();
+	      }
+	      footprint.geometries.push_back (object);
+	    }
+	  }
+	  footprint.bodies.push_back (bodyFootprint);
+	}
+
+	const CollisionPairs_t& collisionPairs =
+	  robot->collisionPairs (COLLISION);
+	const CollisionPairs_t& distancePairs =
+	  robot->collisionPairs (DISTANCE);
+	footprint.collisionPairs = collisionPairs.size ();
+	footprint.distancePairs = distancePairs.size ();
+	footprint.pairBytes = pairBytes (collisionPairs) +
+	  pairBytes (distancePairs);
+	return footprint;
+      }
+
+      std::ostream& operator<< (std::ostream& os,
+				const MemoryFootprint& footprint)
+      {
+	os << "Total: " << footprint.bytes () << " bytes" << std::endl
+	   << "Geometries: " << footprint.geometryBytes << " bytes, "
+	   << footprint.vertices << " vertices, "
+	   << footprint.triangles << " triangles, "
+	   << footprint.boundingVolumes << " bounding volumes" << std::endl
+	   << "Shared meshes: " << footprint.sharedMeshBytes << " bytes, "
+	   << footprint.sharedVertices << " vertices, "
+	   << footprint.sharedTriangles << " triangles" << std::endl
+	   << "Pairs: " << footprint.pairBytes << " bytes, "
+	   << footprint.collisionPairs << " collision pairs, "
+	   << footprint.distancePairs << " distance pairs" << std::endl
+	   << "Bodies:" << std::endl;
+	for (std::vector <BodyFootprint>::const_iterator it =
+	       footprint.bodies.begin (); it != footprint.bodies.end ();
+	     ++it) {
+	  os << "  " << it->name << ": " << it->bytes << " bytes, "
+	     << it->objects << " objects" << std::endl;
+	}
+	std::vector <GeometryFootprint> largest = footprint.largest (10);
+	os << "Largest geometries:" << std::endl;
+	for (std::vector <GeometryFootprint>::const_iterator it =
+	       largest.begin (); it != largest.end (); ++it) {
+	  os << "  " << it->name << " (" << it->body << "): "
+	     << it->bytes () << " bytes, " << it->vertices << " vertices, "
+	     << it->triangles << " triangles, " << it->boundingVolumes
+	     << " bounding volumes" << std::endl;
+	}
+	return os;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -0,0 +1,278 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/mesh-reader.cc
+///
+/// \brief Implementation of STL and OBJ readers.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "mesh.hh"
+#include "mesh-reader.hh"
+#include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	bool hasExtension (const std::string& name, const char* extension)
+	{
+	  std::size_t n = std::strlen (extension);
+	  if (name.size () < n) return false;
+	  for (std::size_t i = 0; i < n; ++i) {
+	    if (std::tolower (name [name.size () - n + i]) != extension [i])
+	      return false;
+	  }
+	  return true;
+	}
+
+	std::runtime_error error (const std::string& resourceName,
+				  const std::string& message)
+	{
+	  return std::runtime_error ("Failed to read mesh " + resourceName +
+				     ": " + message);
+	}
+
+	/// Whitespace separated tokens of a range of characters.
+	class Tokenizer
+	{
+	public:
+	  Tokenizer (const char* begin, const char* end)
+	    : current_ (begin), end_ (end), token_ (begin), tokenEnd_ (begin)
+	  {}
+
+	  /// Move to next token, return false at end of range.
+	  bool next ()
+	  {
+	    while (current_ != end_ &&
+		   std::isspace (static_cast <unsigned char> (*current_)))
+	      ++current_;
+	    if (current_ == end_) return false;
+	    token_ = current_;
+	    while (current_ != end_ &&
+		   !std::isspace (static_cast <unsigned char> (*current_)))
+	      ++current_;
+	    tokenEnd_ = current_;
+	    return true;
+	  }
+
+	  /// Whether current token is word.
+	  bool is (const char* word) const
+	  {
+	    std::size_t n = std::strlen (word);
+	    return std::size_t (tokenEnd_ - token_) == n &&
+	      std::strncmp (token_, word, n) == 0;
+	  }
+
+	  /// Move to next token and read it as a number.
+	  bool nextDouble (double& value)
+	  {
+	    if (!next ()) return false;
+	    char buffer [64];
+	    if (!copy (buffer, sizeof (buffer))) return false;
+	    char* end;
+	    value = std::strtod (buffer, &end);
+	    return end != buffer && *end == '\0';
+	  }
+
+	  /// Read leading integer of current token, "12/3/4" gives 12.
+	  bool index (long& value) const
+	  {
+	    char buffer [64];
+	    if (!copy (buffer, sizeof (buffer))) return false;
+	    char* end;
+	    value = std::strtol (buffer, &end, 10);
+	    return end != buffer && (*end == '\0' || *end == '/');
+	  }
+
+	private:
+	  /// Copy current token as a null terminated string.
+	  bool copy (char* buffer, std::size_t size) const
+	  {
+	    std::size_t n = tokenEnd_ - token_;
+	    if (n >= size) return false;
+	    std::memcpy (buffer, token_, n);
+	    buffer [n] = '\0';
+	    return true;
+	  }
+
+	  const char* current_;
+	  const char* end_;
+	  const char* token_;
+	  const char* tokenEnd_;
+	}; // class Tokenizer
+
+	fcl::Vec3f scaled (double x, double y, double z,
+			   const ::urdf::Vector3& scale)
+	{
+	  return fcl::Vec3f (x * scale.x, y * scale.y, z * scale.z);
+	}
+
+	/// STL files are little endian whatever the host.
+	uint32_t readUint32 (const uint8_t* p)
+	{
+	  return uint32_t (p [0]) | uint32_t (p [1]) << 8 |
+	    uint32_t (p [2]) << 16 | uint32_t (p [3]) << 24;
+	}
+
+	float readFloat (const uint8_t* p)
+	{
+	  uint32_t bits = readUint32 (p);
+	  float value;
+	  std::memcpy (&value, &bits, sizeof (value));
+	  return value;
+	}
+
+	/// Binary STL: 80 bytes header, number of facets on 4 bytes, then
+	/// 50 bytes per facet (normal, 3 vertices, attribute). Some writers
+	/// append bytes after the last facet.
+	bool isBinaryStl (const Resource& resource)
+	{
+	  if (resource.size () < 84) return false;
+	  return (resource.size () - 84) / 50 >=
+	    std::size_t (readUint32 (resource.data () + 80));
+	}
+
+	void readBinaryStl (const Resource& resource,
+			    const ::urdf::Vector3& scale, MeshBuffers& mesh)
+	{
+	  const std::size_t n = readUint32 (resource.data () + 80);
+	  const std::size_t first = mesh.vertices.size ();
+	  mesh.reserve (mesh.vertices, first + 3 * n);
+	  mesh.reserve (mesh.triangles, mesh.triangles.size () + n);
+	  const uint8_t* facet = resource.data () + 84;
+	  for (std::size_t i = 0; i < n; ++i, facet += 50) {
+	    // Skip normal.
+	    const uint8_t* p = facet + 12;
+	    for (int j = 0; j < 3; ++j, p += 12) {
+	      mesh.vertices.push_back (scaled (readFloat (p), readFloat (p + 4),
+					       readFloat (p + 8), scale));
+	    }
+	    mesh.triangles.push_back (fcl::Triangle (first + 3 * i,
+						     first + 3 * i + 1,
+						     first + 3 * i + 2));
+	  }
+	}
+
+	void readAsciiStl (const std::string& resourceName,
+			   const char* begin, const char* end,
+			   const ::urdf::Vector3& scale, MeshBuffers& mesh)
+	{
+	  Tokenizer tokens (begin, end);
+	  std::size_t nbVertices = 0;
+	  while (tokens.next ()) {
+	    if (!tokens.is ("vertex")) continue;
+	    double x, y, z;
+	    if (!tokens.nextDouble (x) || !tokens.nextDouble (y) ||
+		!tokens.nextDouble (z)) {
+	      throw error (resourceName, "invalid vertex");
+	    }
+	    mesh.append (mesh.vertices, scaled (x, y, z, scale));
+	    if (++nbVertices % 3 == 0) {
+	      std::size_t i = mesh.vertices.size ();
+	      mesh.append (mesh.triangles, fcl::Triangle (i - 3, i - 2, i - 1));
+	    }
+	  }
+	  if (nbVertices % 3 != 0) {
+	    throw error (resourceName, "facet with less than 3 vertices");
+	  }
+	}
+
+	void readObj (const std::string& resourceName,
+		      const char* begin, const char* end,
+		      const ::urdf::Vector3& scale, MeshBuffers& mesh)
+	{
+	  const std::size_t first = mesh.vertices.size ();
+	  // Vertices of the current face. The welding index is free until
+	  // the mesh is welded.
+	  std::vector <std::size_t>& face = mesh.index;
+	  const char* line = begin;
+	  while (line != end) {
+	    const char* lineEnd = std::find (line, end, '\n');
+	    Tokenizer tokens (line, lineEnd);
+	    line = lineEnd == end ? end : lineEnd + 1;
+	    if (!tokens.next ()) continue;
+	    if (tokens.is ("v")) {
+	      double x, y, z;
+	      if (!tokens.nextDouble (x) || !tokens.nextDouble (y) ||
+		  !tokens.nextDouble (z)) {
+		throw error (resourceName, "invalid vertex");
+	      }
+	      mesh.append (mesh.vertices, scaled (x, y, z, scale));
+	    } else if (tokens.is ("f")) {
+	      face.clear ();
+	      const long nbVertices = mesh.vertices.size () - first;
+	      while (tokens.next ()) {
+		long i;
+		if (!tokens.index (i) || i == 0) {
+		  throw error (resourceName, "invalid face");
+		}
+		// Negative indices are relative to the last vertex.
+		long k = i > 0 ? i - 1 : nbVertices + i;
+		if (k < 0 || k >= nbVertices) {
+		  throw error (resourceName, "vertex index out of range");
+		}
+		mesh.append (face, first + k);
+	      }
+	      for (std::size_t j = 2; j < face.size (); ++j) {
+		mesh.append (mesh.triangles,
+			     fcl::Triangle (face [0], face [j - 1], face [j]));
+	      }
+	    }
+	  }
+	}
+      } // end of anonymous namespace.
+
+      bool isNativeMeshFormat (const std::string& resourceName)
+      {
+	return hasExtension (resourceName, ".stl") ||
+	  hasExtension (resourceName, ".obj");
+      }
+
+      void readMesh (const std::string& resourceName, const Resource& resource,
+		     const ::urdf::Vector3& scale, MeshBuffers& mesh)
+      {
+	const char* begin = reinterpret_cast <const char*> (resource.data ());
+	const char* end = begin + resource.size ();
+	if (hasExtension (resourceName, ".stl")) {
+	  // ASCII files start with "solid", but so do some binary files.
+	  if (isBinaryStl (resource)) {
+	    readBinaryStl (resource, scale, mesh);
+	  } else if (resource.size () >= 5 &&
+		     std::strncmp (begin, "solid", 5) == 0) {
+	    readAsciiStl (resourceName, begin, end, scale, mesh);
+	  } else {
+	    throw error (resourceName, "invalid STL file");
+	  }
+	} else if (hasExtension (resourceName, ".obj")) {
+	  readObj (resourceName, begin, end, scale, mesh);
+	} else {
+	  throw error (resourceName, "unsupported format");
+	}
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
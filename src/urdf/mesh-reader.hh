@@ -0,0 +1,66 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/mesh-reader.hh
+///
+/// \brief Readers of simple mesh formats that do not use assimp.
+
+#ifndef HPP_MODEL_URDF_MESH_READER
+# define HPP_MODEL_URDF_MESH_READER
+
+# include <string>
+
+# include <urdf/model.h>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      struct MeshBuffers;
+      class Resource;
+
+      /// \brief Whether a mesh format is read by readMesh.
+      ///
+      /// The format is deduced from the extension of the resource name:
+      /// .stl (binary or ASCII) and .obj (Wavefront), in any case.
+      bool isNativeMeshFormat (const std::string& resourceName);
+
+      /// \brief Read a mesh without assimp.
+      ///
+      /// Vertices and triangles are appended to mesh.vertices and
+      /// mesh.triangles, vertices being scaled. Polygonal faces of OBJ
+      /// files are split in triangle fans, points and lines are
+      /// ignored. Duplicate vertices, as found in every STL file, are
+      /// kept: they are merged by weldMesh.
+      ///
+      /// \param resourceName name of the resource, used for the format and
+      ///        error messages,
+      /// \param resource bytes of the resource,
+      /// \param scale scale along each axis,
+      /// \retval mesh buffers to fill.
+      /// \throw std::runtime_error if the resource is not well formed.
+      /// \pre isNativeMeshFormat (resourceName)
+      void readMesh (const std::string& resourceName, const Resource& resource,
+		     const ::urdf::Vector3& scale, MeshBuffers& mesh);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_MESH_READER
@@ -0,0 +1,241 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/mesh-split.cc
+///
+/// \brief Spatial split of meshes and concurrent construction of their
+/// bounding volume hierarchies.
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <hpp/util/debug.hh>
+
+#include "mesh.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Sum of the vertices of a triangle, three times its centroid.
+	struct Centroid
+	{
+	  fcl::Vec3f point;
+	  std::size_t triangle;
+	};
+
+	struct CompareAlong
+	{
+	  explicit CompareAlong (std::size_t axis) : axis (axis)
+	  {}
+
+	  bool operator() (const Centroid& c1, const Centroid& c2) const
+	  {
+	    return c1.point [axis] < c2.point [axis];
+	  }
+
+	  std::size_t axis;
+	};
+
+	/// Centroids [begin, end) to split into nbChunks chunks.
+	struct Range
+	{
+	  Range (std::size_t begin, std::size_t end, std::size_t nbChunks)
+	    : begin (begin), end (end), nbChunks (nbChunks)
+	  {}
+
+	  std::size_t begin;
+	  std::size_t end;
+	  std::size_t nbChunks;
+	};
+
+	/// Axis of largest extent of centroids [begin, end).
+	std::size_t largestAxis (const std::vector <Centroid>& centroids,
+				 std::size_t begin, std::size_t end)
+	{
+	  double lower [3], upper [3];
+	  for (std::size_t k = 0; k < 3; ++k) {
+	    lower [k] = upper [k] = centroids [begin].point [k];
+	  }
+	  for (std::size_t i = begin + 1; i < end; ++i) {
+	    for (std::size_t k = 0; k < 3; ++k) {
+	      lower [k] = std::min (lower [k], centroids [i].point [k]);
+	      upper [k] = std::max (upper [k], centroids [i].point [k]);
+	    }
+	  }
+	  std::size_t axis = 0;
+	  for (std::size_t k = 1; k < 3; ++k) {
+	    if (upper [k] - lower [k] > upper [axis] - lower [axis]) axis = k;
+	  }
+	  return axis;
+	}
+
+	/// Threads building polyhedra take chunks in turn.
+	class PolyhedraBuilder
+	{
+	public:
+	  PolyhedraBuilder (fcl::NODE_TYPE type, const MeshChunks_t& chunks,
+			    std::vector <fcl::CollisionGeometryPtr_t>&
+			    geometries)
+	    : type_ (type), chunks_ (chunks), geometries_ (geometries),
+	      next_ (0), error_ (), mutex_ ()
+	  {}
+
+	  void run ()
+	  {
+	    while (true) {
+	      std::size_t i;
+	      {
+		boost::mutex::scoped_lock lock (mutex_);
+		if (!error_.empty () || next_ == chunks_.size ()) return;
+		i = next_++;
+	      }
+	      try {
+		// Each thread writes its own elements.
+		const MeshChunk& chunk = chunks_ [i];
+		geometries_ [i] = createPolyhedron (type_, chunk.vertices,
+						    chunk.triangles);
+	      } catch (const std::exception& e) {
+		boost::mutex::scoped_lock lock (mutex_);
+		if (error_.empty ()) error_ = e.what ();
+	      }
+	    }
+	  }
+
+	  const std::string& error () const
+	  {
+	    return error_;
+	  }
+
+	private:
+	  fcl::NODE_TYPE type_;
+	  const MeshChunks_t& chunks_;
+	  std::vector <fcl::CollisionGeometryPtr_t>& geometries_;
+	  std::size_t next_;
+	  std::string error_;
+	  boost::mutex mutex_;
+	}; // class PolyhedraBuilder
+      } // end of anonymous namespace.
+
+      void splitMesh (const std::vector <fcl::Vec3f>& vertices,
+		      const std::vector <fcl::Triangle>& triangles,
+		      std::size_t nbChunks, MeshChunks_t& chunks)
+      {
+	chunks.clear ();
+	if (triangles.empty ()) return;
+	nbChunks = std::max <std::size_t>
+	  (1, std::min (nbChunks, triangles.size ()));
+
+	std::vector <Centroid> centroids (triangles.size ());
+	for (std::size_t i = 0; i < triangles.size (); ++i) {
+	  const fcl::Triangle& t = triangles [i];
+	  centroids [i].point = vertices [t [0]] + vertices [t [1]] +
+	    vertices [t [2]];
+	  centroids [i].triangle = i;
+	}
+
+	// Ranges are split depth first, left part first, so that
+	// neighbouring chunks are consecutive.
+	std::vector <Range> ranges;
+	std::vector <Range> stack;
+	stack.push_back (Range (0, centroids.size (), nbChunks));
+	while (!stack.empty ()) {
+	  Range range = stack.back ();
+	  stack.pop_back ();
+	  if (range.nbChunks == 1) {
+	    ranges.push_back (range);
+	    continue;
+	  }
+	  std::size_t left = range.nbChunks / 2;
+	  std::size_t middle = range.begin +
+	    (range.end - range.begin) * left / range.nbChunks;
+	  std::nth_element (centroids.begin () + range.begin,
+			    centroids.begin () + middle,
+			    centroids.begin () + range.end,
+			    CompareAlong (largestAxis (centroids, range.begin,
+						       range.end)));
+	  stack.push_back (Range (middle, range.end, range.nbChunks - left));
+	  stack.push_back (Range (range.begin, middle, left));
+	}
+
+	// Index of vertices in the current chunk.
+	const std::size_t unused = std::numeric_limits <std::size_t>::max ();
+	std::vector <std::size_t> index (vertices.size (), unused);
+	std::vector <std::size_t> used;
+	chunks.resize (ranges.size ());
+	for (std::size_t c = 0; c < ranges.size (); ++c) {
+	  MeshChunk& chunk = chunks [c];
+	  chunk.triangles.reserve (ranges [c].end - ranges [c].begin);
+	  used.clear ();
+	  for (std::size_t i = ranges [c].begin; i < ranges [c].end; ++i) {
+	    const fcl::Triangle& t = triangles [centroids [i].triangle];
+	    std::size_t local [3];
+	    for (std::size_t k = 0; k < 3; ++k) {
+	      std::size_t v = t [k];
+	      if (index [v] == unused) {
+		index [v] = chunk.vertices.size ();
+		chunk.vertices.push_back (vertices [v]);
+		used.push_back (v);
+	      }
+	      local [k] = index [v];
+	    }
+	    chunk.triangles.push_back (fcl::Triangle (local [0], local [1],
+						      local [2]));
+	  }
+	  for (std::size_t i = 0; i < used.size (); ++i) {
+	    index [used [i]] = unused;
+	  }
+	}
+      }
+
+      std::vector <fcl::CollisionGeometryPtr_t> createPolyhedra
+      (fcl::NODE_TYPE type, const MeshChunks_t& chunks,
+       std::size_t nbThreads)
+      {
+	if (nbThreads == 0) nbThreads = boost::thread::hardware_concurrency ();
+	nbThreads = std::max <std::size_t>
+	  (1, std::min (nbThreads, chunks.size ()));
+
+	std::vector <fcl::CollisionGeometryPtr_t> geometries (chunks.size ());
+	PolyhedraBuilder builder (type, chunks, geometries);
+	boost::thread_group threads;
+	for (std::size_t i = 1; i < nbThreads; ++i) {
+	  threads.create_thread (boost::bind (&PolyhedraBuilder::run,
+					      &builder));
+	}
+	builder.run ();
+	threads.join_all ();
+	if (!builder.error ().empty ()) {
+	  throw std::runtime_error (builder.error ());
+	}
+	hppDout (info, "Built " << chunks.size () << " polyhedra on "
+		 << nbThreads << " threads");
+	return geometries;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -0,0 +1,441 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/mesh.cc
+///
+/// \brief Implementation of mesh processing.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <assimp/assimp.hpp>
+#include <assimp/aiScene.h>
+#include <assimp/aiPostProcess.h>
+
+#include <hpp/util/debug.hh>
+
+#include "mesh.hh"
+#include "mesh-reader.hh"
+#include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Cell of the hash grid.
+	struct Cell
+	{
+	  long x, y, z;
+
+	  Cell (long cx, long cy, long cz) : x (cx), y (cy), z (cz)
+	  {}
+
+	  bool operator== (const Cell& other) const
+	  {
+	    return x == other.x && y == other.y && z == other.z;
+	  }
+	}; // struct Cell
+
+	std::size_t hash_value (const Cell& cell)
+	{
+	  std::size_t seed = 0;
+	  boost::hash_combine (seed, cell.x);
+	  boost::hash_combine (seed, cell.y);
+	  boost::hash_combine (seed, cell.z);
+	  return seed;
+	}
+
+	/// Vertex indices of a triangle, rotated so that the smallest comes
+	/// first. The orientation of the triangle is kept, so that a
+	/// triangle and its reversed twin differ.
+	struct RotatedTriangle
+	{
+	  std::size_t i [3];
+
+	  RotatedTriangle (std::size_t a, std::size_t b, std::size_t c)
+	  {
+	    i [0] = a; i [1] = b; i [2] = c;
+	    std::rotate (i, std::min_element (i, i + 3), i + 3);
+	  }
+
+	  bool operator== (const RotatedTriangle& other) const
+	  {
+	    return i [0] == other.i [0] && i [1] == other.i [1] &&
+	      i [2] == other.i [2];
+	  }
+	}; // struct RotatedTriangle
+
+	std::size_t hash_value (const RotatedTriangle& triangle)
+	{
+	  return boost::hash_range (triangle.i, triangle.i + 3);
+	}
+
+	typedef boost::unordered_map <Cell, std::vector <std::size_t> >
+	Grid_t;
+
+	long coordinate (double x, double tolerance)
+	{
+	  return static_cast <long> (std::floor (x / tolerance));
+	}
+
+	/// Count meshes, vertices and faces of a node and its descendants.
+	void countMesh (const aiScene* scene, const aiNode* node,
+			std::size_t& meshes, std::size_t& vertices,
+			std::size_t& faces)
+	{
+	  if (!node) return;
+	  for (uint32_t i = 0; i < node->mNumMeshes; i++) {
+	    aiMesh* input_mesh = scene->mMeshes[node->mMeshes[i]];
+	    ++meshes;
+	    vertices += input_mesh->mNumVertices;
+	    faces += input_mesh->mNumFaces;
+	  }
+	  for (uint32_t i=0; i < node->mNumChildren; ++i) {
+	    countMesh (scene, node->mChildren[i], meshes, vertices, faces);
+	  }
+	}
+
+	void buildMesh (const ::urdf::Vector3& scale,
+			const aiScene* scene,
+			const aiNode* node,
+			std::vector<unsigned>& subMeshIndexes,
+			MeshBuffers& mesh)
+	{
+	  if (!node) return;
+
+	  aiMatrix4x4 transform = node->mTransformation;
+	  aiNode *pnode = node->mParent;
+	  while (pnode)
+	    {
+	      // Don't convert to y-up orientation, which is what the root
+	      // node in Assimp does
+	      if (pnode->mParent != NULL)
+		transform = pnode->mTransformation * transform;
+	      pnode = pnode->mParent;
+	    }
+
+	  for (uint32_t i = 0; i < node->mNumMeshes; i++) {
+	    aiMesh* input_mesh = scene->mMeshes[node->mMeshes[i]];
+
+	    unsigned oldNbPoints = mesh.vertices.size ();
+	    unsigned oldNbTriangles = mesh.triangles.size ();
+
+	    // Add the vertices
+	    for (uint32_t j = 0; j < input_mesh->mNumVertices; j++) {
+	      aiVector3D p = input_mesh->mVertices[j];
+	      p *= transform;
+	      mesh.vertices.push_back (fcl::Vec3f (p.x * scale.x,
+						   p.y * scale.y,
+						   p.z * scale.z));
+	    }
+
+	    // add the indices
+	    for (uint32_t j = 0; j < input_mesh->mNumFaces; j++) {
+	      aiFace& face = input_mesh->mFaces[j];
+	      // FIXME: can add only triangular faces.
+	      mesh.triangles.push_back (fcl::Triangle
+					(oldNbPoints + face.mIndices[0],
+					 oldNbPoints + face.mIndices[1],
+					 oldNbPoints + face.mIndices[2]));
+	    }
+
+	    // Save submesh triangles indexes interval.
+	    if (subMeshIndexes.size () == 0)
+	      subMeshIndexes.push_back (0);
+
+	    subMeshIndexes.push_back (oldNbTriangles + input_mesh->mNumFaces);
+	  }
+
+	  for (uint32_t i=0; i < node->mNumChildren; ++i) {
+	    buildMesh(scale, scene, node->mChildren[i], subMeshIndexes, mesh);
+	  }
+	}
+
+	void importMesh (const std::string& resourceName,
+			 const ::urdf::Vector3& scale,
+			 const ResourceResolver_t& resolver, MeshBuffers& mesh,
+			 Parser::MeshStatistics& statistics)
+	{
+	  if (!mesh.importer) {
+	    mesh.importer.reset (new Assimp::Importer ());
+	    mesh.importer->SetIOHandler (new ResourceIOSystem ());
+	    ++mesh.importers;
+	  }
+	  Assimp::Importer& importer = *mesh.importer;
+	  ResourceIOSystem& ioSystem =
+	    *static_cast <ResourceIOSystem*> (importer.GetIOHandler ());
+	  ioSystem.resolver (resolver);
+	  ioSystem.resetStatistics ();
+	  // Assimp deduces the format from the name, compressed resources
+	  // are opened under their uncompressed name.
+	  std::string name = uncompressedName (resourceName);
+	  ioSystem.alias (name == resourceName ? std::string () : name,
+			  resourceName);
+	  const aiScene* scene = importer.ReadFile
+	    (name, aiProcess_SortByPType|
+	     aiProcess_GenNormals|aiProcess_Triangulate|aiProcess_GenUVCoords|
+	     aiProcess_FlipUVs);
+	  if (!scene) {
+	    throw std::runtime_error (std::string ("Could not load resource ") +
+				      resourceName + std::string ("\n") +
+				      importer.GetErrorString ());
+	  }
+	  if (!scene->HasMeshes())
+	    {
+	      throw std::runtime_error (std::string ("No meshes found in file ")+
+					resourceName);
+	    }
+
+	  // Size buffers once so that flattening does not reallocate.
+	  std::size_t nbMeshes = 0, nbVertices = 0, nbFaces = 0;
+	  countMesh (scene, scene->mRootNode, nbMeshes, nbVertices, nbFaces);
+	  mesh.reserve (mesh.vertices, nbVertices);
+	  mesh.reserve (mesh.triangles, nbFaces);
+	  mesh.reserve (mesh.subMeshIndexes, nbMeshes + 1);
+	  buildMesh (scale, scene, scene->mRootNode, mesh.subMeshIndexes, mesh);
+	  // The importer is kept for the next mesh, not the scene.
+	  importer.FreeScene ();
+	  statistics.storedBytes = ioSystem.storedBytes ();
+	  statistics.bytes = ioSystem.bytes ();
+	}
+      } // end of anonymous namespace.
+
+      void loadMesh (const std::string& resourceName,
+		     const ::urdf::Vector3& scale, double weldTolerance,
+		     bool nativeReaders, MeshBuffers& mesh,
+		     Parser::MeshStatistics& statistics,
+		     const ResourceResolver_t& resolver)
+      {
+	mesh.vertices.clear ();
+	mesh.triangles.clear ();
+	mesh.subMeshIndexes.clear ();
+	std::string name = uncompressedName (resourceName);
+	bool imported = false;
+	if (nativeReaders && isNativeMeshFormat (name)) {
+	  Resource resource = retrieveResource (resourceName, resolver);
+	  statistics.storedBytes = resource.storedSize ();
+	  statistics.bytes = resource.size ();
+	  try {
+	    readMesh (name, resource, scale, mesh);
+	    imported = !mesh.triangles.empty ();
+	  } catch (const std::runtime_error& exc) {
+	    // Files the native readers reject may still be read by assimp.
+	    hppDout (notice, exc.what () << ", using assimp");
+	  }
+	  if (!imported) {
+	    mesh.vertices.clear ();
+	    mesh.triangles.clear ();
+	  }
+	}
+	if (!imported) {
+	  importMesh (resourceName, scale, resolver, mesh, statistics);
+	}
+
+	statistics.resource = resourceName;
+	statistics.originalVertices = mesh.vertices.size ();
+	statistics.originalTriangles = mesh.triangles.size ();
+	weldMesh (mesh, weldTolerance);
+	statistics.vertices = mesh.vertices.size ();
+	statistics.triangles = mesh.triangles.size ();
+	hppDout (info, "Mesh " << resourceName << ": "
+		 << statistics.originalVertices << " -> "
+		 << statistics.vertices << " vertices, "
+		 << statistics.originalTriangles << " -> "
+		 << statistics.triangles << " triangles, "
+		 << statistics.storedBytes << " bytes read, "
+		 << statistics.bytes << " bytes decompressed");
+      }
+
+      void weldMesh (MeshBuffers& mesh, double tolerance)
+      {
+	if (tolerance <= 0) return;
+	const double squaredTolerance = tolerance * tolerance;
+	std::vector <fcl::Vec3f>& vertices = mesh.vertices;
+	std::vector <fcl::Triangle>& triangles = mesh.triangles;
+	std::vector <fcl::Vec3f>& welded = mesh.welded;
+	std::vector <std::size_t>& index = mesh.index;
+
+	// Merge vertices. A vertex closer than tolerance to another one
+	// lies in the same cell or in one of the 26 neighbouring cells.
+	Grid_t grid;
+	welded.clear ();
+	mesh.reserve (welded, vertices.size ());
+	mesh.reserve (index, vertices.size ());
+	index.resize (vertices.size ());
+	for (std::size_t k = 0; k < vertices.size (); ++k) {
+	  const fcl::Vec3f& v = vertices [k];
+	  long x = coordinate (v [0], tolerance);
+	  long y = coordinate (v [1], tolerance);
+	  long z = coordinate (v [2], tolerance);
+	  std::size_t found = std::numeric_limits <std::size_t>::max ();
+	  for (long dx = -1; dx <= 1; ++dx) {
+	    for (long dy = -1; dy <= 1; ++dy) {
+	      for (long dz = -1; dz <= 1; ++dz) {
+		Grid_t::const_iterator cell =
+		  grid.find (Cell (x + dx, y + dy, z + dz));
+		if (cell == grid.end ()) continue;
+		for (std::vector <std::size_t>::const_iterator it =
+		       cell->second.begin (); it != cell->second.end ();
+		     ++it) {
+		  if (*it < found &&
+		      (welded [*it] - v).sqrLength () <= squaredTolerance) {
+		    found = *it;
+		  }
+		}
+	      }
+	    }
+	  }
+	  if (found == std::numeric_limits <std::size_t>::max ()) {
+	    found = welded.size ();
+	    grid [Cell (x, y, z)].push_back (found);
+	    welded.push_back (v);
+	  }
+	  index [k] = found;
+	}
+
+	// Remove degenerate and duplicate triangles.
+	const double squaredArea = squaredTolerance * squaredTolerance;
+	boost::unordered_set <RotatedTriangle> known;
+	std::vector <fcl::Triangle>& kept = mesh.kept;
+	kept.clear ();
+	mesh.reserve (kept, triangles.size ());
+	for (std::vector <fcl::Triangle>::const_iterator it =
+	       triangles.begin (); it != triangles.end (); ++it) {
+	  std::size_t a = index [(*it) [0]];
+	  std::size_t b = index [(*it) [1]];
+	  std::size_t c = index [(*it) [2]];
+	  if (a == b || b == c || c == a) continue;
+	  if ((welded [b] - welded [a]).cross
+	      (welded [c] - welded [a]).sqrLength () <= squaredArea) continue;
+	  if (!known.insert (RotatedTriangle (a, b, c)).second) continue;
+	  kept.push_back (fcl::Triangle (a, b, c));
+	}
+
+	// Remove unused vertices, index now maps welded vertices to
+	// remaining ones.
+	const std::size_t unused = std::numeric_limits <std::size_t>::max ();
+	index.assign (welded.size (), unused);
+	vertices.clear ();
+	for (std::vector <fcl::Triangle>::iterator it = kept.begin ();
+	     it != kept.end (); ++it) {
+	  for (int i = 0; i < 3; ++i) {
+	    std::size_t& u = index [(*it) [i]];
+	    if (u == unused) {
+	      u = vertices.size ();
+	      vertices.push_back (welded [(*it) [i]]);
+	    }
+	    (*it) [i] = u;
+	  }
+	}
+	triangles.swap (kept);
+      }
+
+      MeshBuffers::MeshBuffers ()
+	: vertices (), triangles (), subMeshIndexes (), welded (), index (),
+	  kept (), importer (), allocations (0), importers (0),
+	  releasedBytes (0)
+      {}
+
+      std::size_t MeshBuffers::bytes () const
+      {
+	return (vertices.capacity () + welded.capacity ()) *
+	  sizeof (fcl::Vec3f) +
+	  (triangles.capacity () + kept.capacity ()) * sizeof (fcl::Triangle) +
+	  subMeshIndexes.capacity () * sizeof (unsigned) +
+	  index.capacity () * sizeof (std::size_t);
+      }
+
+      MeshArena::MeshArena ()
+	: mutex_ (), buffers_ (), free_ (), bytes_ (0), statistics_ ()
+      {
+	resetStatistics ();
+      }
+
+      MeshBuffers* MeshArena::acquire ()
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	++statistics_.meshes;
+	if (free_.empty ()) {
+	  buffers_.push_back (MeshBuffers ());
+	  return &buffers_.back ();
+	}
+	MeshBuffers* buffers = free_.back ();
+	free_.pop_back ();
+	return buffers;
+      }
+
+      void MeshArena::release (MeshBuffers* buffers)
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	statistics_.allocations += buffers->allocations;
+	buffers->allocations = 0;
+	statistics_.importers += buffers->importers;
+	buffers->importers = 0;
+	// Buffers in use by other threads are counted as of their last
+	// release.
+	std::size_t bytes = buffers->bytes ();
+	bytes_ = bytes_ + bytes - buffers->releasedBytes;
+	buffers->releasedBytes = bytes;
+	statistics_.peakBytes = std::max (statistics_.peakBytes, bytes_);
+	free_.push_back (buffers);
+      }
+
+      void MeshArena::clear ()
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	for (std::vector <MeshBuffers*>::const_iterator it = free_.begin ();
+	     it != free_.end (); ++it) {
+	  for (std::list <MeshBuffers>::iterator itBuffers =
+		 buffers_.begin (); itBuffers != buffers_.end (); ++itBuffers) {
+	    if (&*itBuffers == *it) {
+	      bytes_ -= itBuffers->releasedBytes;
+	      buffers_.erase (itBuffers);
+	      break;
+	    }
+	  }
+	}
+	free_.clear ();
+      }
+
+      void MeshArena::resetStatistics ()
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	statistics_.meshes = 0;
+	statistics_.allocations = 0;
+	statistics_.peakBytes = 0;
+	statistics_.importers = 0;
+      }
+
+      Parser::ScratchStatistics MeshArena::statistics () const
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	return statistics_;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
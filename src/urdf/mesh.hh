@@ -0,0 +1,268 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/mesh.hh
+///
+/// \brief Processing of flattened meshes before BVH construction.
+
+#ifndef HPP_MODEL_URDF_MESH
+# define HPP_MODEL_URDF_MESH
+
+# include <algorithm>
+# include <list>
+# include <string>
+# include <vector>
+
+# include <boost/shared_ptr.hpp>
+# include <boost/thread/mutex.hpp>
+
+# include <hpp/fcl/math.h>
+
+# include <hpp/model/urdf/parser.hh>
+
+namespace Assimp
+{
+  class Importer;
+} // end of namespace Assimp.
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Vertices and triangles of a flattened mesh and scratch
+      /// buffers used to build it.
+      ///
+      /// Buffers are used by one thread at a time, so that meshes can be
+      /// built concurrently. They are recycled by MeshArena. Each set of
+      /// buffers owns an assimp importer, so that there are as many
+      /// importers as threads building meshes at the same time, each
+      /// created once per load.
+      struct MeshBuffers
+      {
+	std::vector <fcl::Vec3f> vertices;
+	std::vector <fcl::Triangle> triangles;
+	/// Scratch buffers.
+	/// \{
+	std::vector <unsigned> subMeshIndexes;
+	std::vector <fcl::Vec3f> welded;
+	std::vector <std::size_t> index;
+	std::vector <fcl::Triangle> kept;
+	/// \}
+	/// Importer with a ResourceIOSystem attached, created on first
+	/// use. Importers are not thread safe, but buffers are only used
+	/// by one thread at a time.
+	boost::shared_ptr <Assimp::Importer> importer;
+	/// Number of times a buffer was allocated or grown since the
+	/// buffers were acquired.
+	std::size_t allocations;
+	/// Number of importers created since the buffers were acquired.
+	std::size_t importers;
+	/// Bytes allocated by the buffers when last given back to the
+	/// arena.
+	std::size_t releasedBytes;
+
+	MeshBuffers ();
+
+	/// Bytes allocated by the buffers.
+	std::size_t bytes () const;
+
+	/// Grow buffer if needed so that it can hold size elements.
+	template <typename T>
+	void reserve (std::vector <T>& buffer, std::size_t size)
+	{
+	  if (size > buffer.capacity ()) {
+	    buffer.reserve (size);
+	    ++allocations;
+	  }
+	}
+
+	/// Append an element, growing buffer geometrically if needed.
+	template <typename T>
+	void append (std::vector <T>& buffer, const T& value)
+	{
+	  if (buffer.size () == buffer.capacity ())
+	    reserve (buffer, std::max <std::size_t> (64, 2 * buffer.size ()));
+	  buffer.push_back (value);
+	}
+      }; // struct MeshBuffers
+
+      /// \brief Pool of mesh buffers reused across the meshes of a load.
+      ///
+      /// Buffers keep their capacity between meshes, so that importing a
+      /// mesh only allocates when it is larger than all previous ones.
+      /// \note Thread safe.
+      class MeshArena
+      {
+      public:
+	MeshArena ();
+
+	/// Get buffers, allocated if none is free.
+	MeshBuffers* acquire ();
+
+	/// Give buffers back to the arena.
+	void release (MeshBuffers* buffers);
+
+	/// Free buffers that are not in use.
+	void clear ();
+
+	/// Reset statistics.
+	void resetStatistics ();
+
+	Parser::ScratchStatistics statistics () const;
+
+      private:
+	mutable boost::mutex mutex_;
+	std::list <MeshBuffers> buffers_;
+	std::vector <MeshBuffers*> free_;
+	/// Bytes held by all buffers, as of their last release.
+	std::size_t bytes_;
+	Parser::ScratchStatistics statistics_;
+      }; // class MeshArena
+
+      /// \brief Buffers acquired from an arena for the life of the object.
+      class ScopedMeshBuffers
+      {
+      public:
+	explicit ScopedMeshBuffers (MeshArena& arena)
+	  : arena_ (arena), buffers_ (arena.acquire ())
+	{}
+
+	~ScopedMeshBuffers ()
+	{
+	  arena_.release (buffers_);
+	}
+
+	MeshBuffers& operator* () const
+	{
+	  return *buffers_;
+	}
+
+	MeshBuffers* operator-> () const
+	{
+	  return buffers_;
+	}
+
+      private:
+	ScopedMeshBuffers (const ScopedMeshBuffers&);
+	ScopedMeshBuffers& operator= (const ScopedMeshBuffers&);
+
+	MeshArena& arena_;
+	MeshBuffers* buffers_;
+      }; // class ScopedMeshBuffers
+
+      /// \brief Read a mesh resource, flatten and weld it.
+      ///
+      /// STL and OBJ files are read by readMesh if nativeReaders is set,
+      /// other formats, and files readMesh rejects or finds empty, are
+      /// imported by assimp. For scenes imported by
+      /// assimp, node transforms are applied, except the one of the root
+      /// node. Vertices are then scaled and welded by weldMesh.
+      ///
+      /// Resources compressed with gzip or zstd, named with a .gz or .zst
+      /// suffix, are decompressed by retrieveResource, the format being
+      /// deduced from the name without suffix.
+      /// \param resourceName resource name using the resource_retriever
+      ///        format,
+      /// \param scale scale along each axis,
+      /// \param weldTolerance see weldMesh,
+      /// \param nativeReaders whether to use readMesh for the formats it
+      ///        supports,
+      /// \retval mesh flattened mesh. Previous content is discarded.
+      /// \retval statistics size of the mesh before and after welding,
+      ///         bytes read and decompressed.
+      /// \param resolver resolver of the mesh resource and of the files
+      ///        it refers to, see retrieveResource.
+      /// \throw std::runtime_error if the resource cannot be read or
+      ///        contains no mesh.
+      void loadMesh (const std::string& resourceName,
+		     const ::urdf::Vector3& scale, double weldTolerance,
+		     bool nativeReaders, MeshBuffers& mesh,
+		     Parser::MeshStatistics& statistics,
+		     const ResourceResolver_t& resolver =
+		     ResourceResolver_t ());
+
+      /// \brief Weld coincident vertices and remove useless triangles.
+      ///
+      /// Vertices closer than tolerance are merged into the first of them.
+      /// Triangles that become degenerate (two identical indices or zero
+      /// area) and triangles using the same vertices in the same cyclic
+      /// order as a previous one are removed. A triangle and its reversed
+      /// twin are both kept, since they bound opposite sides. Vertices
+      /// that are not used by any remaining triangle are removed.
+      ///
+      /// Coincident vertices are found with a hash grid of cell size
+      /// tolerance, so that the cost is linear in the number of vertices.
+      ///
+      /// \param mesh mesh to weld, its scratch buffers are used.
+      /// \param tolerance distance below which vertices are merged. The
+      ///        mesh is left unchanged if tolerance is not positive.
+      void weldMesh (MeshBuffers& mesh, double tolerance);
+
+      /// \brief Build bounding volume hierarchy of a mesh.
+      ///
+      /// \param type one of fcl::BV_AABB, fcl::BV_OBB, fcl::BV_RSS,
+      ///        fcl::BV_kIOS, fcl::BV_OBBRSS.
+      /// \throw std::runtime_error for other types of bounding volume.
+      fcl::CollisionGeometryPtr_t createPolyhedron
+      (fcl::NODE_TYPE type, const std::vector <fcl::Vec3f>& vertices,
+       const std::vector <fcl::Triangle>& triangles);
+
+      /// \brief Vertices and triangles of a part of a mesh.
+      struct MeshChunk
+      {
+	std::vector <fcl::Vec3f> vertices;
+	std::vector <fcl::Triangle> triangles;
+      }; // struct MeshChunk
+
+      typedef std::vector <MeshChunk> MeshChunks_t;
+
+      /// \brief Split a mesh spatially into chunks.
+      ///
+      /// Triangles are split recursively at the median of their
+      /// centroids along the largest extent of the centroids, so that
+      /// chunks are compact and hold the same number of triangles up to
+      /// one. Each triangle belongs to exactly one chunk, so that an
+      /// object collides with one of the chunks if and only if it
+      /// collides with the mesh. Vertices are copied in every chunk
+      /// using them.
+      ///
+      /// \param nbChunks number of chunks, reduced to the number of
+      ///        triangles if larger,
+      /// \retval chunks chunks of the mesh. Previous content is
+      ///         discarded.
+      void splitMesh (const std::vector <fcl::Vec3f>& vertices,
+		      const std::vector <fcl::Triangle>& triangles,
+		      std::size_t nbChunks, MeshChunks_t& chunks);
+
+      /// \brief Build bounding volume hierarchies of chunks concurrently.
+      ///
+      /// \param type see createPolyhedron,
+      /// \param nbThreads number of threads, including the calling one,
+      ///        0 for the number of cores.
+      /// \return polyhedra in the order of the chunks.
+      /// \throw std::runtime_error if a hierarchy cannot be built.
+      std::vector <fcl::CollisionGeometryPtr_t> createPolyhedra
+      (fcl::NODE_TYPE type, const MeshChunks_t& chunks,
+       std::size_t nbThreads);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_MESH
@@ -0,0 +1,87 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/package.cc
+///
+/// \brief Implementation of package resolution.
+
+#include <boost/thread/mutex.hpp>
+
+#include <ros/package.h>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/urdf/package.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	boost::mutex packageMutex;
+	PackagePaths_t packageOverrides;
+	PackagePaths_t packageCache;
+      } // end of anonymous namespace.
+
+      std::string packagePath (const std::string& package)
+      {
+	{
+	  boost::mutex::scoped_lock lock (packageMutex);
+	  PackagePaths_t::const_iterator it = packageOverrides.find (package);
+	  if (it != packageOverrides.end ()) return it->second;
+	  it = packageCache.find (package);
+	  if (it != packageCache.end ()) return it->second;
+	}
+	// Look up outside the lock: rospack can take a while and other
+	// packages may be resolved meanwhile.
+	std::string path = ros::package::getPath (package);
+	hppDout (info, "package " << package << " found in " << path);
+	boost::mutex::scoped_lock lock (packageMutex);
+	packageCache [package] = path;
+	return path;
+      }
+
+      void setPackagePaths (const PackagePaths_t& paths)
+      {
+	boost::mutex::scoped_lock lock (packageMutex);
+	packageOverrides = paths;
+      }
+
+      void clearPackagePathCache ()
+      {
+	boost::mutex::scoped_lock lock (packageMutex);
+	packageCache.clear ();
+      }
+
+      std::string resolvePackageUri (const std::string& uri)
+      {
+	static const std::string package ("package://");
+
+	if (uri.compare (0, package.size (), package) != 0) return uri;
+	std::string::size_type slash = uri.find ('/', package.size ());
+	std::string path = packagePath
+	  (uri.substr (package.size (), slash - package.size ()));
+	if (path.empty ()) return uri;
+	if (slash != std::string::npos) path += uri.substr (slash);
+	return "file://" + path;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -0,0 +1,386 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/parser-environment.cc
+///
+/// \brief Loading of static scenes as merged obstacles.
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/foreach.hpp>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "mesh.hh"
+#include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Number of segments approximating circles of cylinders and
+	/// spheres.
+	const std::size_t circleSegments = 32;
+	/// Number of rings of spheres, poles excluded.
+	const std::size_t sphereRings = 16;
+
+	/// \brief Triangles of a collision geometry in world frame.
+	struct Piece
+	{
+	  std::vector <fcl::Vec3f> vertices;
+	  std::vector <fcl::Triangle> triangles;
+	  /// Center of the bounding box of the vertices.
+	  fcl::Vec3f center;
+	};
+
+	void addQuad (std::vector <fcl::Triangle>& triangles, std::size_t a,
+		      std::size_t b, std::size_t c, std::size_t d)
+	{
+	  triangles.push_back (fcl::Triangle (a, b, c));
+	  triangles.push_back (fcl::Triangle (a, c, d));
+	}
+
+	/// Box centered at the origin.
+	void tessellateBox (const ::urdf::Box& box, Piece& piece)
+	{
+	  // Bit k of the index of a vertex tells its side along axis k.
+	  for (std::size_t i = 0; i < 8; ++i) {
+	    piece.vertices.push_back
+	      (fcl::Vec3f ((i & 1 ? .5 : -.5) * box.dim.x,
+			   (i & 2 ? .5 : -.5) * box.dim.y,
+			   (i & 4 ? .5 : -.5) * box.dim.z));
+	  }
+	  addQuad (piece.triangles, 0, 4, 6, 2);
+	  addQuad (piece.triangles, 1, 3, 7, 5);
+	  addQuad (piece.triangles, 0, 1, 5, 4);
+	  addQuad (piece.triangles, 2, 6, 7, 3);
+	  addQuad (piece.triangles, 0, 2, 3, 1);
+	  addQuad (piece.triangles, 4, 5, 7, 6);
+	}
+
+	/// Closed cylinder centered at the origin, along z. The polygon
+	/// is circumscribed to the circle.
+	void tessellateCylinder (const ::urdf::Cylinder& cylinder,
+				 Piece& piece)
+	{
+	  const double pi = std::acos (-1.);
+	  const std::size_t n = circleSegments;
+	  double radius = cylinder.radius / std::cos (pi / n);
+	  double z = .5 * cylinder.length;
+	  for (std::size_t k = 0; k < 2 * n; ++k) {
+	    double phi = 2 * pi * (k % n) / n;
+	    piece.vertices.push_back
+	      (fcl::Vec3f (radius * std::cos (phi), radius * std::sin (phi),
+			   k < n ? -z : z));
+	  }
+	  piece.vertices.push_back (fcl::Vec3f (0, 0, -z));
+	  piece.vertices.push_back (fcl::Vec3f (0, 0, z));
+	  for (std::size_t k = 0; k < n; ++k) {
+	    std::size_t next = (k + 1) % n;
+	    addQuad (piece.triangles, k, next, n + next, n + k);
+	    piece.triangles.push_back (fcl::Triangle (2 * n, next, k));
+	    piece.triangles.push_back (fcl::Triangle (2 * n + 1, n + k,
+						      n + next));
+	  }
+	}
+
+	/// Sphere centered at the origin, made of rings between the poles.
+	/// Vertices are pushed out so that faces do not cut the sphere.
+	void tessellateSphere (const ::urdf::Sphere& sphere, Piece& piece)
+	{
+	  const double pi = std::acos (-1.);
+	  const std::size_t n = circleSegments, m = sphereRings;
+	  double radius = sphere.radius /
+	    (std::cos (pi / n) * std::cos (pi / (2 * m)));
+	  piece.vertices.push_back (fcl::Vec3f (0, 0, radius));
+	  for (std::size_t i = 1; i < m; ++i) {
+	    double theta = pi * i / m;
+	    for (std::size_t j = 0; j < n; ++j) {
+	      double phi = 2 * pi * j / n;
+	      piece.vertices.push_back
+		(fcl::Vec3f (radius * std::sin (theta) * std::cos (phi),
+			     radius * std::sin (theta) * std::sin (phi),
+			     radius * std::cos (theta)));
+	    }
+	  }
+	  piece.vertices.push_back (fcl::Vec3f (0, 0, -radius));
+	  const std::size_t south = piece.vertices.size () - 1;
+	  for (std::size_t j = 0; j < n; ++j) {
+	    std::size_t next = (j + 1) % n;
+	    piece.triangles.push_back (fcl::Triangle (0, 1 + j, 1 + next));
+	    for (std::size_t i = 1; i + 1 < m; ++i) {
+	      std::size_t ring = 1 + (i - 1) * n;
+	      addQuad (piece.triangles, ring + j, ring + n + j,
+		       ring + n + next, ring + next);
+	    }
+	    std::size_t ring = 1 + (m - 2) * n;
+	    piece.triangles.push_back (fcl::Triangle (south, ring + next,
+						      ring + j));
+	  }
+	}
+
+	/// Move vertices to world frame and compute the center of the
+	/// piece.
+	void transformPiece (const Transform3f& position, Piece& piece)
+	{
+	  if (piece.vertices.empty ()) return;
+	  fcl::Vec3f lower, upper;
+	  for (std::size_t i = 0; i < piece.vertices.size (); ++i) {
+	    piece.vertices [i] = position.transform (piece.vertices [i]);
+	    if (i == 0) {
+	      lower = upper = piece.vertices [0];
+	    } else {
+	      lower = fcl::min (lower, piece.vertices [i]);
+	      upper = fcl::max (upper, piece.vertices [i]);
+	    }
+	  }
+	  piece.center = (lower + upper) * .5;
+	}
+
+	/// Order pieces by position of their center along an axis.
+	struct CenterLess
+	{
+	  explicit CenterLess (int axis) : axis_ (axis)
+	  {}
+
+	  bool operator() (const Piece* a, const Piece* b) const
+	  {
+	    return a->center [axis_] < b->center [axis_];
+	  }
+
+	  int axis_;
+	}; // struct CenterLess
+
+	/// Sort pieces along the largest dimension of the box containing
+	/// their centers, so that consecutive pieces are close together.
+	void sortPieces (std::vector <const Piece*>& pieces)
+	{
+	  if (pieces.empty ()) return;
+	  fcl::Vec3f lower = pieces [0]->center, upper = pieces [0]->center;
+	  for (std::size_t i = 1; i < pieces.size (); ++i) {
+	    lower = fcl::min (lower, pieces [i]->center);
+	    upper = fcl::max (upper, pieces [i]->center);
+	  }
+	  fcl::Vec3f extent = upper - lower;
+	  int axis = 0;
+	  if (extent [1] > extent [axis]) axis = 1;
+	  if (extent [2] > extent [axis]) axis = 2;
+	  std::stable_sort (pieces.begin (), pieces.end (), CenterLess (axis));
+	}
+
+	void appendPiece (const Piece& piece,
+			  std::vector <fcl::Vec3f>& vertices,
+			  std::vector <fcl::Triangle>& triangles)
+	{
+	  std::size_t offset = vertices.size ();
+	  vertices.insert (vertices.end (), piece.vertices.begin (),
+			   piece.vertices.end ());
+	  for (std::size_t i = 0; i < piece.triangles.size (); ++i) {
+	    const fcl::Triangle& t = piece.triangles [i];
+	    triangles.push_back (fcl::Triangle (t [0] + offset, t [1] + offset,
+						t [2] + offset));
+	  }
+	}
+      } // end of anonymous namespace.
+
+      ObjectVector_t
+      Parser::parseEnvironment (const std::string& resourceName,
+				std::size_t maxTriangles)
+      {
+	hppDout (info, "resourceName: " << resourceName);
+	Resource resource = retrieveResource (resourceName);
+	std::string description
+	  (reinterpret_cast <const char*> (resource.data ()), resource.size ());
+	return parseEnvironmentString (description, maxTriangles);
+      }
+
+      ObjectVector_t
+      Parser::parseEnvironmentString (const std::string& description,
+				      std::size_t maxTriangles)
+      {
+	::urdf::Model model;
+	if (!model.initString (description)) {
+	  throw std::runtime_error ("Failed to parse environment. "
+				    "description:\n" + description);
+	}
+	meshStatistics_.clear ();
+	meshArena_->resetStatistics ();
+
+	// Collect the collision geometries of static links in world
+	// frame. Links to visit are stored with their position.
+	std::list <Piece> pieces;
+	std::size_t nbTriangles = 0;
+	MatrixHomogeneousType identity;
+	identity.setIdentity ();
+	std::vector <std::pair <UrdfLinkConstPtrType, MatrixHomogeneousType> >
+	  stack;
+	stack.push_back (std::make_pair (model.getRoot (), identity));
+	try {
+	  while (!stack.empty ()) {
+	    UrdfLinkConstPtrType link = stack.back ().first;
+	    MatrixHomogeneousType position = stack.back ().second;
+	    stack.pop_back ();
+
+	    std::vector <boost::shared_ptr < ::urdf::Collision> > collisions =
+	      link->collision_array;
+	    if (collisions.empty () && link->collision) {
+	      collisions.push_back (link->collision);
+	    }
+	    BOOST_FOREACH (const boost::shared_ptr < ::urdf::Collision>&
+			   collision, collisions) {
+	      if (!collision->geometry) continue;
+	      pieces.push_back (Piece ());
+	      Piece& piece = pieces.back ();
+	      switch (collision->geometry->type) {
+	      case ::urdf::Geometry::MESH:
+		{
+		  const ::urdf::Mesh& mesh =
+		    static_cast <const ::urdf::Mesh&> (*collision->geometry);
+		  ScopedMeshBuffers buffers (*meshArena_);
+		  loadMesh (mesh.filename, mesh.scale, *buffers);
+		  piece.vertices = buffers->vertices;
+		  piece.triangles = buffers->triangles;
+		}
+		break;
+	      case ::urdf::Geometry::BOX:
+		tessellateBox (static_cast <const ::urdf::Box&>
+			       (*collision->geometry), piece);
+		break;
+	      case ::urdf::Geometry::CYLINDER:
+		tessellateCylinder (static_cast <const ::urdf::Cylinder&>
+				    (*collision->geometry), piece);
+		break;
+	      case ::urdf::Geometry::SPHERE:
+		tessellateSphere (static_cast <const ::urdf::Sphere&>
+				  (*collision->geometry), piece);
+		break;
+	      default:
+		hppDout (error, "Unsupported geometry type in link "
+			 << link->name);
+		pieces.pop_back ();
+		continue;
+	      }
+	      transformPiece (position * poseToMatrix (collision->origin),
+			      piece);
+	      nbTriangles += piece.triangles.size ();
+	    }
+
+	    BOOST_FOREACH (const UrdfJointPtrType& joint, link->child_joints) {
+	      if (joint->type != ::urdf::Joint::FIXED) {
+		hppDout (notice, "Skipping link " << joint->child_link_name
+			 << " attached by non fixed joint " << joint->name);
+		continue;
+	      }
+	      UrdfLinkConstPtrType child =
+		model.getLink (joint->child_link_name);
+	      if (!child) continue;
+	      stack.push_back (std::make_pair
+			       (child, position * poseToMatrix
+				(joint->parent_to_joint_origin_transform)));
+	    }
+	  }
+	} catch (...) {
+	  meshArena_->clear ();
+	  throw;
+	}
+	// Mesh buffers are not needed anymore.
+	meshArena_->clear ();
+
+	std::vector <const Piece*> order;
+	order.reserve (pieces.size ());
+	BOOST_FOREACH (const Piece& piece, pieces) {
+	  if (!piece.triangles.empty ()) order.push_back (&piece);
+	}
+	bool split = maxTriangles != 0 && nbTriangles > maxTriangles;
+	if (split) sortPieces (order);
+
+	// Group consecutive pieces into polyhedra of at most maxTriangles
+	// triangles. groups holds the index in order of the first piece of
+	// each group, followed by the number of pieces, groupTriangles the
+	// number of triangles of each group.
+	std::vector <std::size_t> groups;
+	std::vector <std::size_t> groupTriangles;
+	for (std::size_t i = 0; i < order.size (); ++i) {
+	  std::size_t n = order [i]->triangles.size ();
+	  if (groups.empty () ||
+	      (split && groupTriangles.back () + n > maxTriangles)) {
+	    groups.push_back (i);
+	    groupTriangles.push_back (0);
+	  }
+	  groupTriangles.back () += n;
+	}
+	groups.push_back (order.size ());
+
+	// Groups larger than allowed by splitMeshes are split as well.
+	// Chunks are swapped into place, the vector is never reallocated.
+	std::size_t nbChunks = 0;
+	for (std::size_t g = 0; g < groupTriangles.size (); ++g) {
+	  nbChunks += meshChunks (groupTriangles [g]);
+	}
+	MeshChunks_t chunks;
+	chunks.reserve (nbChunks);
+	for (std::size_t g = 0; g + 1 < groups.size (); ++g) {
+	  MeshChunks_t parts (1);
+	  for (std::size_t i = groups [g]; i < groups [g + 1]; ++i) {
+	    appendPiece (*order [i], parts [0].vertices, parts [0].triangles);
+	  }
+	  std::size_t groupChunks = meshChunks (parts [0].triangles.size ());
+	  if (groupChunks > 1) {
+	    MeshChunk group;
+	    group.vertices.swap (parts [0].vertices);
+	    group.triangles.swap (parts [0].triangles);
+	    splitMesh (group.vertices, group.triangles, groupChunks, parts);
+	  }
+	  for (std::size_t i = 0; i < parts.size (); ++i) {
+	    chunks.push_back (MeshChunk ());
+	    chunks.back ().vertices.swap (parts [i].vertices);
+	    chunks.back ().triangles.swap (parts [i].triangles);
+	  }
+	}
+	std::vector <fcl::CollisionGeometryPtr_t> geometries =
+	  createPolyhedra (boundingVolume_, chunks, splitThreads_);
+
+	ObjectVector_t obstacles;
+	MatrixHomogeneousType position;
+	position.setIdentity ();
+	for (std::size_t i = 0; i < geometries.size (); ++i) {
+	  std::ostringstream name;
+	  name << model.getName ();
+	  if (geometries.size () > 1) name << "_" << i;
+	  obstacles.push_back (CollisionObject::create (geometries [i],
+							position, name.str ()));
+	}
+	hppDout (info, "Merged " << order.size () << " geometries of "
+		 << nbTriangles << " triangles into " << obstacles.size ()
+		 << " obstacles");
+	return obstacles;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
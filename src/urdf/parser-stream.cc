@@ -0,0 +1,519 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * \file src/urdf/parser-stream.cc
+ *
+ * \brief Incremental parsing of large URDF files.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <set>
+
+#include <tinyxml.h>
+#include <urdf_parser/urdf_parser.h>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "mesh.hh"
+#include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// \brief Iterate over the children of the root element of an xml
+	/// document without building a DOM.
+	class ElementScanner
+	{
+	public:
+	  ElementScanner (const char* begin, const char* end)
+	    : position_ (begin), end_ (end), depth_ (0)
+	  {}
+
+	  /// Get next child of the root element
+	  ///
+	  /// \retval name tag name of the element,
+	  /// \retval begin, end characters of the element.
+	  /// \return false when the root element is closed.
+	  bool next (std::string& name, const char*& begin, const char*& end)
+	  {
+	    const char* start = 0;
+	    while (true) {
+	      position_ = std::find (position_, end_, '<');
+	      if (position_ == end_) return false;
+	      const char* tag = position_;
+	      if (startsWith ("<!--")) {
+		skip ("-->");
+		continue;
+	      }
+	      if (startsWith ("<![CDATA[")) {
+		skip ("]]>");
+		continue;
+	      }
+	      if (startsWith ("<?")) {
+		skip ("?>");
+		continue;
+	      }
+	      if (startsWith ("<!")) {
+		skip (">");
+		continue;
+	      }
+	      bool closing = (tag + 1 < end_ && tag [1] == '/');
+	      bool selfClosing = skipTag ();
+	      if (closing) {
+		--depth_;
+		if (depth_ == 1 && start) {
+		  begin = start;
+		  end = position_;
+		  return true;
+		}
+		if (depth_ <= 0) {
+		  position_ = end_;
+		  return false;
+		}
+	      } else {
+		if (depth_ == 1) {
+		  start = tag;
+		  const char* nameEnd = tag + 1;
+		  while (nameEnd < end_ && !isspace (*nameEnd) &&
+			 *nameEnd != '/' && *nameEnd != '>')
+		    ++nameEnd;
+		  name.assign (tag + 1, nameEnd);
+		  if (selfClosing) {
+		    begin = start;
+		    end = position_;
+		    return true;
+		  }
+		}
+		if (!selfClosing) ++depth_;
+	      }
+	    }
+	  }
+
+	private:
+	  bool startsWith (const char* pattern) const
+	  {
+	    size_t length = strlen (pattern);
+	    return (size_t) (end_ - position_) >= length &&
+	      strncmp (position_, pattern, length) == 0;
+	  }
+
+	  void skip (const char* pattern)
+	  {
+	    const char* found = std::search (position_, end_, pattern,
+					     pattern + strlen (pattern));
+	    if (found == end_) {
+	      throw std::runtime_error ("Unterminated xml construct");
+	    }
+	    position_ = found + strlen (pattern);
+	  }
+
+	  /// Move after the end of current tag.
+	  /// \return whether the tag is self-closing.
+	  bool skipTag ()
+	  {
+	    char quote = 0;
+	    for (const char* c = position_ + 1; c < end_; ++c) {
+	      if (quote) {
+		if (*c == quote) quote = 0;
+	      } else if (*c == '"' || *c == '\'') {
+		quote = *c;
+	      } else if (*c == '>') {
+		position_ = c + 1;
+		return *(c - 1) == '/';
+	      }
+	    }
+	    throw std::runtime_error ("Unterminated xml tag");
+	  }
+
+	  const char* position_;
+	  const char* end_;
+	  int depth_;
+	}; // class ElementScanner
+
+	TiXmlElement* parseXml (TiXmlDocument& document,
+				const char* begin, const char* end)
+	{
+	  document.Parse (std::string (begin, end).c_str ());
+	  TiXmlElement* element = document.RootElement ();
+	  if (!element) {
+	    throw std::runtime_error ("Failed to parse urdf element:\n" +
+				      std::string (begin, end));
+	  }
+	  return element;
+	}
+
+	std::string childAttribute (TiXmlElement* element, const char* child,
+				    const char* attribute)
+	{
+	  TiXmlElement* node = element->FirstChildElement (child);
+	  const char* value = node ? node->Attribute (attribute) : 0;
+	  if (!value) {
+	    throw std::runtime_error
+	      (std::string ("Missing ") + child + " " + attribute +
+	       " in urdf element " + element->Value ());
+	  }
+	  return value;
+	}
+
+	/// \brief Parse a top-level element of an urdf file as a robot of
+	/// its own.
+	///
+	/// Joints are given their parent and child links so that the
+	/// robot is valid. Visual elements are dropped: they are not used
+	/// and may refer to materials defined elsewhere in the file.
+	boost::shared_ptr < ::urdf::ModelInterface>
+	parseElement (const char* begin, const char* end)
+	{
+	  TiXmlDocument document;
+	  TiXmlElement* element = parseXml (document, begin, end);
+
+	  TiXmlElement robot ("robot");
+	  robot.SetAttribute ("name", "stream");
+	  if (std::string (element->Value ()) == "joint") {
+	    TiXmlElement parent ("link");
+	    parent.SetAttribute
+	      ("name", childAttribute (element, "parent", "link").c_str ());
+	    robot.InsertEndChild (parent);
+	    TiXmlElement child ("link");
+	    child.SetAttribute
+	      ("name", childAttribute (element, "child", "link").c_str ());
+	    robot.InsertEndChild (child);
+	  }
+	  TiXmlElement* visual;
+	  while ((visual = element->FirstChildElement ("visual")))
+	    element->RemoveChild (visual);
+	  robot.InsertEndChild (*element);
+
+	  TiXmlPrinter printer;
+	  robot.Accept (&printer);
+	  boost::shared_ptr < ::urdf::ModelInterface> model =
+	    ::urdf::parseURDF (printer.CStr ());
+	  if (!model) {
+	    throw std::runtime_error ("Failed to parse urdf element:\n" +
+				      std::string (begin, end));
+	  }
+	  return model;
+	}
+
+	/// Replace the predefined entities of an attribute value.
+	std::string decodeEntities (const char* begin, const char* end)
+	{
+	  static const char* entities [][2] = {
+	    { "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" },
+	    { "&quot;", "\"" }, { "&apos;", "'" }
+	  };
+	  std::string value;
+	  value.reserve (end - begin);
+	  while (begin < end) {
+	    std::size_t i = 0;
+	    if (*begin == '&') {
+	      for (; i < 5; ++i) {
+		size_t length = strlen (entities [i][0]);
+		if ((size_t) (end - begin) >= length &&
+		    strncmp (begin, entities [i][0], length) == 0) break;
+	      }
+	    }
+	    if (*begin == '&' && i < 5) {
+	      value += entities [i][1];
+	      begin += strlen (entities [i][0]);
+	    } else {
+	      value += *begin++;
+	    }
+	  }
+	  return value;
+	}
+
+	/// \brief Get an attribute of the opening tag starting at begin.
+	///
+	/// \return false if the tag has no such attribute.
+	bool tagAttribute (const char* begin, const char* end,
+			   const char* attribute, std::string& value)
+	{
+	  const char* c = begin + 1;
+	  while (c < end && !isspace (*c) && *c != '/' && *c != '>') ++c;
+	  while (c < end) {
+	    while (c < end && isspace (*c)) ++c;
+	    if (c == end || *c == '/' || *c == '>') return false;
+	    const char* nameBegin = c;
+	    while (c < end && !isspace (*c) && *c != '=') ++c;
+	    const char* nameEnd = c;
+	    while (c < end && (isspace (*c) || *c == '=')) ++c;
+	    if (c == end || (*c != '"' && *c != '\'')) {
+	      throw std::runtime_error ("Malformed urdf attribute " +
+					std::string (nameBegin, nameEnd));
+	    }
+	    const char* valueEnd = std::find (c + 1, end, *c);
+	    if (valueEnd == end) {
+	      throw std::runtime_error ("Unterminated urdf attribute " +
+					std::string (nameBegin, nameEnd));
+	    }
+	    if ((size_t) (nameEnd - nameBegin) == strlen (attribute) &&
+		strncmp (nameBegin, attribute, nameEnd - nameBegin) == 0) {
+	      value = decodeEntities (c + 1, valueEnd);
+	      return true;
+	    }
+	    c = valueEnd + 1;
+	  }
+	  return false;
+	}
+
+	/// \brief Find the opening tag of a descendant of an element.
+	///
+	/// \param begin, end characters of the element,
+	/// \param name tag name of the descendant.
+	/// \return the beginning of the tag, end if there is none.
+	const char* findTag (const char* begin, const char* end,
+			     const char* name)
+	{
+	  size_t length = strlen (name);
+	  const char* c = std::find (begin + 1, end, '<');
+	  while (c != end) {
+	    if ((size_t) (end - c) >= 4 && strncmp (c, "<!--", 4) == 0) {
+	      const char* close = "-->";
+	      c = std::search (c, end, close, close + 3);
+	    } else if ((size_t) (end - c) > length + 1 &&
+		       strncmp (c + 1, name, length) == 0 &&
+		       (isspace (c [length + 1]) || c [length + 1] == '/' ||
+			c [length + 1] == '>')) {
+	      return c;
+	    }
+	    c = std::find (c == end ? end : c + 1, end, '<');
+	  }
+	  return end;
+	}
+
+	/// \brief Find the only link that is not the child of a joint.
+	///
+	/// Only the name of links and the child link of joints are read,
+	/// elements are not parsed.
+	std::string findRootLink (const char* begin, const char* end)
+	{
+	  std::vector <std::string> links;
+	  std::set <std::string> children;
+	  ElementScanner scanner (begin, end);
+	  std::string name, value;
+	  const char* elementBegin;
+	  const char* elementEnd;
+	  while (scanner.next (name, elementBegin, elementEnd)) {
+	    if (name == "link") {
+	      if (tagAttribute (elementBegin, elementEnd, "name", value))
+		links.push_back (value);
+	    } else if (name == "joint") {
+	      const char* child = findTag (elementBegin, elementEnd, "child");
+	      if (child == elementEnd ||
+		  !tagAttribute (child, elementEnd, "link", value)) {
+		throw std::runtime_error ("Missing child link in urdf element:\n"
+					  + std::string (elementBegin,
+							 elementEnd));
+	      }
+	      children.insert (value);
+	    }
+	  }
+	  std::string root;
+	  for (std::vector <std::string>::const_iterator it = links.begin ();
+	       it != links.end (); ++it) {
+	    if (children.count (*it) == 0) {
+	      if (!root.empty ()) {
+		throw std::runtime_error ("URDF model has several root links: "
+					  + root + " and " + *it);
+	      }
+	      root = *it;
+	    }
+	  }
+	  if (root.empty ()) {
+	    throw std::runtime_error ("URDF model is missing a root link");
+	  }
+	  return root;
+	}
+
+	/// Joints holding a link and position of the link frame in world
+	/// frame.
+	struct LinkFrame
+	{
+	  LinkFrame () : joint (), urdfJoint (), position ()
+	  {}
+	  LinkFrame (const JointPtr_t& j, const Parser::UrdfJointPtrType& u,
+		     const Transform3f& p)
+	    : joint (j), urdfJoint (u), position (p)
+	  {}
+	  JointPtr_t joint;
+	  Parser::UrdfJointPtrType urdfJoint;
+	  Transform3f position;
+	}; // struct LinkFrame
+
+	/// \brief Keep the parts of a link used after parsing.
+	///
+	/// Name, inertial and collision elements are used by update, the
+	/// parent joint by findSpecialJoints. Visual elements, groups and
+	/// the model the link was parsed in are released.
+	Parser::UrdfLinkPtrType strippedLink
+	(const Parser::UrdfLinkPtrType& link)
+	{
+	  Parser::UrdfLinkPtrType result (new ::urdf::Link);
+	  result->name = link->name;
+	  result->inertial = link->inertial;
+	  result->collision = link->collision;
+	  return result;
+	}
+      } // end of anonymous namespace.
+
+      void Parser::parseStream (const std::string& resourceName)
+      {
+	hppDout (info, "filename: " << resourceName);
+	std::string path;
+	if (!localPath (resourceName, path)) {
+	  hppDout (notice, resourceName << " is not a local file,"
+		   " parsing it as a whole.");
+	  parse (resourceName);
+	  return;
+	}
+	// The file is memory-mapped, only the element being read is copied.
+	Resource resource = retrieveResource (resourceName);
+	const char* begin = reinterpret_cast <const char*> (resource.data ());
+	const char* end = begin + resource.size ();
+
+	// Reset the attributes to avoid problems when loading
+	// multiple robots using the same object.
+	model_.clear ();
+	rootJoint_ = 0;
+	jointsMap_.clear ();
+	pendingGeometry_.clear ();
+	meshStatistics_.clear ();
+	meshVersions_.clear ();
+	linkChunks_.clear ();
+	meshArena_->resetStatistics ();
+	prefetcher_.reset ();
+
+	// First pass only collects link names to find the root link.
+	std::string rootLinkName = findRootLink (begin, end);
+
+	MatrixHomogeneousType position;
+	position.setIdentity ();
+	createRootJoint ("base_joint", position, robot_);
+	const std::string referenceJointName ("base_footprint_joint");
+
+	// Links whose joint is created, links and joints waiting for their
+	// parent.
+	typedef std::map <std::string, LinkFrame> LinkFrames_t;
+	typedef std::multimap <std::string, UrdfJointPtrType> PendingJoints_t;
+	typedef std::map <std::string, UrdfLinkPtrType> PendingLinks_t;
+	LinkFrames_t frames;
+	PendingJoints_t pendingJoints;
+	PendingLinks_t pendingLinks;
+	frames [rootLinkName] = LinkFrame (rootJoint_, UrdfJointPtrType (),
+					   position);
+	std::vector <UrdfJointPtrType> ready;
+
+	ElementScanner scanner (begin, end);
+	std::string name;
+	const char* elementBegin;
+	const char* elementEnd;
+	while (scanner.next (name, elementBegin, elementEnd)) {
+	  if (name == "link") {
+	    UrdfLinkPtrType link = strippedLink
+	      (parseElement (elementBegin, elementEnd)->links_.begin ()->second);
+	    model_.links_ [link->name] = link;
+	    if (link->name == rootLinkName) {
+	      model_.root_link_ = link;
+	      addBodyToJoint (link, rootJoint_);
+	    } else if (frames.count (link->name)) {
+	      const LinkFrame& frame = frames [link->name];
+	      link->parent_joint = frame.urdfJoint;
+	      addBodyToJoint (link, frame.joint);
+	    } else {
+	      pendingLinks [link->name] = link;
+	    }
+	  } else if (name == "joint") {
+	    UrdfJointPtrType joint =
+	      parseElement (elementBegin, elementEnd)->joints_.begin ()->second;
+	    if (joint->type == ::urdf::Joint::FLOATING) {
+	      throw std::runtime_error ("FLOATING joint " + joint->name +
+					" is not supported by parseStream");
+	    }
+	    model_.joints_ [joint->name] = joint;
+	    if (frames.count (joint->parent_link_name)) {
+	      ready.push_back (joint);
+	    } else {
+	      pendingJoints.insert (std::make_pair (joint->parent_link_name,
+						    joint));
+	    }
+	    // Create the joint and every joint and body waiting for it.
+	    while (!ready.empty ()) {
+	      UrdfJointPtrType current = ready.back ();
+	      ready.pop_back ();
+	      const LinkFrame& parent = frames [current->parent_link_name];
+	      // Positions are expressed in the frame of base_footprint_joint,
+	      // as in parseJoints.
+	      position =
+		poseToMatrix (current->parent_to_joint_origin_transform);
+	      if (current->name != referenceJointName) {
+		position = parent.position * position;
+	      }
+	      JointPtr_t hppJoint = createJoint (current, position);
+	      parent.joint->addChildJoint (hppJoint);
+	      frames [current->child_link_name] =
+		LinkFrame (hppJoint, current, position);
+
+	      PendingLinks_t::iterator link =
+		pendingLinks.find (current->child_link_name);
+	      if (link != pendingLinks.end ()) {
+		link->second->parent_joint = current;
+		addBodyToJoint (link->second, hppJoint);
+		pendingLinks.erase (link);
+	      }
+	      std::pair <PendingJoints_t::iterator, PendingJoints_t::iterator>
+		children = pendingJoints.equal_range (current->child_link_name);
+	      for (PendingJoints_t::iterator it = children.first;
+		   it != children.second; ++it) {
+		ready.push_back (it->second);
+	      }
+	      pendingJoints.erase (children.first, children.second);
+	    }
+	  }
+	}
+	if (!pendingJoints.empty ()) {
+	  throw std::runtime_error ("Joint " + pendingJoints.begin ()->
+				    second->name + " is not connected to "
+				    "the root link");
+	}
+	if (!pendingLinks.empty ()) {
+	  throw std::runtime_error ("Link " + pendingLinks.begin ()->first +
+				    " is not connected to the root link");
+	}
+	if (!model_.root_link_) {
+	  throw std::runtime_error ("URDF model is missing a root link");
+	}
+
+	// Get names of special joints.
+	findSpecialJoints ();
+	topology_ = urdf::topology (robot_);
+	meshArena_->clear ();
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
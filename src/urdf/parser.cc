@@ -23,19 +23,17 @@
  */
 
 //#include <boost/numeric/conversion/bounds.hpp>
+#include <algorithm>
 #include <limits>
+#include <list>
+#include <set>
 
 #include <boost/filesystem/fstream.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/once.hpp>
 
-#include <resource_retriever/retriever.h>
 #include <assimp/DefaultLogger.h>
-#include <assimp/assimp.hpp>
-#include <assimp/aiScene.h>
-#include <assimp/aiPostProcess.h>
-#include <assimp/IOStream.h>
-#include <assimp/IOSystem.h>
 
 #include <hpp/util/debug.hh>
 #include <hpp/util/assertion.hh>
@@ -47,12 +45,13 @@
 #include <hpp/model/urdf/parser.hh>
 #include <hpp/model/urdf/util.hh>
 
+#include <hpp/fcl/BV/BV.h>
 #include <hpp/fcl/collision_object.h>
 #include <hpp/fcl/shape/geometric_shapes.h>
 
-namespace fcl {
-  HPP_PREDEF_CLASS (CollisionGeometry);
-}
+#include "mesh.hh"
+#include "resource.hh"
+#include "shared-mesh-store.hh"
 
 namespace hpp
 {
@@ -60,142 +59,25 @@ namespace hpp
   {
     namespace urdf
     {
-      class ResourceIOStream : public Assimp::IOStream
-      {
-      public:
-	ResourceIOStream (const resource_retriever::MemoryResource& res)
-	  : res_(res)
-	  , pos_(res.data.get())
-	{}
-
-	~ResourceIOStream()
-	{}
-
-	size_t Read (void* buffer, size_t size, size_t count)
-	{
-	  size_t to_read = size * count;
-	  if (pos_ + to_read > res_.data.get() + res_.size)
-	    {
-	      to_read = res_.size - (pos_ - res_.data.get());
-	    }
-
-	  memcpy(buffer, pos_, to_read);
-	  pos_ += to_read;
-
-	  return to_read;
-	}
-
-	size_t Write (const void*, size_t, size_t) { return 0; }
-
-	aiReturn Seek (size_t offset, aiOrigin origin)
-	{
-	  uint8_t* new_pos = 0;
-	  switch (origin)
-	    {
-	    case aiOrigin_SET:
-	      new_pos = res_.data.get() + offset;
-	      break;
-	    case aiOrigin_CUR:
-	      new_pos = pos_ + offset; // TODO is this right?  can offset really not be negative
-	      break;
-	    case aiOrigin_END:
-	      new_pos = res_.data.get() + res_.size - offset; // TODO is this right?
-	      break;
-	    default:
-	      break;
-	    }
-
-	  if (new_pos < res_.data.get() || new_pos > res_.data.get() + res_.size)
-	    {
-	      return aiReturn_FAILURE;
-	    }
-
-	  pos_ = new_pos;
-	  return aiReturn_SUCCESS;
-	}
-
-	size_t Tell() const
-	{
-	  return pos_ - res_.data.get();
-	}
-
-	size_t FileSize() const
-	{
-	  return res_.size;
-	}
-
-	void Flush() {}
-
-      private:
-	resource_retriever::MemoryResource res_;
-	uint8_t* pos_;
-      };
-
-      class ResourceIOSystem : public Assimp::IOSystem
+      using std::numeric_limits;
+#ifdef HPP_DEBUG
+      namespace
       {
-      public:
-	ResourceIOSystem()
-	{
-	}
-
-	~ResourceIOSystem()
-	{
-	}
-
-	// Check whether a specific file exists
-	bool Exists(const char* file) const
-	{
-	  // Ugly -- two retrievals where there should be one (Exists + Open)
-	  // resource_retriever needs a way of checking for existence
-	  // TODO: cache this
-	  resource_retriever::MemoryResource res;
-	  try
-	    {
-	      res = retriever_.get(file);
-	    }
-	  catch (resource_retriever::Exception& e)
-	    {
-	      hppDout (error, e.what ());
-	      return false;
-	    }
-
-	  return true;
-	}
+	boost::once_flag assimpLoggerFlag = BOOST_ONCE_INIT;
 
-	// Get the path delimiter character we'd like to see
-	char getOsSeparator() const
+	/// Assimp logger is global to the process. It is created once so
+	/// that parsers running in other threads keep a valid logger.
+	void createAssimpLogger ()
 	{
-	  return '/';
+	  std::string filename = hpp::debug::getPrefix ("assimp") +
+	    "/assimp.log";
+	  hppDout (notice, filename);
+	  Assimp::DefaultLogger::create (filename.c_str (),
+					 Assimp::Logger::VERBOSE);
 	}
+      } // end of anonymous namespace.
+#endif
 
-	// ... and finally a method to open a custom stream
-	Assimp::IOStream* Open(const char* file,
-			       const char* hppDebugStatement (mode))
-	{
-	  HPP_ASSERT (mode == std::string("r") || mode == std::string("rb"));
-
-	  // Ugly -- two retrievals where there should be one (Exists + Open)
-	  // resource_retriever needs a way of checking for existence
-	  resource_retriever::MemoryResource res;
-	  try
-	    {
-	      res = retriever_.get(file);
-	    }
-	  catch (resource_retriever::Exception& e)
-	    {
-	      return 0;
-	    }
-
-	  return new ResourceIOStream(res);
-	}
-
-	void Close(Assimp::IOStream* stream) { delete stream; }
-
-      private:
-	mutable resource_retriever::Retriever retriever_;
-      };
-
-      using std::numeric_limits;
       Parser::Parser (const std::string& rootJointType,
 		      const RobotPtrType& robot)
   : model_ (),
@@ -213,14 +95,26 @@ namespace hpp
     rightAnkleJointName_ (),
     leftFootJointName_ (),
     rightFootJointName_ (),
-    gazeJointName_ ()
+    gazeJointName_ (),
+    deferGeometry_ (false),
+    pendingGeometry_ (),
+    boundingVolume_ (fcl::BV_OBBRSS),
+    weldTolerance_ (1e-6),
+    nativeMeshReaders_ (true),
+    splitTriangles_ (0),
+    splitThreads_ (0),
+    resourceResolver_ (),
+    meshStatistics_ (),
+    meshVersions_ (),
+    linkChunks_ (),
+    meshStatisticsMutex_ (),
+    topology_ (),
+    meshArena_ (new MeshArena),
+    prefetcher_ (),
+    meshStore_ ()
       {
 #ifdef HPP_DEBUG
-	std::string filename = hpp::debug::getPrefix ("assimp") +
-	  "/assimp.log";
-	hppDout (notice, filename);
-	Assimp::DefaultLogger::create (filename.c_str (),
-				       Assimp::Logger::VERBOSE);
+	boost::call_once (&createAssimpLogger, assimpLoggerFlag);
 #endif
       }
 
@@ -297,7 +191,6 @@ namespace hpp
       void
       Parser::findSpecialJoints ()
       {
-	rootJointName_ = "base_joint_SO3";
 	findSpecialJoint ("torso", chestJointName_);
 	findSpecialJoint ("l_wrist", leftWristJointName_);
 	findSpecialJoint ("r_wrist", rightWristJointName_);
@@ -388,67 +281,123 @@ namespace hpp
 	createRootJoint ("base_joint", position, robot_);
 
 	// Iterate through each "true kinematic" joint and create a
-	// corresponding hpp::model::Joint.
-	for(MapJointType::const_iterator it = model_.joints_.begin();
-	    it != model_.joints_.end(); ++it) {
-	  position =
-	    getPoseInReferenceFrame("base_footprint_joint", it->first);
-
-	  // Normalize orientation if this is an actuated joint.
-	  UrdfJointConstPtrType joint = model_.getJoint (it->first);
-	  Transform3f urdfLinkInJoint;
-	  if (joint->type == ::urdf::Joint::REVOLUTE
-	      || joint->type == ::urdf::Joint::CONTINUOUS
-	      || joint->type == ::urdf::Joint::PRISMATIC) {
-	    Transform3f jointInUrdfLink = normalizeFrameOrientation (joint);
-	    urdfLinkInJoint = inverse (jointInUrdfLink);
-	    position = position * jointInUrdfLink;
+	// corresponding hpp::model::Joint. Positions are expressed in the
+	// frame of base_footprint_joint, as computed by
+	// getPoseInReferenceFrame.
+	const std::string referenceJointName ("base_footprint_joint");
+	UrdfLinkConstPtrType rootLink = model_.getRoot ();
+	if (!rootLink) return;
+	// URDF joints to create with the position of their parent joint.
+	std::vector <std::pair <UrdfJointConstPtrType, MatrixHomogeneousType> >
+	  stack;
+	stack.reserve (rootLink->child_joints.size ());
+	for (std::size_t i = 0; i < rootLink->child_joints.size (); ++i) {
+	  stack.push_back (std::make_pair (rootLink->child_joints [i],
+					   position));
+	}
+	while (!stack.empty ()) {
+	  UrdfJointConstPtrType joint = stack.back ().first;
+	  position = stack.back ().second;
+	  stack.pop_back ();
+	  MatrixHomogeneousType transform =
+	    poseToMatrix (joint->parent_to_joint_origin_transform);
+	  if (joint->name == referenceJointName) {
+	    position = transform;
+	  } else {
+	    position = position * transform;
 	  }
+	  createJoint (joint, position);
 
-	  switch(it->second->type) {
-	  case ::urdf::Joint::UNKNOWN:
-	    throw std::runtime_error ("Joint has UNKNOWN type");
-	    break;
-	  case ::urdf::Joint::REVOLUTE:
-	    createRotationJoint (it->first, position, urdfLinkInJoint,
-				 it->second->limits);
-	    break;
-	  case ::urdf::Joint::CONTINUOUS:
-	    createContinuousJoint (it->first, position, urdfLinkInJoint);
-	    break;
-	  case ::urdf::Joint::PRISMATIC:
-	    createTranslationJoint (it->first, position, urdfLinkInJoint,
-				    it->second->limits);
-	    break;
-	  case ::urdf::Joint::FLOATING:
-	    createFreeflyerJoint (it->first, position);
-	    break;
-	  case ::urdf::Joint::PLANAR:
-	    throw std::runtime_error ("PLANAR joints are not supported");
-	    break;
-	  case ::urdf::Joint::FIXED:
-	    createAnchorJoint (it->first, position);
-	    break;
-	  default:
-	    std::ostringstream error;
-	    error << "Unknown joint type: " << (int)it->second->type;
-	    throw std::runtime_error (error.str ());
+	  UrdfLinkConstPtrType child = model_.getLink (joint->child_link_name);
+	  if (!child) continue;
+	  for (std::size_t i = 0; i < child->child_joints.size (); ++i) {
+	    stack.push_back (std::make_pair (child->child_joints [i],
+					     position));
 	  }
 	}
       }
 
+      JointPtr_t Parser::createJoint (const UrdfJointConstPtrType& joint,
+				      MatrixHomogeneousType position)
+      {
+	// Normalize orientation if this is an actuated joint.
+	Transform3f urdfLinkInJoint;
+	if (joint->type == ::urdf::Joint::REVOLUTE
+	    || joint->type == ::urdf::Joint::CONTINUOUS
+	    || joint->type == ::urdf::Joint::PRISMATIC) {
+	  Transform3f jointInUrdfLink = normalizeFrameOrientation (joint);
+	  urdfLinkInJoint = inverse (jointInUrdfLink);
+	  position = position * jointInUrdfLink;
+	}
+
+	switch(joint->type) {
+	case ::urdf::Joint::UNKNOWN:
+	  throw std::runtime_error ("Joint has UNKNOWN type");
+	  break;
+	case ::urdf::Joint::REVOLUTE:
+	  return createRotationJoint (joint->name, position, urdfLinkInJoint,
+				      joint->limits);
+	case ::urdf::Joint::CONTINUOUS:
+	  return createContinuousJoint (joint->name, position,
+					urdfLinkInJoint);
+	case ::urdf::Joint::PRISMATIC:
+	  return createTranslationJoint (joint->name, position,
+					 urdfLinkInJoint, joint->limits);
+	case ::urdf::Joint::FLOATING:
+	  createFreeflyerJoint (joint->name, position);
+	  break;
+	case ::urdf::Joint::PLANAR:
+	  throw std::runtime_error ("PLANAR joints are not supported");
+	  break;
+	case ::urdf::Joint::FIXED:
+	  return createAnchorJoint (joint->name, position);
+	default:
+	  std::ostringstream error;
+	  error << "Unknown joint type: " << (int)joint->type;
+	  throw std::runtime_error (error.str ());
+	}
+	return JointPtr_t ();
+      }
+
       void Parser::connectJoints (const JointPtr_t& rootJoint)
       {
-	BOOST_FOREACH (const std::string& childName,
-		       getChildrenJoint (rootJoint->name ())) {
-	  MapHppJointType::const_iterator child = jointsMap_.find (childName);
-	  if (child == jointsMap_.end () && !!child->second) {
-	    throw std::runtime_error ("Failed to connect joint " + childName);
+	UrdfLinkConstPtrType rootLink = model_.getRoot ();
+	if (!rootLink) {
+	  throw std::runtime_error ("Failed to retrieve children link of joint "
+				    + rootJoint->name ());
+	}
+	// URDF joints to connect with the joint they are connected to.
+	// Children are pushed in reverse order so that joints are added
+	// depth first in the order of the URDF file.
+	std::vector <std::pair <const ::urdf::Joint*, JointPtr_t> > stack;
+	for (std::size_t i = rootLink->child_joints.size (); i > 0; --i) {
+	  stack.push_back (std::make_pair
+			   (rootLink->child_joints [i - 1].get (), rootJoint));
+	}
+	while (!stack.empty ()) {
+	  const ::urdf::Joint* joint = stack.back ().first;
+	  JointPtr_t parent = stack.back ().second;
+	  stack.pop_back ();
+
+	  MapHppJointType::const_iterator child = jointsMap_.find (joint->name);
+	  if (child != jointsMap_.end () && child->second) {
+	    if (!child->second->parentJoint ()) {
+	      parent->addChildJoint (child->second);
+	    }
+	    parent = child->second;
+	  }
+	  // URDF joints without corresponding joint are skipped.
+
+	  UrdfLinkConstPtrType childLink =
+	    model_.getLink (joint->child_link_name);
+	  if (!childLink) {
+	    throw std::runtime_error ("Failed to retrieve children link of "
+				      "joint " + joint->name);
 	  }
-	  if (!child->second->parentJoint()) {
-	    rootJoint->addChildJoint (child->second);
+	  for (std::size_t i = childLink->child_joints.size (); i > 0; --i) {
+	    stack.push_back (std::make_pair
+			     (childLink->child_joints [i - 1].get (), parent));
 	  }
-	  connectJoints (child->second);
 	}
       }
 
@@ -480,221 +429,371 @@ namespace hpp
 				      std::string
 				      (" not found, inconsistent model"));
 	  }
+	  addBodyToJoint (link, it->second);
+	}
+      }
 
-	  // Retrieve inertial information.
-	  boost::shared_ptr < ::urdf::Inertial> inertial = link->inertial;
-
-	  fcl::Vec3f localCom (0., 0., 0.);
-	  matrix3_t inertiaMatrix;
-	  double mass = 0.;
-	  if (inertial) {
-	    localCom[0] = inertial->origin.position.x;
-	    localCom[1] = inertial->origin.position.y;
-	    localCom[2] = inertial->origin.position.z;
-
-	    mass = inertial->mass;
-
-	    inertiaMatrix (0, 0) = inertial->ixx;
-	    inertiaMatrix (0, 1) = inertial->ixy;
-	    inertiaMatrix (0, 2) = inertial->ixz;
-
-	    inertiaMatrix (1, 0) = inertial->ixy;
-	    inertiaMatrix (1, 1) = inertial->iyy;
-	    inertiaMatrix (1, 2) = inertial->iyz;
-
-	    inertiaMatrix (2, 0) = inertial->ixz;
-	    inertiaMatrix (2, 1) = inertial->iyz;
-	    inertiaMatrix (2, 2) = inertial->izz;
-
-	    // Use joint normalization to properly reorient
-	    // inertial frames.
-	    if (it->first == rootJointName_) {}
-	    else
-	      if (link->parent_joint->type == ::urdf::Joint::REVOLUTE
-		  || link->parent_joint->type == ::urdf::Joint::CONTINUOUS
-		  || link->parent_joint->type == ::urdf::Joint::PRISMATIC) {
-		MatrixHomogeneousType normalizedJointTransform
-		  = normalizeFrameOrientation (link->parent_joint);
-
-		MatrixHomogeneousType localComTransform;
-		localComTransform.setIdentity ();
-		localComTransform.setTranslation (localCom);
-		MatrixHomogeneousType njtInverse =
-		  normalizedJointTransform.inverse ();
-		localComTransform = njtInverse * localComTransform;
-		localCom = localComTransform.getTranslation ();
-
-		fcl::Matrix3f R = normalizedJointTransform.getRotation ();
-		fcl::Matrix3f RT = njtInverse.getRotation ();
-		inertiaMatrix = RT * inertiaMatrix * R;
-	      }
-	  }
-	  else {
-	    hppDout (notice, "missing inertial information in link "
-		     << childLinkName);
-	  }
+      void Parser::addBodyToJoint (const UrdfLinkConstPtrType& link,
+				   const JointPtr_t& joint)
+      {
+	// Create dynamic body and fill inertial information.
+	Body* body = objectFactory_.createBody ();
+	assert (body);
+	body->name (link->name);
+	hppDout (info, "creating Body with name " << body->name ()
+		 << " at " << body);
+	setBodyInertia (link, body);
+
+	// Link dynamic body to dynamic joint.
+	joint->setLinkedBody (body);
+	joint->linkName (link->name);
+	hppDout (info,  "Linking body " << body->name () << " to joint "
+		 << joint->name ());
+
+	// Create geometric body and fill geometry information.
+	if (link->collision) {
+	  addSolidComponentToJoint (link, joint);
+	}
+      }
 
-	  // Create dynamic body and fill inertial information.
-	  Body* body = objectFactory_.createBody ();
-	  assert (body);
-	  body->name (link->name);
-	  hppDout (info, "creating Body with name " << body->name ()
-		   << " at " << body);
-
-	  body->mass (mass);
-	  body->localCenterOfMass (localCom);
-	  body->inertiaMatrix (inertiaMatrix);
-
-	  // Link dynamic body to dynamic joint.
-	  it->second->setLinkedBody (body);
-	  it->second->linkName (link->name);
-	  hppDout (info,  "Linking body " << body->name () << " to joint "
-		   << it->second->name ());
-
-	  // Create geometric body and fill geometry information.
-	  if (link->collision) {
-	    JointPtr_t hppJoint = it->second;
-	    addSolidComponentToJoint (link, hppJoint);
-	  }
+      void Parser::setBodyInertia (const UrdfLinkConstPtrType& link,
+				   Body* body)
+      {
+	// Retrieve inertial information.
+	boost::shared_ptr < ::urdf::Inertial> inertial = link->inertial;
+
+	fcl::Vec3f localCom (0., 0., 0.);
+	matrix3_t inertiaMatrix;
+	double mass = 0.;
+	if (inertial) {
+	  localCom[0] = inertial->origin.position.x;
+	  localCom[1] = inertial->origin.position.y;
+	  localCom[2] = inertial->origin.position.z;
+
+	  mass = inertial->mass;
+
+	  inertiaMatrix (0, 0) = inertial->ixx;
+	  inertiaMatrix (0, 1) = inertial->ixy;
+	  inertiaMatrix (0, 2) = inertial->ixz;
+
+	  inertiaMatrix (1, 0) = inertial->ixy;
+	  inertiaMatrix (1, 1) = inertial->iyy;
+	  inertiaMatrix (1, 2) = inertial->iyz;
+
+	  inertiaMatrix (2, 0) = inertial->ixz;
+	  inertiaMatrix (2, 1) = inertial->iyz;
+	  inertiaMatrix (2, 2) = inertial->izz;
+
+	  // Inertia is expressed in the frame of the inertial origin, of
+	  // rotation R with respect to the link frame: R I R^T in link
+	  // frame.
+	  fcl::Matrix3f origin = poseToMatrix (inertial->origin).getRotation ();
+	  inertiaMatrix = origin * inertiaMatrix * origin.transpose ();
+
+	  // Use joint normalization to properly reorient
+	  // inertial frames.
+	  if (!link->parent_joint) {}
+	  else
+	    if (link->parent_joint->type == ::urdf::Joint::REVOLUTE
+		|| link->parent_joint->type == ::urdf::Joint::CONTINUOUS
+		|| link->parent_joint->type == ::urdf::Joint::PRISMATIC) {
+	      MatrixHomogeneousType normalizedJointTransform
+		= normalizeFrameOrientation (link->parent_joint);
+
+	      MatrixHomogeneousType localComTransform;
+	      localComTransform.setIdentity ();
+	      localComTransform.setTranslation (localCom);
+	      MatrixHomogeneousType njtInverse =
+		normalizedJointTransform.inverse ();
+	      localComTransform = njtInverse * localComTransform;
+	      localCom = localComTransform.getTranslation ();
+
+	      fcl::Matrix3f R = normalizedJointTransform.getRotation ();
+	      fcl::Matrix3f RT = njtInverse.getRotation ();
+	      inertiaMatrix = RT * inertiaMatrix * R;
+	    }
 	}
+	else {
+	  hppDout (notice, "missing inertial information in link "
+		   << link->name);
+	}
+
+	body->mass (mass);
+	body->localCenterOfMass (localCom);
+	body->inertiaMatrix (inertiaMatrix);
       }
 
       Parser::MatrixHomogeneousType
       Parser::computeBodyAbsolutePosition
       (const Parser::UrdfLinkConstPtrType& link, const ::urdf::Pose& pose)
       {
-	MatrixHomogeneousType linkPositionInParentJoint = poseToMatrix (pose);
-
 	MatrixHomogeneousType parentJointInWorld;
-	if (link == model_.getRoot ()) {
+	if (!link->parent_joint) {
 	  parentJointInWorld = rootJoint_->currentTransformation ();
 	}
 	else {
 	  parentJointInWorld =
 	    findJoint (link->parent_joint->name)->currentTransformation ();
 	}
-	// Denormalize orientation if this is an actuated joint.
-	if (link == model_.getRoot ())
-	  {}
-	else
-	  if (link->parent_joint->type == ::urdf::Joint::REVOLUTE
-	      || link->parent_joint->type == ::urdf::Joint::CONTINUOUS
-	      || link->parent_joint->type == ::urdf::Joint::PRISMATIC) {
-	    MatrixHomogeneousType inverse =
-	      normalizeFrameOrientation (link->parent_joint).inverse ();
-	    parentJointInWorld = parentJointInWorld * inverse;
-	  }
-
 	MatrixHomogeneousType position = parentJointInWorld *
-	  linkPositionInParentJoint;
+	  positionInJointFrame (link, pose);
 	return position;
       }
 
-      void Parser::buildMesh (const ::urdf::Vector3& scale,
-			      const aiScene* scene,
-			      const aiNode* node,
-			      std::vector<unsigned>& subMeshIndexes,
-			      const Parser::PolyhedronPtrType& mesh)
+      Parser::MatrixHomogeneousType
+      Parser::positionInJointFrame (const UrdfLinkConstPtrType& link,
+				    const ::urdf::Pose& pose)
       {
-	if (!node) return;
+	MatrixHomogeneousType linkPositionInParentJoint = poseToMatrix (pose);
+	// Denormalize orientation if this is an actuated joint.
+	if (link->parent_joint &&
+	    (link->parent_joint->type == ::urdf::Joint::REVOLUTE
+	     || link->parent_joint->type == ::urdf::Joint::CONTINUOUS
+	     || link->parent_joint->type == ::urdf::Joint::PRISMATIC)) {
+	  return normalizeFrameOrientation (link->parent_joint).inverse () *
+	    linkPositionInParentJoint;
+	}
+	return linkPositionInParentJoint;
+      }
 
-	aiMatrix4x4 transform = node->mTransformation;
-	aiNode *pnode = node->mParent;
-	while (pnode)
-	  {
-	    // Don't convert to y-up orientation, which is what the root node in
-	    // Assimp does
-	    if (pnode->mParent != NULL)
-	      transform = pnode->mTransformation * transform;
-	    pnode = pnode->mParent;
+      namespace
+      {
+	void checkBoundingVolume (fcl::NODE_TYPE type)
+	{
+	  switch (type) {
+	  case fcl::BV_AABB:
+	  case fcl::BV_OBB:
+	  case fcl::BV_RSS:
+	  case fcl::BV_kIOS:
+	  case fcl::BV_OBBRSS:
+	    return;
+	  default:
+	    std::ostringstream error;
+	    error << "Unsupported bounding volume type " << type;
+	    throw std::runtime_error (error.str ());
 	  }
+	}
 
-	for (uint32_t i = 0; i < node->mNumMeshes; i++) {
-	  aiMesh* input_mesh = scene->mMeshes[node->mMeshes[i]];
-
-	  unsigned oldNbPoints = mesh->num_vertices;
-	  unsigned oldNbTriangles = mesh->num_tris;
-
-	  // Add the vertices
-	  for (uint32_t j = 0; j < input_mesh->mNumVertices; j++) {
-	    aiVector3D p = input_mesh->mVertices[j];
-	    p *= transform;
-	    vertices_.push_back (fcl::Vec3f (p.x * scale.x,
-					     p.y * scale.y,
-					     p.z * scale.z));
+	template <typename BV>
+	void fillPolyhedron (fcl::BVHModel <BV>& polyhedron,
+			     const std::vector <fcl::Vec3f>& vertices,
+			     const std::vector <fcl::Triangle>& triangles)
+	{
+	  int res = polyhedron.beginModel ();
+	  if (res != fcl::BVH_OK) {
+	    std::ostringstream error;
+	    error << "fcl BVHReturnCode = " << res;
+	    throw std::runtime_error (error.str ());
 	  }
-
-	  // add the indices
-	  for (uint32_t j = 0; j < input_mesh->mNumFaces; j++) {
-	    aiFace& face = input_mesh->mFaces[j];
-	    // FIXME: can add only triangular faces.
-	    triangles_.push_back (fcl::Triangle
-				  (oldNbPoints + face.mIndices[0],
-				   oldNbPoints + face.mIndices[1],
-				   oldNbPoints + face.mIndices[2]));
+	  polyhedron.addSubModel (vertices, triangles);
+	  res = polyhedron.endModel ();
+	  if (res != fcl::BVH_OK) {
+	    std::ostringstream error;
+	    error << "fcl BVHReturnCode = " << res;
+	    throw std::runtime_error (error.str ());
 	  }
+	}
 
-	  // Save submesh triangles indexes interval.
-	  if (subMeshIndexes.size () == 0)
-	    subMeshIndexes.push_back (0);
+	template <typename BV>
+	fcl::CollisionGeometryPtr_t createPolyhedron
+	(const std::vector <fcl::Vec3f>& vertices,
+	 const std::vector <fcl::Triangle>& triangles)
+	{
+	  boost::shared_ptr <fcl::BVHModel <BV> > polyhedron
+	    (new fcl::BVHModel <BV>);
+	  fillPolyhedron (*polyhedron, vertices, triangles);
+	  return polyhedron;
+	}
 
-	  subMeshIndexes.push_back (oldNbTriangles + input_mesh->mNumFaces);
+	template <typename BV>
+	void refillPolyhedron (const fcl::CollisionGeometryPtr_t& geometry,
+			       const std::vector <fcl::Vec3f>& vertices,
+			       const std::vector <fcl::Triangle>& triangles)
+	{
+	  fillPolyhedron (*boost::dynamic_pointer_cast <fcl::BVHModel <BV> >
+			  (geometry), vertices, triangles);
 	}
+      } // end of anonymous namespace.
 
-	for (uint32_t i=0; i < node->mNumChildren; ++i) {
-	  buildMesh(scale, scene, node->mChildren[i], subMeshIndexes, mesh);
+      fcl::CollisionGeometryPtr_t createPolyhedron
+      (fcl::NODE_TYPE type, const std::vector <fcl::Vec3f>& vertices,
+       const std::vector <fcl::Triangle>& triangles)
+      {
+	switch (type) {
+	case fcl::BV_AABB:
+	  return createPolyhedron <fcl::AABB> (vertices, triangles);
+	case fcl::BV_OBB:
+	  return createPolyhedron <fcl::OBB> (vertices, triangles);
+	case fcl::BV_RSS:
+	  return createPolyhedron <fcl::RSS> (vertices, triangles);
+	case fcl::BV_kIOS:
+	  return createPolyhedron <fcl::kIOS> (vertices, triangles);
+	case fcl::BV_OBBRSS:
+	  return createPolyhedron <fcl::OBBRSS> (vertices, triangles);
+	default:
+	  checkBoundingVolume (type);
+	  return fcl::CollisionGeometryPtr_t ();
 	}
       }
 
-      void Parser::meshFromAssimpScene (const std::string& name,
-					const ::urdf::Vector3& scale,
-					const aiScene* scene,
-					const Parser::PolyhedronPtrType& mesh)
+      namespace
       {
-	if (!scene->HasMeshes())
-	  {
-	    throw std::runtime_error (std::string ("No meshes found in file ")+
-				      name);
+	/// Replace vertices and triangles of a polyhedron, keeping its type
+	/// of bounding volume.
+	void refillPolyhedron (const fcl::CollisionGeometryPtr_t& geometry,
+			       const std::vector <fcl::Vec3f>& vertices,
+			       const std::vector <fcl::Triangle>& triangles)
+	{
+	  switch (geometry->getNodeType ()) {
+	  case fcl::BV_AABB:
+	    refillPolyhedron <fcl::AABB> (geometry, vertices, triangles);
+	    break;
+	  case fcl::BV_OBB:
+	    refillPolyhedron <fcl::OBB> (geometry, vertices, triangles);
+	    break;
+	  case fcl::BV_RSS:
+	    refillPolyhedron <fcl::RSS> (geometry, vertices, triangles);
+	    break;
+	  case fcl::BV_kIOS:
+	    refillPolyhedron <fcl::kIOS> (geometry, vertices, triangles);
+	    break;
+	  case fcl::BV_OBBRSS:
+	    refillPolyhedron <fcl::OBBRSS> (geometry, vertices, triangles);
+	    break;
+	  default:
+	    checkBoundingVolume (geometry->getNodeType ());
 	  }
-
-	std::vector<unsigned> subMeshIndexes;
-	int res = mesh->beginModel ();
-	if (res != fcl::BVH_OK) {
-	  std::ostringstream error;
-	  error << "fcl BVHReturnCode = " << res;
-	  throw std::runtime_error (error.str ());
 	}
-	vertices_.clear ();
-	triangles_.clear ();
-	buildMesh (scale, scene, scene->mRootNode, subMeshIndexes, mesh);
-	mesh->addSubModel (vertices_, triangles_);
-	mesh->endModel ();
+      } // end of anonymous namespace.
+
+      void Parser::boundingVolume (fcl::NODE_TYPE type)
+      {
+	checkBoundingVolume (type);
+	boundingVolume_ = type;
+      }
 
+      fcl::NODE_TYPE Parser::boundingVolume () const
+      {
+	return boundingVolume_;
+      }
+
+      void Parser::weldTolerance (double tolerance)
+      {
+	weldTolerance_ = tolerance;
+      }
+
+      double Parser::weldTolerance () const
+      {
+	return weldTolerance_;
       }
 
-      void Parser::loadPolyhedronFromResource
-      (const std::string& resource_path, const ::urdf::Vector3& scale,
-       const PolyhedronPtrType& polyhedron)
+      void Parser::nativeMeshReaders (bool native)
       {
-	Assimp::Importer importer;
-	importer.SetIOHandler(new ResourceIOSystem());
-	const aiScene* scene = importer.ReadFile
-	  (resource_path, aiProcess_SortByPType|
-	   aiProcess_GenNormals|aiProcess_Triangulate|aiProcess_GenUVCoords|
-	   aiProcess_FlipUVs);
-	if (!scene) {
-	  throw std::runtime_error (std::string ("Could not load resource ") +
-				    resource_path + std::string ("\n") +
-				    importer.GetErrorString ());
+	nativeMeshReaders_ = native;
+      }
+
+      bool Parser::nativeMeshReaders () const
+      {
+	return nativeMeshReaders_;
+      }
+
+      void Parser::resourceResolver (const ResourceResolver_t& resolver)
+      {
+	resourceResolver_ = resolver;
+      }
+
+      const ResourceResolver_t& Parser::resourceResolver () const
+      {
+	return resourceResolver_;
+      }
+
+      void Parser::sharedMeshStore (const std::string& name, std::size_t size)
+      {
+	if (name.empty ()) {
+	  meshStore_.reset ();
+	} else {
+	  meshStore_.reset (new SharedMeshStore (name, size));
 	}
+      }
 
-	meshFromAssimpScene (resource_path, scale, scene, polyhedron);
+      std::string Parser::sharedMeshStore () const
+      {
+	return meshStore_ ? meshStore_->name () : std::string ();
+      }
+
+      bool Parser::removeSharedMeshStore (const std::string& name)
+      {
+	return SharedMeshStore::remove (name);
+      }
+
+      void Parser::splitMeshes (std::size_t maxTriangles,
+				std::size_t nbThreads)
+      {
+	splitTriangles_ = maxTriangles;
+	splitThreads_ = nbThreads;
+      }
+
+      std::size_t Parser::splitMeshes () const
+      {
+	return splitTriangles_;
+      }
+
+      std::size_t Parser::meshChunks (std::size_t nbTriangles) const
+      {
+	if (splitTriangles_ == 0 || nbTriangles <= splitTriangles_) return 1;
+	return (nbTriangles + splitTriangles_ - 1) / splitTriangles_;
+      }
+
+      const Topology& Parser::topology () const
+      {
+	return topology_;
+      }
+
+      const Parser::MeshStatistics_t& Parser::meshStatistics () const
+      {
+	return meshStatistics_;
+      }
+
+      Parser::ScratchStatistics Parser::scratchStatistics () const
+      {
+	return meshArena_->statistics ();
+      }
+
+      void Parser::loadMesh (const std::string& resourceName,
+			     const ::urdf::Vector3& scale, MeshBuffers& mesh)
+      {
+	MeshStatistics statistics;
+	urdf::loadMesh (resourceName, scale, weldTolerance_, nativeMeshReaders_,
+			mesh, statistics, prefetcher_ ?
+			prefetchResolver (prefetcher_) : resourceResolver_);
+	boost::mutex::scoped_lock lock (meshStatisticsMutex_);
+	meshStatistics_.push_back (statistics);
+      }
+
+      std::string Parser::meshVersion (const std::string& resourceName)
+	const
+      {
+	return resourceVersion (resourceName, prefetcher_ ?
+				prefetchResolver (prefetcher_) :
+				resourceResolver_);
       }
 
       void Parser::addSolidComponentToJoint (const UrdfLinkConstPtrType& link,
 					     const JointPtr_t& joint)
+      {
+	if (deferGeometry_) {
+	  hppDout (info, "Deferring geometry of link " << link->name);
+	  pendingGeometry_ [joint->name ()] = link;
+	  return;
+	}
+	addGeometryToJoint (link, joint, createGeometry (link));
+      }
+
+      Parser::CollisionGeometries_t
+      Parser::createGeometry (const UrdfLinkConstPtrType& link)
       {
 	boost::shared_ptr < ::urdf::Collision> collision = link->collision;
+	CollisionGeometries_t geometries;
 	fcl::CollisionGeometryPtr_t geometry;
 
 	// Handle the case where collision geometry is a mesh
@@ -704,12 +803,56 @@ namespace hpp
 	  std::string collisionFilename = collisionGeometry->filename;
 	  ::urdf::Vector3 scale = collisionGeometry->scale;
 
-	  // Create FCL mesh by parsing Collada file.
-	  PolyhedronPtrType  polyhedron (new PolyhedronType);
-
-	  // name is stored in link->name
-	  loadPolyhedronFromResource (collisionFilename, scale, polyhedron);
-	  geometry = polyhedron;
+	  fcl::NODE_TYPE type = boundingVolume_;
+	  // Local files are versioned without being read. Other resources
+	  // are hashed only when the shared store needs their version,
+	  // update versions them otherwise.
+	  std::string path, version;
+	  if (meshStore_ || localPath (collisionFilename, path)) {
+	    version = meshVersion (collisionFilename);
+	    boost::mutex::scoped_lock lock (meshStatisticsMutex_);
+	    meshVersions_ [collisionFilename] = version;
+	  }
+	  // The version keeps other processes from mapping a mesh stored
+	  // before the file changed. Parameters are printed exactly, so
+	  // that close values do not share a key.
+	  std::ostringstream key;
+	  key.precision (17);
+	  key << collisionFilename << " " << version << " " << scale.x << " "
+	      << scale.y << " " << scale.z << " " << weldTolerance_ << " "
+	      << nativeMeshReaders_;
+	  SharedMesh shared;
+	  if (meshStore_ && meshStore_->find (key.str (), shared) &&
+	      meshChunks (shared.nbTriangles) == 1) {
+	    hppDout (info, "Mapping shared mesh " << collisionFilename);
+	    geometry = createSharedPolyhedron (type, meshStore_, shared);
+	  } else {
+	    // Create FCL mesh by parsing Collada file.
+	    ScopedMeshBuffers mesh (*meshArena_);
+	    loadMesh (collisionFilename, scale, *mesh);
+	    std::size_t nbChunks = meshChunks (mesh->triangles.size ());
+	    if (nbChunks > 1) {
+	      hppDout (info, "Splitting mesh " << collisionFilename << " of "
+		       << mesh->triangles.size () << " triangles into "
+		       << nbChunks << " chunks");
+	      MeshChunks_t chunks;
+	      splitMesh (mesh->vertices, mesh->triangles, nbChunks, chunks);
+	      geometries = createPolyhedra (type, chunks, splitThreads_);
+	    } else if (meshStore_) {
+	      try {
+		shared = meshStore_->insert (key.str (), mesh->vertices,
+					     mesh->triangles);
+		geometry = createSharedPolyhedron (type, meshStore_, shared);
+	      } catch (const boost::interprocess::bad_alloc&) {
+		hppDout (error, "No room for " << collisionFilename
+			 << " in shared mesh store " << meshStore_->name ());
+	      }
+	    }
+	    if (geometries.empty () && !geometry) {
+	      geometry = createPolyhedron (type, mesh->vertices,
+					   mesh->triangles);
+	    }
+	  }
 	}
 
 	// Handle the case where collision geometry is a cylinder
@@ -738,12 +881,27 @@ namespace hpp
 
 	  geometry = fcl::CollisionGeometryPtr_t (new fcl::Box (x, y, z));
 	}
+	if (geometry) geometries.push_back (geometry);
+	return geometries;
+      }
+
+      void Parser::addGeometryToJoint
+      (const UrdfLinkConstPtrType& link, const JointPtr_t& joint,
+       const CollisionGeometries_t& geometries)
+      {
 	// Compute body position in world frame.
 	MatrixHomogeneousType position =
-	  computeBodyAbsolutePosition (link, collision->origin);
-	if (geometry) {
+	  computeBodyAbsolutePosition (link, link->collision->origin);
+	{
+	  boost::mutex::scoped_lock lock (meshStatisticsMutex_);
+	  linkChunks_ [link->name] = geometries.size ();
+	}
+	for (std::size_t i = 0; i < geometries.size (); ++i) {
+	  std::ostringstream name;
+	  name << link->name;
+	  if (geometries.size () > 1) name << "_" << i;
 	  CollisionObjectPtr_t collisionObject
-	    (CollisionObject::create (geometry, position, link->name));
+	    (CollisionObject::create (geometries [i], position, name.str ()));
 
 	  // Add solid component.
 	  Body* body = joint->linkedBody ();
@@ -779,54 +937,6 @@ namespace hpp
 	robot->gaze (dir, origin);
       }
 
-      std::vector<std::string>
-      Parser::getChildrenJoint (const std::string& jointName)
-      {
-	std::vector<std::string> result;
-	getChildrenJoint (jointName, result);
-	return result;
-      }
-
-      void
-      Parser::getChildrenJoint (const std::string& jointName,
-				std::vector<std::string>& result)
-      {
-	typedef boost::shared_ptr < ::urdf::Joint> jointPtr_t;
-
-	boost::shared_ptr <const ::urdf::Joint> joint =
-	  model_.getJoint (jointName);
-
-	if (!joint && jointName.compare (0, 10, "base_joint") != 0) {
-	  std::string msg ("Failed to retrieve children joints of joint ");
-	  msg += std::string (jointName);
-	  throw std::runtime_error (msg);
-	}
-
-	boost::shared_ptr <const ::urdf::Link> childLink;
-	if (jointName.compare (0, 10, "base_joint") == 0)
-	  childLink = model_.getRoot ();
-	else
-	  childLink = model_.getLink (joint->child_link_name);
-
-	if (!childLink)
-	  {
-	    std::string msg ("Failed to retrieve children link of joint ");
-	    msg += std::string (jointName);
-	    throw std::runtime_error (msg);
-	  }
-
-	const std::vector<jointPtr_t>& jointChildren =
-	  childLink->child_joints;
-
-	BOOST_FOREACH (const jointPtr_t& joint, jointChildren)
-	  {
-	    if (jointsMap_.count(joint->name) > 0)
-	      result.push_back (joint->name);
-	    else
-	      getChildrenJoint (joint->name, result);
-	  }
-      }
-
       void
       Parser::createFreeflyerJoint (const std::string& name,
 				    const MatrixHomogeneousType& mat,
@@ -1005,6 +1115,30 @@ namespace hpp
 	return it->second;
       }
 
+      void Parser::deferGeometry (bool defer)
+      {
+	deferGeometry_ = defer;
+      }
+
+      void Parser::loadGeometry (const std::string& jointName)
+      {
+	std::map <std::string, UrdfLinkConstPtrType>::iterator it =
+	  pendingGeometry_.find (jointName);
+	if (it == pendingGeometry_.end ()) return;
+	UrdfLinkConstPtrType link = it->second;
+	pendingGeometry_.erase (it);
+	addGeometryToJoint (link, findJoint (jointName),
+			    createGeometry (link));
+      }
+
+      void Parser::loadGeometry ()
+      {
+	while (!pendingGeometry_.empty ())
+	  loadGeometry (pendingGeometry_.begin ()->first);
+	meshArena_->clear ();
+	prefetcher_.reset ();
+      }
+
       Parser::MatrixHomogeneousType
       Parser::poseToMatrix (::urdf::Pose p)
       {
@@ -1021,16 +1155,12 @@ namespace hpp
       }
 
       Parser::MatrixHomogeneousType
-      Parser::getPoseInReferenceFrame (const std::string& referenceJointName,
+      Parser::getPoseInReferenceFrame (const ::urdf::Model& model,
+				       const std::string& referenceJointName,
 				       const std::string& currentJointName)
       {
-	if (referenceJointName == currentJointName)
-	  return poseToMatrix
-	    (model_.getJoint
-	     (currentJointName)->parent_to_joint_origin_transform);
-
 	// Retrieve corresponding joint in URDF tree.
-	UrdfJointConstPtrType joint = model_.getJoint (currentJointName);
+	UrdfJointConstPtrType joint = model.getJoint (currentJointName);
 	if (!joint)
 	  {
 	    hppDout (error,
@@ -1040,26 +1170,19 @@ namespace hpp
 	    return result;
 	  }
 
-	// Get transform from parent link to joint.
-	::urdf::Pose jointToParentTransform =
-	    joint->parent_to_joint_origin_transform;
-
-	MatrixHomogeneousType transform = poseToMatrix (jointToParentTransform);
-
-	// Get parent joint name.
-	std::string parentLinkName = joint->parent_link_name;
-	UrdfLinkConstPtrType parentLink = model_.getLink (parentLinkName);
-
-	if (!parentLink)
-	  return transform;
-	UrdfJointConstPtrType parentJoint = parentLink->parent_joint;
-	if (!parentJoint)
-	  return transform;
-
-	// Compute previous transformation with current one.
-	transform =
-	  getPoseInReferenceFrame (referenceJointName,
-				   parentJoint->name) * transform;
+	// Compose transforms from parent links to joints up to the
+	// reference joint or the root link.
+	MatrixHomogeneousType transform =
+	  poseToMatrix (joint->parent_to_joint_origin_transform);
+	while (joint->name != referenceJointName) {
+	  UrdfLinkConstPtrType parentLink =
+	    model.getLink (joint->parent_link_name);
+	  if (!parentLink || !parentLink->parent_joint)
+	    break;
+	  joint = parentLink->parent_joint;
+	  transform =
+	    poseToMatrix (joint->parent_to_joint_origin_transform) * transform;
+	}
 	return transform;
       }
 
@@ -1070,6 +1193,11 @@ namespace hpp
 	model_.clear ();
 	rootJoint_ = 0;
 	jointsMap_.clear ();
+	pendingGeometry_.clear ();
+	meshStatistics_.clear ();
+	meshVersions_.clear ();
+	linkChunks_.clear ();
+	meshArena_->resetStatistics ();
 
 	// Parse urdf model.
 	if (!model_.initParam (parameterName)) {
@@ -1082,21 +1210,24 @@ namespace hpp
       void Parser::parse (const std::string& filename)
       {
 	hppDout (info, "filename: " << filename);
-	resource_retriever::Retriever resourceRetriever;
-
-	resource_retriever::MemoryResource resource =
-	  resourceRetriever.get(filename);
-	std::string robotDescription;
-	robotDescription.resize(resource.size);
-	unsigned i = 0;
-	for (; i < resource.size; ++i)
-	  robotDescription[i] = resource.data.get()[i];
+	Resource resource = retrieveResource (filename);
+	std::string robotDescription
+	  (reinterpret_cast <const char*> (resource.data ()), resource.size ());
+	parseString (robotDescription);
+      }
 
+      void Parser::parseString (const std::string& robotDescription)
+      {
 	// Reset the attributes to avoid problems when loading
 	// multiple robots using the same object.
 	model_.clear ();
 	rootJoint_ = 0;
 	jointsMap_.clear ();
+	pendingGeometry_.clear ();
+	meshStatistics_.clear ();
+	meshVersions_.clear ();
+	linkChunks_.clear ();
+	meshArena_->resetStatistics ();
 
 	// Parse urdf model.
 	if (!model_.initString (robotDescription)) {
@@ -1106,8 +1237,33 @@ namespace hpp
 	buildRobot ();
       }
 
+      void Parser::prefetchMeshes ()
+      {
+	prefetcher_.reset ();
+	std::set <std::string> uris;
+	for (std::map <std::string, UrdfLinkPtrType>::const_iterator it =
+	       model_.links_.begin (); it != model_.links_.end (); ++it) {
+	  boost::shared_ptr < ::urdf::Collision> collision =
+	    it->second->collision;
+	  if (collision && collision->geometry &&
+	      collision->geometry->type == ::urdf::Geometry::MESH) {
+	    uris.insert (boost::static_pointer_cast < ::urdf::Mesh>
+			 (collision->geometry)->filename);
+	  }
+	}
+	if (uris.empty ()) return;
+	hppDout (info, "Prefetching " << uris.size () << " meshes");
+	prefetcher_.reset (new ResourcePrefetcher
+			   (std::vector <std::string> (uris.begin (),
+						       uris.end ()),
+			    resourceResolver_));
+      }
+
       void Parser::buildRobot ()
       {
+	// Retrieve meshes while the kinematic tree is built.
+	prefetchMeshes ();
+
 	// Get names of special joints.
 	findSpecialJoints ();
 
@@ -1128,6 +1284,443 @@ namespace hpp
 	connectJoints (rootJoint_);
 	// Add corresponding body (link) to each joint.
 	addBodiesToJoints ();
+	topology_ = urdf::topology (robot_);
+	meshArena_->clear ();
+	// Deferred geometries still need the prefetched meshes.
+	if (pendingGeometry_.empty ()) prefetcher_.reset ();
+      }
+
+      namespace
+      {
+	bool operator== (const ::urdf::Vector3& v1, const ::urdf::Vector3& v2)
+	{
+	  return v1.x == v2.x && v1.y == v2.y && v1.z == v2.z;
+	}
+
+	bool samePose (const ::urdf::Pose& p1, const ::urdf::Pose& p2)
+	{
+	  return p1.position == p2.position &&
+	    p1.rotation.x == p2.rotation.x && p1.rotation.y == p2.rotation.y &&
+	    p1.rotation.z == p2.rotation.z && p1.rotation.w == p2.rotation.w;
+	}
+
+	bool sameLimits (const Parser::UrdfJointLimitsPtrType& l1,
+			 const Parser::UrdfJointLimitsPtrType& l2)
+	{
+	  if (!l1 || !l2) return !l1 && !l2;
+	  return l1->lower == l2->lower && l1->upper == l2->upper;
+	}
+
+	bool sameInertial (const boost::shared_ptr < ::urdf::Inertial>& i1,
+			   const boost::shared_ptr < ::urdf::Inertial>& i2)
+	{
+	  if (!i1 || !i2) return !i1 && !i2;
+	  return samePose (i1->origin, i2->origin) && i1->mass == i2->mass &&
+	    i1->ixx == i2->ixx && i1->ixy == i2->ixy && i1->ixz == i2->ixz &&
+	    i1->iyy == i2->iyy && i1->iyz == i2->iyz && i1->izz == i2->izz;
+	}
+
+	bool sameGeometry (const boost::shared_ptr < ::urdf::Geometry>& g1,
+			   const boost::shared_ptr < ::urdf::Geometry>& g2)
+	{
+	  switch (g1->type) {
+	  case ::urdf::Geometry::MESH:
+	    {
+	      boost::shared_ptr < ::urdf::Mesh> m1 =
+		boost::dynamic_pointer_cast < ::urdf::Mesh> (g1);
+	      boost::shared_ptr < ::urdf::Mesh> m2 =
+		boost::dynamic_pointer_cast < ::urdf::Mesh> (g2);
+	      return m1->filename == m2->filename && m1->scale == m2->scale;
+	    }
+	  case ::urdf::Geometry::BOX:
+	    return boost::dynamic_pointer_cast < ::urdf::Box> (g1)->dim ==
+	      boost::dynamic_pointer_cast < ::urdf::Box> (g2)->dim;
+	  case ::urdf::Geometry::CYLINDER:
+	    {
+	      boost::shared_ptr < ::urdf::Cylinder> c1 =
+		boost::dynamic_pointer_cast < ::urdf::Cylinder> (g1);
+	      boost::shared_ptr < ::urdf::Cylinder> c2 =
+		boost::dynamic_pointer_cast < ::urdf::Cylinder> (g2);
+	      return c1->radius == c2->radius && c1->length == c2->length;
+	    }
+	  default:
+	    // Other geometries are not loaded.
+	    return true;
+	  }
+	}
+      } // end of anonymous namespace.
+
+      void Parser::checkUpdate (const ::urdf::Model& model,
+				MapHppJointType& joints)
+      {
+	const std::string fullReload (", the robot must be fully reloaded");
+	if (model.links_.size () != model_.links_.size () ||
+	    model.joints_.size () != model_.joints_.size () ||
+	    model.getRoot ()->name != model_.getRoot ()->name) {
+	  throw std::runtime_error ("Kinematic tree changed" + fullReload);
+	}
+	for (MapJointType::const_iterator it = model.joints_.begin ();
+	     it != model.joints_.end (); ++it) {
+	  UrdfJointConstPtrType joint = it->second;
+	  UrdfJointConstPtrType previous = model_.getJoint (it->first);
+	  if (!previous || previous->type != joint->type ||
+	      previous->parent_link_name != joint->parent_link_name ||
+	      previous->child_link_name != joint->child_link_name) {
+	    throw std::runtime_error ("Joint " + it->first + " changed" +
+				      fullReload);
+	  }
+	  if (!(previous->axis == joint->axis)) {
+	    throw std::runtime_error ("Axis of joint " + it->first +
+				      " changed" + fullReload);
+	  }
+	  // Floating joints are built as a translation joint followed by
+	  // a rotation joint, the latter carries the child link.
+	  MapHppJointType::const_iterator hppJoint =
+	    jointsMap_.find (joint->type == ::urdf::Joint::FLOATING ?
+			     it->first + "_SO3" : it->first);
+	  if (hppJoint == jointsMap_.end () || !hppJoint->second) {
+	    throw std::runtime_error ("Joint " + it->first + " not found.");
+	  }
+	  joints [it->first] = hppJoint->second;
+	  if (!samePose (joint->parent_to_joint_origin_transform,
+			 previous->parent_to_joint_origin_transform) &&
+	      (joint->type == ::urdf::Joint::FLOATING ||
+	       !hppJoint->second->parentJoint ())) {
+	    throw std::runtime_error ("Origin of joint " + it->first +
+				      " cannot be moved" + fullReload);
+	  }
+	}
+	for (std::map <std::string, UrdfLinkPtrType>::const_iterator it =
+	       model.links_.begin (); it != model.links_.end (); ++it) {
+	  UrdfLinkConstPtrType link = it->second;
+	  UrdfLinkConstPtrType previous = model_.getLink (it->first);
+	  if (!previous) {
+	    throw std::runtime_error ("Link " + it->first + " added" +
+				      fullReload);
+	  }
+	  JointPtr_t joint = link->parent_joint ?
+	    joints [link->parent_joint->name] : rootJoint_;
+	  if (!joint->linkedBody () &&
+	      !sameInertial (link->inertial, previous->inertial)) {
+	    throw std::runtime_error ("Link " + it->first + " has no body" +
+				      fullReload);
+	  }
+	  if (!link->collision || !previous->collision) {
+	    if (link->collision || previous->collision) {
+	      throw std::runtime_error ("Collision geometry of link " +
+					it->first + " added or removed" +
+					fullReload);
+	    }
+	    continue;
+	  }
+	  if (link->collision->geometry->type !=
+	      previous->collision->geometry->type) {
+	    throw std::runtime_error ("Collision geometry type of link " +
+				      it->first + " changed" + fullReload);
+	  }
+	}
+      }
+
+      struct Parser::SolidComponentUpdate
+      {
+	UrdfLinkConstPtrType link;
+	/// Collision objects of the link, one per chunk for split meshes.
+	std::vector <CollisionObjectPtr_t> objects;
+	bool geometryChanged;
+	bool originChanged;
+	/// Vertices and triangles of a mesh, one chunk per object.
+	MeshChunks_t chunks;
+	/// Version of the mesh resource, see meshVersion.
+	std::string meshVersion;
+
+	SolidComponentUpdate () : link (), objects (), geometryChanged (false),
+				  originChanged (false), chunks (),
+				  meshVersion ()
+	{}
+      }; // struct Parser::SolidComponentUpdate
+
+      void Parser::prepareSolidComponent (const UrdfLinkConstPtrType& link,
+					  const JointPtr_t& joint,
+					  SolidComponentUpdate& update)
+      {
+	Body* body = joint->linkedBody ();
+	if (!body) {
+	  throw std::runtime_error ("Link " + link->name + " has no body");
+	}
+	update.link = link;
+	// Split meshes have one object per chunk, named after the link with
+	// the index of the chunk as suffix. Names are rebuilt from the
+	// number of chunks recorded when the objects were created, so that
+	// objects of other links, such as link_1 next to link, are not
+	// taken.
+	std::size_t nbChunks = 0;
+	{
+	  boost::mutex::scoped_lock lock (meshStatisticsMutex_);
+	  std::map <std::string, std::size_t>::const_iterator chunks =
+	    linkChunks_.find (link->name);
+	  if (chunks != linkChunks_.end ()) nbChunks = chunks->second;
+	}
+	std::vector <std::string> names;
+	for (std::size_t i = 0; i < nbChunks; ++i) {
+	  std::ostringstream name;
+	  name << link->name;
+	  if (nbChunks > 1) name << "_" << i;
+	  names.push_back (name.str ());
+	}
+	update.objects.resize (nbChunks);
+	for (ObjectVector_t::const_iterator it =
+	       body->innerObjects (COLLISION).begin ();
+	     it != body->innerObjects (COLLISION).end (); ++it) {
+	  std::vector <std::string>::const_iterator name =
+	    std::find (names.begin (), names.end (), (*it)->name ());
+	  if (name != names.end ()) {
+	    update.objects [name - names.begin ()] = *it;
+	  }
+	}
+	if (nbChunks == 0 ||
+	    std::find (update.objects.begin (), update.objects.end (),
+		       CollisionObjectPtr_t ()) != update.objects.end ()) {
+	  throw std::runtime_error ("No collision object for link " +
+				    link->name);
+	}
+	if (!update.geometryChanged) return;
+
+	boost::shared_ptr < ::urdf::Geometry> urdfGeometry =
+	  link->collision->geometry;
+	const fcl::CollisionGeometry* geometry =
+	  update.objects [0]->fcl ()->collisionGeometry ().get ();
+	switch (urdfGeometry->type) {
+	case ::urdf::Geometry::MESH:
+	  {
+	    boost::shared_ptr < ::urdf::Mesh> mesh =
+	      boost::dynamic_pointer_cast < ::urdf::Mesh> (urdfGeometry);
+	    if (update.meshVersion.empty ()) {
+	      update.meshVersion = meshVersion (mesh->filename);
+	    }
+	    ScopedMeshBuffers buffers (*meshArena_);
+	    loadMesh (mesh->filename, mesh->scale, *buffers);
+	    if (update.objects.size () == 1) {
+	      update.chunks.resize (1);
+	      update.chunks [0].vertices.swap (buffers->vertices);
+	      update.chunks [0].triangles.swap (buffers->triangles);
+	      break;
+	    }
+	    // A mesh with fewer triangles than chunks repeats its last
+	    // chunk.
+	    splitMesh (buffers->vertices, buffers->triangles,
+		       update.objects.size (), update.chunks);
+	    if (update.chunks.empty ()) update.chunks.resize (1);
+	  }
+	  break;
+	case ::urdf::Geometry::CYLINDER:
+	  if (!dynamic_cast <const fcl::Capsule*> (geometry)) {
+	    throw std::runtime_error ("Collision object of link " + link->name
+				      + " is not a capsule");
+	  }
+	  break;
+	case ::urdf::Geometry::BOX:
+	  if (!dynamic_cast <const fcl::Box*> (geometry)) {
+	    throw std::runtime_error ("Collision object of link " + link->name
+				      + " is not a box");
+	  }
+	  break;
+	default:
+	  update.geometryChanged = false;
+	}
+      }
+
+      void Parser::updateSolidComponent (const SolidComponentUpdate& update)
+      {
+	const UrdfLinkConstPtrType& link = update.link;
+	const std::vector <CollisionObjectPtr_t>& objects = update.objects;
+	// Geometries are modified in place so that the collision objects
+	// and the collision pairs referring to them remain valid.
+	CollisionGeometries_t geometries;
+	for (std::size_t i = 0; i < objects.size (); ++i) {
+	  geometries.push_back (boost::const_pointer_cast
+				<fcl::CollisionGeometry>
+				(objects [i]->fcl ()->collisionGeometry ()));
+	}
+	fcl::CollisionGeometryPtr_t geometry = geometries [0];
+	boost::shared_ptr < ::urdf::Geometry> urdfGeometry =
+	  link->collision->geometry;
+	if (update.geometryChanged) {
+	  switch (urdfGeometry->type) {
+	  case ::urdf::Geometry::MESH:
+	    {
+	      const MeshChunks_t& chunks = update.chunks;
+	      // beginModel discards the previous vertices and triangles.
+	      if (objects.size () == 1) detachSharedPolyhedron (geometry);
+	      for (std::size_t i = 0; i < geometries.size (); ++i) {
+		const MeshChunk& chunk =
+		  chunks [std::min (i, chunks.size () - 1)];
+		refillPolyhedron (geometries [i], chunk.vertices,
+				  chunk.triangles);
+	      }
+	      boost::mutex::scoped_lock lock (meshStatisticsMutex_);
+	      meshVersions_
+		[boost::dynamic_pointer_cast < ::urdf::Mesh> (urdfGeometry)->
+		 filename] = update.meshVersion;
+	    }
+	    break;
+	  case ::urdf::Geometry::CYLINDER:
+	    {
+	      boost::shared_ptr < ::urdf::Cylinder> cylinder =
+		boost::dynamic_pointer_cast < ::urdf::Cylinder> (urdfGeometry);
+	      boost::shared_ptr <fcl::Capsule> capsule =
+		boost::dynamic_pointer_cast <fcl::Capsule> (geometry);
+	      capsule->radius = cylinder->radius;
+	      capsule->lz = cylinder->length;
+	    }
+	    break;
+	  case ::urdf::Geometry::BOX:
+	    {
+	      ::urdf::Vector3 dim =
+		boost::dynamic_pointer_cast < ::urdf::Box> (urdfGeometry)->dim;
+	      boost::dynamic_pointer_cast <fcl::Box> (geometry)->side =
+		fcl::Vec3f (dim.x, dim.y, dim.z);
+	    }
+	    break;
+	  default:
+	    break;
+	  }
+	}
+	if (update.originChanged) {
+	  // Positions in world frame are computed by forward kinematics.
+	  MatrixHomogeneousType position =
+	    positionInJointFrame (link, link->collision->origin);
+	  for (std::size_t i = 0; i < objects.size (); ++i) {
+	    objects [i]->positionInJointFrame (position);
+	  }
+	}
+	for (std::size_t i = 0; i < objects.size (); ++i) {
+	  geometries [i]->computeLocalAABB ();
+	  objects [i]->fcl ()->computeAABB ();
+	  hppDout (info, "Updated object " << objects [i]->name ());
+	}
+      }
+
+      std::vector <std::string>
+      Parser::update (const std::string& resourceName)
+      {
+	if (!rootJoint_) {
+	  throw std::runtime_error ("No robot has been loaded by this parser");
+	}
+	// Prefetched meshes may have been modified since.
+	prefetcher_.reset ();
+	Resource resource = retrieveResource (resourceName);
+	std::string robotDescription
+	  (reinterpret_cast <const char*> (resource.data ()), resource.size ());
+	::urdf::Model model;
+	if (!model.initString (robotDescription)) {
+	  throw std::runtime_error ("Failed to open urdf file. "
+				    "robotDescription:\n" + robotDescription);
+	}
+	MapHppJointType joints;
+	checkUpdate (model, joints);
+
+	// Changed meshes are loaded before anything is modified, so that
+	// the robot is left unchanged if one of them cannot be loaded.
+	std::list <SolidComponentUpdate> solids;
+	try {
+	  for (std::map <std::string, UrdfLinkPtrType>::const_iterator it =
+		 model.links_.begin (); it != model.links_.end (); ++it) {
+	    UrdfLinkConstPtrType link = it->second;
+	    UrdfLinkConstPtrType old = model_.getLink (it->first);
+	    if (!link->collision) continue;
+	    bool geometryChanged = !sameGeometry (link->collision->geometry,
+						  old->collision->geometry);
+	    std::string version;
+	    if (!geometryChanged &&
+		link->collision->geometry->type == ::urdf::Geometry::MESH) {
+	      // Meshes may be modified under the same name.
+	      const std::string& filename = boost::dynamic_pointer_cast
+		< ::urdf::Mesh> (link->collision->geometry)->filename;
+	      // Meshes that were not versioned when loaded are reloaded
+	      // once, so that later updates compare their versions.
+	      std::map <std::string, std::string>::const_iterator recorded =
+		meshVersions_.find (filename);
+	      version = meshVersion (filename);
+	      geometryChanged = recorded == meshVersions_.end () ||
+		recorded->second != version;
+	    }
+	    bool originChanged = !samePose (link->collision->origin,
+					    old->collision->origin);
+	    if (!geometryChanged && !originChanged) continue;
+	    JointPtr_t joint = link->parent_joint ?
+	      joints [link->parent_joint->name] : rootJoint_;
+	    solids.push_back (SolidComponentUpdate ());
+	    solids.back ().meshVersion = version;
+	    solids.back ().geometryChanged = geometryChanged;
+	    solids.back ().originChanged = originChanged;
+	    prepareSolidComponent (link, joint, solids.back ());
+	  }
+	} catch (...) {
+	  meshArena_->clear ();
+	  throw;
+	}
+
+	for (MapJointType::const_iterator it = model.joints_.begin ();
+	     it != model.joints_.end (); ++it) {
+	  UrdfJointConstPtrType joint = it->second;
+	  UrdfJointConstPtrType old = model_.getJoint (it->first);
+	  JointPtr_t hppJoint = joints [it->first];
+
+	  if (!samePose (joint->parent_to_joint_origin_transform,
+			 old->parent_to_joint_origin_transform)) {
+	    hppDout (info, "Moving joint " << it->first);
+	    // Positions of the descendants with respect to their parent do
+	    // not change.
+	    JointPtr_t parent = hppJoint->parentJoint ();
+	    MatrixHomogeneousType parentPosition = parent->initialPosition ();
+	    if (model.getJoint (parent->name ())) {
+	      parentPosition = getPoseInReferenceFrame
+		(model, "base_footprint_joint", parent->name ()) *
+		inverse (parent->linkInJointFrame ());
+	    }
+	    MatrixHomogeneousType position = getPoseInReferenceFrame
+	      (model, "base_footprint_joint", it->first) *
+	      inverse (hppJoint->linkInJointFrame ());
+	    hppJoint->positionInParentFrame (inverse (parentPosition) *
+					     position);
+	  }
+	  if ((joint->type == ::urdf::Joint::REVOLUTE ||
+	       joint->type == ::urdf::Joint::PRISMATIC) &&
+	      !sameLimits (joint->limits, old->limits)) {
+	    hppDout (info, "Updating bounds of joint " << it->first);
+	    if (joint->limits) {
+	      hppJoint->isBounded (0, true);
+	      hppJoint->lowerBound (0, joint->limits->lower);
+	      hppJoint->upperBound (0, joint->limits->upper);
+	    } else {
+	      hppJoint->isBounded (0, false);
+	      hppJoint->lowerBound (0, -numeric_limits <double>::infinity ());
+	      hppJoint->upperBound (0, numeric_limits <double>::infinity ());
+	    }
+	  }
+	}
+
+	for (std::map <std::string, UrdfLinkPtrType>::const_iterator it =
+	       model.links_.begin (); it != model.links_.end (); ++it) {
+	  UrdfLinkConstPtrType link = it->second;
+	  UrdfLinkConstPtrType old = model_.getLink (it->first);
+	  if (!sameInertial (link->inertial, old->inertial)) {
+	    JointPtr_t joint = link->parent_joint ?
+	      joints [link->parent_joint->name] : rootJoint_;
+	    setBodyInertia (link, joint->linkedBody ());
+	  }
+	}
+	std::vector <std::string> changedLinks;
+	for (std::list <SolidComponentUpdate>::const_iterator it =
+	       solids.begin (); it != solids.end (); ++it) {
+	  updateSolidComponent (*it);
+	  changedLinks.push_back (it->link->name);
+	}
+	model_ = model;
+	robot_->computeForwardKinematics ();
+	topology_ = urdf::topology (robot_);
+	meshArena_->clear ();
+	return changedLinks;
       }
     } // end of namespace urdf.
   } // end of namespace model.
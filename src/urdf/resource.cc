@@ -0,0 +1,763 @@
+// Copyright (C) 2012, 2013, 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/resource.cc
+///
+/// \brief Implementation of resource access.
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+
+#include <resource_retriever/retriever.h>
+#include <zlib.h>
+#ifdef HPP_MODEL_URDF_WITH_ZSTD
+# include <zstd.h>
+#endif // HPP_MODEL_URDF_WITH_ZSTD
+
+#include <hpp/util/debug.hh>
+#include <hpp/util/assertion.hh>
+#include <hpp/model/urdf/package.hh>
+
+#include "http-fetcher.hh"
+#include "resource.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Read-only memory mapping of a whole file.
+	class MappedFile
+	{
+	public:
+	  MappedFile (void* address, size_t size)
+	    : address_ (address), size_ (size)
+	  {}
+
+	  ~MappedFile ()
+	  {
+	    if (address_) munmap (address_, size_);
+	  }
+
+	private:
+	  void* address_;
+	  size_t size_;
+	}; // class MappedFile
+      } // end of anonymous namespace.
+
+      Resource mapFile (const std::string& path)
+      {
+	int fd = open (path.c_str (), O_RDONLY);
+	if (fd < 0) {
+	  throw std::runtime_error ("Failed to open file " + path);
+	}
+	struct stat status;
+	if (fstat (fd, &status) != 0) {
+	  close (fd);
+	  throw std::runtime_error ("Failed to stat file " + path);
+	}
+	size_t size = status.st_size;
+	// mmap does not accept empty mappings.
+	if (size == 0) {
+	  close (fd);
+	  return Resource ();
+	}
+	void* address = mmap (0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid once the descriptor is closed.
+	close (fd);
+	if (address == MAP_FAILED) {
+	  throw std::runtime_error ("Failed to map file " + path);
+	}
+	boost::shared_ptr <const void> holder (new MappedFile (address, size));
+	return Resource (static_cast <const uint8_t*> (address), size,
+			 holder);
+      }
+
+      namespace
+      {
+	/// Resolver built by blobResolver.
+	///
+	/// retrieveResource recognizes it and serves resources from the
+	/// map without copy.
+	struct BlobResolver
+	{
+	  boost::shared_ptr <const ResourceBlobs_t> blobs;
+
+	  const std::string* find (const std::string& uri) const
+	  {
+	    ResourceBlobs_t::const_iterator it = blobs->find (uri);
+	    return it == blobs->end () ? 0 : &it->second;
+	  }
+
+	  bool operator() (const std::string& uri, std::string& content) const
+	  {
+	    const std::string* blob = find (uri);
+	    if (!blob) return false;
+	    content = *blob;
+	    return true;
+	  }
+	}; // struct BlobResolver
+
+	/// Resolver built by prefetchResolver.
+	struct PrefetchResolver
+	{
+	  boost::shared_ptr <ResourcePrefetcher> prefetcher;
+
+	  bool operator() (const std::string& uri, std::string& content) const
+	  {
+	    Resource resource;
+	    if (prefetcher->get (uri, resource)) {
+	      content.assign (reinterpret_cast <const char*> (resource.data ()),
+			      resource.size ());
+	      return true;
+	    }
+	    const ResourceResolver_t& resolver = prefetcher->resolver ();
+	    return resolver && resolver (uri, content);
+	  }
+	}; // struct PrefetchResolver
+
+	/// Maximal number of threads retrieving resources in the
+	/// background.
+	const std::size_t maxPrefetchThreads = 8;
+
+	/// Read one byte per page, so that pages of mapped files are read
+	/// from the file system.
+	void touch (const Resource& resource)
+	{
+	  volatile uint8_t byte = 0;
+	  for (size_t i = 0; i < resource.size (); i += 4096) {
+	    byte = resource.data () [i];
+	  }
+	  (void) byte;
+	}
+
+	bool hasSuffix (const std::string& name, const char* suffix)
+	{
+	  std::size_t n = std::strlen (suffix);
+	  return name.size () > n &&
+	    name.compare (name.size () - n, n, suffix) == 0;
+	}
+
+	bool hasMagic (const Resource& resource, const uint8_t* magic,
+		       std::size_t n)
+	{
+	  return resource.size () >= n &&
+	    std::memcmp (resource.data (), magic, n) == 0;
+	}
+
+	typedef std::vector <uint8_t> Buffer_t;
+
+	/// Make room at the end of a buffer that is full.
+	void grow (Buffer_t& buffer)
+	{
+	  buffer.resize (2 * buffer.size () + 4096);
+	}
+
+	/// Largest ratio of decompressed to compressed size allocated at
+	/// once.
+	const std::size_t maxInitialRatio = 16;
+
+	/// Initial size of a decompression buffer.
+	///
+	/// Sizes written in the compressed data are not trusted beyond
+	/// maxInitialRatio times the compressed size, so that a corrupted
+	/// or hostile header does not allocate gigabytes. The buffer grows
+	/// from there if needed.
+	/// \param size size announced by the compressed data, 0 if unknown.
+	std::size_t initialSize (unsigned long long size,
+				 std::size_t compressedSize)
+	{
+	  std::size_t limit = maxInitialRatio * compressedSize + 4096;
+	  if (size == 0 || size > limit) return limit;
+	  return std::size_t (size);
+	}
+
+	/// Decompress gzip or zlib data.
+	Resource inflateResource (const std::string& uri,
+				  const Resource& compressed)
+	{
+	  // The last four bytes of a gzip member hold the size of the
+	  // data modulo 2^32, so that the buffer is usually allocated
+	  // once.
+	  const uint8_t* end = compressed.data () + compressed.size ();
+	  std::size_t size = 0;
+	  if (compressed.size () >= 18) {
+	    size = std::size_t (end [-4]) | std::size_t (end [-3]) << 8 |
+	      std::size_t (end [-2]) << 16 | std::size_t (end [-1]) << 24;
+	  }
+	  boost::shared_ptr <Buffer_t> buffer
+	    (new Buffer_t (initialSize (size, compressed.size ())));
+
+	  z_stream stream;
+	  std::memset (&stream, 0, sizeof (stream));
+	  // 32 lets zlib detect gzip and zlib headers.
+	  if (inflateInit2 (&stream, 15 + 32) != Z_OK) {
+	    throw std::runtime_error ("Failed to decompress " + uri);
+	  }
+	  stream.next_in = const_cast <Bytef*> (compressed.data ());
+	  stream.avail_in = compressed.size ();
+	  std::size_t produced = 0;
+	  int res = Z_OK;
+	  while (res == Z_OK) {
+	    if (produced == buffer->size ()) grow (*buffer);
+	    stream.next_out = &(*buffer) [produced];
+	    stream.avail_out = buffer->size () - produced;
+	    res = inflate (&stream, Z_NO_FLUSH);
+	    produced = buffer->size () - stream.avail_out;
+	    // Members of a gzip file may be concatenated.
+	    if (res == Z_STREAM_END && stream.avail_in > 0) {
+	      res = inflateReset (&stream);
+	    }
+	  }
+	  inflateEnd (&stream);
+	  if (res != Z_STREAM_END) {
+	    throw std::runtime_error ("Failed to decompress " + uri +
+				      ": corrupted or truncated gzip data");
+	  }
+	  buffer->resize (produced);
+	  return Resource (buffer->empty () ? 0 : &(*buffer) [0], produced,
+			   buffer, compressed.size ());
+	}
+
+#ifdef HPP_MODEL_URDF_WITH_ZSTD
+	/// Release a zstd stream at the end of the scope.
+	class ZstdStream
+	{
+	public:
+	  ZstdStream () : stream_ (ZSTD_createDStream ())
+	  {}
+
+	  ~ZstdStream ()
+	  {
+	    ZSTD_freeDStream (stream_);
+	  }
+
+	  ZSTD_DStream* get () const
+	  {
+	    return stream_;
+	  }
+
+	private:
+	  ZstdStream (const ZstdStream&);
+	  ZstdStream& operator= (const ZstdStream&);
+
+	  ZSTD_DStream* stream_;
+	}; // class ZstdStream
+#endif // HPP_MODEL_URDF_WITH_ZSTD
+
+	/// Decompress zstd data.
+	Resource unzstdResource (const std::string& uri,
+				 const Resource& compressed)
+	{
+#ifdef HPP_MODEL_URDF_WITH_ZSTD
+	  // Frame headers usually hold the size of the data.
+	  unsigned long long size = ZSTD_getFrameContentSize
+	    (compressed.data (), compressed.size ());
+	  if (size == ZSTD_CONTENTSIZE_UNKNOWN ||
+	      size == ZSTD_CONTENTSIZE_ERROR) {
+	    size = 4 * compressed.size ();
+	  }
+	  boost::shared_ptr <Buffer_t> buffer
+	    (new Buffer_t (initialSize (size, compressed.size ())));
+
+	  ZstdStream stream;
+	  ZSTD_initDStream (stream.get ());
+	  ZSTD_inBuffer input = { compressed.data (), compressed.size (), 0 };
+	  std::size_t produced = 0;
+	  std::size_t remaining = 1;
+	  // Several frames may follow each other.
+	  while (remaining != 0 || input.pos < input.size) {
+	    if (produced == buffer->size ()) grow (*buffer);
+	    ZSTD_outBuffer output = { &(*buffer) [0], buffer->size (),
+				      produced };
+	    remaining = ZSTD_decompressStream (stream.get (), &output, &input);
+	    if (ZSTD_isError (remaining)) {
+	      throw std::runtime_error ("Failed to decompress " + uri + ": " +
+					ZSTD_getErrorName (remaining));
+	    }
+	    produced = output.pos;
+	    if (remaining != 0 && input.pos == input.size &&
+		produced < buffer->size ()) {
+	      throw std::runtime_error ("Failed to decompress " + uri +
+					": truncated zstd data");
+	    }
+	  }
+	  buffer->resize (produced);
+	  return Resource (buffer->empty () ? 0 : &(*buffer) [0], produced,
+			   buffer, compressed.size ());
+#else
+	  (void) compressed;
+	  throw std::runtime_error ("Failed to decompress " + uri +
+				    ": hpp-model-urdf is built without zstd");
+#endif // HPP_MODEL_URDF_WITH_ZSTD
+	}
+
+	/// Decompress resource if its name and content tell it is
+	/// compressed.
+	///
+	/// Resources already decompressed, such as prefetched ones, are
+	/// returned as they are.
+	Resource decompressResource (const std::string& uri,
+				     const Resource& resource)
+	{
+	  static const uint8_t gzipMagic [] = { 0x1f, 0x8b };
+	  static const uint8_t zstdMagic [] = { 0x28, 0xb5, 0x2f, 0xfd };
+	  if (hasSuffix (uri, ".gz") && hasMagic (resource, gzipMagic, 2)) {
+	    return inflateResource (uri, resource);
+	  }
+	  if (hasSuffix (uri, ".zst") && hasMagic (resource, zstdMagic, 4)) {
+	    return unzstdResource (uri, resource);
+	  }
+	  return resource;
+	}
+
+	/// Get resource from resolver.
+	/// \return whether the resolver knows the resource.
+	bool resolveResource (const std::string& uri,
+			      const ResourceResolver_t& resolver,
+			      Resource& resource)
+	{
+	  if (!resolver) return false;
+	  if (const PrefetchResolver* prefetchResolver =
+	      resolver.target <PrefetchResolver> ()) {
+	    if (prefetchResolver->prefetcher->get (uri, resource)) return true;
+	    return resolveResource (uri,
+				    prefetchResolver->prefetcher->resolver (),
+				    resource);
+	  }
+	  if (const BlobResolver* blobResolver =
+	      resolver.target <BlobResolver> ()) {
+	    const std::string* blob = blobResolver->find (uri);
+	    if (!blob) return false;
+	    resource = Resource (reinterpret_cast <const uint8_t*>
+				 (blob->data ()), blob->size (),
+				 blobResolver->blobs);
+	    return true;
+	  }
+	  boost::shared_ptr <std::string> content (new std::string ());
+	  if (!resolver (uri, *content)) return false;
+	  resource = Resource (reinterpret_cast <const uint8_t*>
+			       (content->data ()), content->size (), content);
+	  return true;
+	}
+      } // end of anonymous namespace.
+
+      ResourceResolver_t blobResolver (const ResourceBlobs_t& blobs)
+      {
+	BlobResolver resolver;
+	resolver.blobs.reset (new ResourceBlobs_t (blobs));
+	return resolver;
+      }
+
+      Resource::Resource ()
+	: data_ (0), size_ (0), holder_ (), storedSize_ (0)
+      {}
+
+      Resource::Resource (const uint8_t* data, size_t size,
+			  const boost::shared_ptr <const void>& holder)
+	: data_ (data), size_ (size), holder_ (holder), storedSize_ (size)
+      {}
+
+      Resource::Resource (const uint8_t* data, size_t size,
+			  const boost::shared_ptr <const void>& holder,
+			  size_t storedSize)
+	: data_ (data), size_ (size), holder_ (holder),
+	  storedSize_ (storedSize)
+      {}
+
+      std::string uncompressedName (const std::string& uri)
+      {
+	if (hasSuffix (uri, ".gz")) return uri.substr (0, uri.size () - 3);
+	if (hasSuffix (uri, ".zst")) return uri.substr (0, uri.size () - 4);
+	return uri;
+      }
+
+      bool localPath (const std::string& uri, std::string& path)
+      {
+	static const std::string file ("file://");
+
+	std::string resolved = resolvePackageUri (uri);
+	if (resolved.compare (0, file.size (), file) == 0) {
+	  path = resolved.substr (file.size ());
+	  return true;
+	}
+	return false;
+      }
+
+      Resource retrieveResource (const std::string& uri,
+				 const ResourceResolver_t& resolver)
+      {
+	Resource resource;
+	if (!resolveResource (uri, resolver, resource)) {
+	  std::string path;
+	  if (localPath (uri, path)) {
+	    resource = mapFile (path);
+	  } else if (HttpFetcher::isHttp (uri)) {
+	    resource = HttpFetcher::instance ().fetch (uri);
+	  } else {
+	    resource_retriever::Retriever retriever;
+	    boost::shared_ptr <resource_retriever::MemoryResource> res
+	      (new resource_retriever::MemoryResource (retriever.get (uri)));
+	    resource = Resource (res->data.get (), res->size, res);
+	  }
+	}
+	return decompressResource (uri, resource);
+      }
+
+      ResourcePrefetcher::ResourcePrefetcher
+      (const std::vector <std::string>& uris,
+       const ResourceResolver_t& resolver)
+	: resolver_ (resolver), uris_ (), next_ (0), entries_ (),
+	  stopped_ (false), mutex_ (), condition_ (), threads_ ()
+      {
+	std::vector <std::string> httpUris;
+	for (std::vector <std::string>::const_iterator it = uris.begin ();
+	     it != uris.end (); ++it) {
+	  entries_ [*it];
+	  if (HttpFetcher::isHttp (*it)) httpUris.push_back (*it);
+	  else uris_.push_back (*it);
+	}
+	std::size_t nbThreads = std::min (uris_.size (), maxPrefetchThreads);
+	for (std::size_t i = 0; i < nbThreads; ++i) {
+	  threads_.create_thread (boost::bind (&ResourcePrefetcher::fetch,
+					       this));
+	}
+	if (!httpUris.empty ()) {
+	  threads_.create_thread (boost::bind (&ResourcePrefetcher::fetchHttp,
+					       this, httpUris));
+	}
+      }
+
+      ResourcePrefetcher::~ResourcePrefetcher ()
+      {
+	{
+	  boost::mutex::scoped_lock lock (mutex_);
+	  stopped_ = true;
+	}
+	threads_.join_all ();
+      }
+
+      void ResourcePrefetcher::fetch ()
+      {
+	while (true) {
+	  std::string uri;
+	  {
+	    boost::mutex::scoped_lock lock (mutex_);
+	    if (stopped_ || next_ == uris_.size ()) return;
+	    uri = uris_ [next_++];
+	  }
+	  Resource resource;
+	  std::string error;
+	  try {
+	    resource = retrieveResource (uri, resolver_);
+	    touch (resource);
+	  } catch (const std::exception& e) {
+	    error = e.what ();
+	  }
+	  complete (uri, resource, error);
+	}
+      }
+
+      void ResourcePrefetcher::fetchHttp (const std::vector <std::string>& uris)
+      {
+	try {
+	  // Resources served by the resolver are not downloaded.
+	  std::vector <std::string> remote;
+	  for (std::vector <std::string>::const_iterator it = uris.begin ();
+	       it != uris.end (); ++it) {
+	    Resource resource;
+	    if (resolveResource (*it, resolver_, resource)) {
+	      if (!complete (*it, resource, std::string ())) return;
+	    } else {
+	      remote.push_back (*it);
+	    }
+	  }
+	  // Pending transfers are aborted when the prefetcher is
+	  // destroyed.
+	  HttpFetcher::instance ().fetch
+	    (remote, boost::bind (&ResourcePrefetcher::complete, this,
+				  _1, _2, _3),
+	     boost::bind (&ResourcePrefetcher::stopped, this));
+	} catch (const std::exception& e) {
+	  // Do not leave readers waiting for resources never retrieved.
+	  for (std::vector <std::string>::const_iterator it = uris.begin ();
+	       it != uris.end (); ++it) {
+	    boost::mutex::scoped_lock lock (mutex_);
+	    if (entries_ [*it].done) continue;
+	    lock.unlock ();
+	    complete (*it, Resource (), e.what ());
+	  }
+	}
+      }
+
+      bool ResourcePrefetcher::complete (const std::string& uri,
+					 const Resource& resource,
+					 const std::string& error)
+      {
+	Resource decompressed;
+	bool failed = !error.empty ();
+	if (failed) {
+	  hppDout (info, "Failed to prefetch " << uri << ": " << error);
+	} else {
+	  try {
+	    decompressed = decompressResource (uri, resource);
+	  } catch (const std::exception& e) {
+	    hppDout (info, "Failed to prefetch " << uri << ": " << e.what ());
+	    failed = true;
+	  }
+	}
+	bool stopped;
+	{
+	  boost::mutex::scoped_lock lock (mutex_);
+	  Entry& entry = entries_ [uri];
+	  entry.resource = decompressed;
+	  entry.done = true;
+	  entry.failed = failed;
+	  stopped = stopped_;
+	}
+	condition_.notify_all ();
+	return !stopped;
+      }
+
+      bool ResourcePrefetcher::stopped ()
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	return stopped_;
+      }
+
+      bool ResourcePrefetcher::get (const std::string& uri,
+				    Resource& resource)
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	std::map <std::string, Entry>::iterator it = entries_.find (uri);
+	if (it == entries_.end ()) return false;
+	while (!it->second.done) condition_.wait (lock);
+	if (it->second.failed) return false;
+	resource = it->second.resource;
+	return true;
+      }
+
+      ResourceResolver_t prefetchResolver
+      (const boost::shared_ptr <ResourcePrefetcher>& prefetcher)
+      {
+	PrefetchResolver resolver;
+	resolver.prefetcher = prefetcher;
+	return resolver;
+      }
+
+      bool resourceExists (const std::string& uri,
+			   const ResourceResolver_t& resolver)
+      {
+	Resource resource;
+	if (resolveResource (uri, resolver, resource)) {
+	  return true;
+	}
+	std::string path;
+	if (localPath (uri, path)) {
+	  struct stat status;
+	  return stat (path.c_str (), &status) == 0;
+	}
+	// resource_retriever has no way of checking for existence.
+	try {
+	  retrieveResource (uri);
+	} catch (const std::exception& e) {
+	  hppDout (error, e.what ());
+	  return false;
+	}
+	return true;
+      }
+
+      std::string resourceVersion (const std::string& uri,
+				   const ResourceResolver_t& resolver)
+      {
+	std::ostringstream version;
+	// Local files are versioned the same way whether resolver serves
+	// them or not, so that versions recorded while a prefetcher was
+	// alive still match afterwards.
+	std::string path;
+	struct stat status;
+	if (localPath (uri, path) && stat (path.c_str (), &status) == 0) {
+#ifdef __APPLE__
+	  long nanoseconds = status.st_mtimespec.tv_nsec;
+#else
+	  long nanoseconds = status.st_mtim.tv_nsec;
+#endif
+	  version << "file " << status.st_ino << " " << status.st_size
+		  << " " << status.st_mtime << "." << nanoseconds;
+	  return version.str ();
+	}
+	Resource resource = retrieveResource (uri, resolver);
+	// FNV-1a hash of the bytes.
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < resource.size (); ++i) {
+	  hash ^= resource.data () [i];
+	  hash *= 1099511628211ULL;
+	}
+	version << "content " << resource.size () << " " << std::hex << hash;
+	return version.str ();
+      }
+
+      ResourceIOStream::ResourceIOStream (const Resource& res)
+	: res_ (res), pos_ (res.data ())
+      {}
+
+      ResourceIOStream::~ResourceIOStream ()
+      {}
+
+      size_t ResourceIOStream::Read (void* buffer, size_t size, size_t count)
+      {
+	size_t to_read = size * count;
+	if (pos_ + to_read > res_.data () + res_.size ())
+	  {
+	    to_read = res_.size () - (pos_ - res_.data ());
+	  }
+
+	memcpy (buffer, pos_, to_read);
+	pos_ += to_read;
+
+	return to_read;
+      }
+
+      size_t ResourceIOStream::Write (const void*, size_t, size_t)
+      {
+	return 0;
+      }
+
+      aiReturn ResourceIOStream::Seek (size_t offset, aiOrigin origin)
+      {
+	const uint8_t* new_pos = 0;
+	switch (origin)
+	  {
+	  case aiOrigin_SET:
+	    new_pos = res_.data () + offset;
+	    break;
+	  case aiOrigin_CUR:
+	    new_pos = pos_ + offset; // TODO is this right?  can offset really not be negative
+	    break;
+	  case aiOrigin_END:
+	    new_pos = res_.data () + res_.size () - offset; // TODO is this right?
+	    break;
+	  default:
+	    break;
+	  }
+
+	if (new_pos < res_.data () || new_pos > res_.data () + res_.size ())
+	  {
+	    return aiReturn_FAILURE;
+	  }
+
+	pos_ = new_pos;
+	return aiReturn_SUCCESS;
+      }
+
+      size_t ResourceIOStream::Tell () const
+      {
+	return pos_ - res_.data ();
+      }
+
+      size_t ResourceIOStream::FileSize () const
+      {
+	return res_.size ();
+      }
+
+      void ResourceIOStream::Flush ()
+      {}
+
+      ResourceIOSystem::ResourceIOSystem ()
+	: resolver_ (), aliasName_ (), aliasUri_ (), storedBytes_ (0),
+	  bytes_ (0)
+      {}
+
+      void ResourceIOSystem::resolver (const ResourceResolver_t& resolver)
+      {
+	resolver_ = resolver;
+      }
+
+      void ResourceIOSystem::alias (const std::string& name,
+				    const std::string& uri)
+      {
+	aliasName_ = name;
+	aliasUri_ = name.empty () ? std::string () : uri;
+      }
+
+      void ResourceIOSystem::resetStatistics ()
+      {
+	storedBytes_ = 0;
+	bytes_ = 0;
+      }
+
+      ResourceIOSystem::~ResourceIOSystem ()
+      {}
+
+      bool ResourceIOSystem::Exists (const char* file) const
+      {
+	if (!aliasName_.empty () && aliasName_ == file) {
+	  return resourceExists (aliasUri_, resolver_);
+	}
+	return resourceExists (file, resolver_);
+      }
+
+      char ResourceIOSystem::getOsSeparator () const
+      {
+	return '/';
+      }
+
+      Assimp::IOStream* ResourceIOSystem::Open
+      (const char* file, const char* hppDebugStatement (mode))
+      {
+	HPP_ASSERT (mode == std::string("r") || mode == std::string("rb"));
+
+	Resource res;
+	try
+	  {
+	    if (!aliasName_.empty () && aliasName_ == file) {
+	      res = retrieveResource (aliasUri_, resolver_);
+	    } else {
+	      res = retrieveResource (file, resolver_);
+	    }
+	  }
+	catch (const std::exception& e)
+	  {
+	    hppDout (error, e.what ());
+	    return 0;
+	  }
+
+	storedBytes_ += res.storedSize ();
+	bytes_ += res.size ();
+	return new ResourceIOStream (res);
+      }
+
+      void ResourceIOSystem::Close (Assimp::IOStream* stream)
+      {
+	delete stream;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -0,0 +1,308 @@
+// Copyright (C) 2012, 2013, 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/resource.hh
+///
+/// \brief Access to resources (urdf, srdf and mesh files) for the parsers.
+
+#ifndef HPP_MODEL_URDF_RESOURCE
+# define HPP_MODEL_URDF_RESOURCE
+
+# include <stdint.h>
+# include <map>
+# include <string>
+# include <vector>
+
+# include <boost/shared_ptr.hpp>
+# include <boost/thread/condition_variable.hpp>
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/thread.hpp>
+
+# include <assimp/IOStream.h>
+# include <assimp/IOSystem.h>
+
+# include <hpp/model/urdf/resource-resolver.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Read-only bytes of a resource.
+      ///
+      /// Local files are memory-mapped, other resources are kept in the
+      /// buffer returned by resource_retriever. Copies of a Resource share
+      /// the same storage, which is released with the last copy.
+      class Resource
+      {
+      public:
+	Resource ();
+
+	const uint8_t* data () const
+	{
+	  return data_;
+	}
+
+	size_t size () const
+	{
+	  return size_;
+	}
+
+	/// Number of bytes read from storage, smaller than size for
+	/// compressed resources.
+	size_t storedSize () const
+	{
+	  return storedSize_;
+	}
+
+	/// Build a resource over bytes owned by holder.
+	Resource (const uint8_t* data, size_t size,
+		  const boost::shared_ptr <const void>& holder);
+
+	/// Build a resource over bytes owned by holder, decompressed from
+	/// storedSize bytes.
+	Resource (const uint8_t* data, size_t size,
+		  const boost::shared_ptr <const void>& holder,
+		  size_t storedSize);
+
+      private:
+	const uint8_t* data_;
+	size_t size_;
+	boost::shared_ptr <const void> holder_;
+	size_t storedSize_;
+      }; // class Resource
+
+      /// \brief Get path of a local resource.
+      ///
+      /// \param uri resource name using the resource_retriever format,
+      /// \retval path path of the file in the local file system.
+      /// \return whether uri designates a local file, i.e. uses the
+      ///         file:// scheme or the package:// scheme with a package
+      ///         found by packagePath.
+      bool localPath (const std::string& uri, std::string& path);
+
+      /// \brief Map a local file in memory.
+      ///
+      /// \throw std::runtime_error if the file cannot be opened.
+      Resource mapFile (const std::string& path);
+
+      /// \brief Name of a resource without its compression suffix.
+      ///
+      /// \return uri without .gz or .zst suffix, uri itself if it has
+      ///         none. Formats are deduced from the returned name.
+      std::string uncompressedName (const std::string& uri);
+
+      /// \brief Retrieve a resource.
+      ///
+      /// Resources known to resolver are taken from it. Otherwise, local
+      /// files are memory-mapped without copy, http resources are
+      /// retrieved by HttpFetcher::instance, other schemes are handled
+      /// by resource_retriever.
+      ///
+      /// Resources whose name ends with .gz or .zst and whose content
+      /// starts with the gzip or zstd magic number are decompressed into
+      /// a single buffer sized from the compressed headers, the
+      /// compressed bytes being read in place.
+      /// \throw std::runtime_error if the resource cannot be retrieved.
+      Resource retrieveResource (const std::string& uri,
+				 const ResourceResolver_t& resolver =
+				 ResourceResolver_t ());
+
+      /// \brief Check whether a resource exists without reading it when
+      /// it is a local file.
+      bool resourceExists (const std::string& uri,
+			   const ResourceResolver_t& resolver =
+			   ResourceResolver_t ());
+
+      /// \brief Identify the content of a resource.
+      ///
+      /// Local files are identified by inode, size and modification time
+      /// without being read, even when resolver serves them. Other
+      /// resources are retrieved and identified by size and a hash of
+      /// their content.
+      /// \return a string that changes when the resource is modified.
+      /// \throw std::runtime_error if the resource cannot be retrieved.
+      std::string resourceVersion (const std::string& uri,
+				   const ResourceResolver_t& resolver =
+				   ResourceResolver_t ());
+
+      /// \brief Resources retrieved in the background.
+      ///
+      /// Resources are retrieved by a few threads as soon as the object is
+      /// created, so that I/O latency overlaps other work. Pages of
+      /// memory-mapped files are read as well. http resources are
+      /// downloaded concurrently by a single thread through
+      /// HttpFetcher::instance. Resources are kept until the object is
+      /// destroyed.
+      /// \note Thread safe.
+      class ResourcePrefetcher
+      {
+      public:
+	/// Start retrieving resources
+	/// \param uris resource names, without duplicates,
+	/// \param resolver resolver passed to retrieveResource.
+	ResourcePrefetcher (const std::vector <std::string>& uris,
+			    const ResourceResolver_t& resolver);
+
+	/// Stop retrieving resources and wait for the threads.
+	~ResourcePrefetcher ();
+
+	/// Get a resource, waiting for it if it is being retrieved
+	/// \return false if the resource was not requested or could not be
+	///         retrieved. Errors are then reported by retrieveResource.
+	bool get (const std::string& uri, Resource& resource);
+
+	/// Resolver given to the constructor.
+	const ResourceResolver_t& resolver () const
+	{
+	  return resolver_;
+	}
+
+      private:
+	struct Entry
+	{
+	  Resource resource;
+	  bool done;
+	  bool failed;
+
+	  Entry () : resource (), done (false), failed (false)
+	  {}
+	}; // struct Entry
+
+	void fetch ();
+
+	void fetchHttp (const std::vector <std::string>& uris);
+
+	/// Store a retrieved resource.
+	/// \return false if the prefetcher is being destroyed.
+	bool complete (const std::string& uri, const Resource& resource,
+		       const std::string& error);
+
+	/// Whether the prefetcher is being destroyed.
+	bool stopped ();
+
+	ResourcePrefetcher (const ResourcePrefetcher&);
+	ResourcePrefetcher& operator= (const ResourcePrefetcher&);
+
+	ResourceResolver_t resolver_;
+	/// Resources retrieved by the threads calling fetch.
+	std::vector <std::string> uris_;
+	/// Index in uris_ of next resource to retrieve.
+	std::size_t next_;
+	/// Entries are created by the constructor, only their fields are
+	/// modified afterwards.
+	std::map <std::string, Entry> entries_;
+	bool stopped_;
+	boost::mutex mutex_;
+	boost::condition_variable condition_;
+	boost::thread_group threads_;
+      }; // class ResourcePrefetcher
+
+      /// \brief Resolver serving resources of a prefetcher.
+      ///
+      /// Resources that were not prefetched are resolved by the resolver
+      /// of the prefetcher. retrieveResource gets prefetched resources
+      /// without copy.
+      ResourceResolver_t prefetchResolver
+      (const boost::shared_ptr <ResourcePrefetcher>& prefetcher);
+
+      /// \brief Assimp stream reading a Resource.
+      class ResourceIOStream : public Assimp::IOStream
+      {
+      public:
+	ResourceIOStream (const Resource& res);
+
+	~ResourceIOStream ();
+
+	size_t Read (void* buffer, size_t size, size_t count);
+
+	size_t Write (const void*, size_t, size_t);
+
+	aiReturn Seek (size_t offset, aiOrigin origin);
+
+	size_t Tell () const;
+
+	size_t FileSize () const;
+
+	void Flush ();
+
+      private:
+	Resource res_;
+	const uint8_t* pos_;
+      }; // class ResourceIOStream
+
+      /// \brief Assimp file system reading resources through
+      /// retrieveResource.
+      class ResourceIOSystem : public Assimp::IOSystem
+      {
+      public:
+	ResourceIOSystem ();
+
+	~ResourceIOSystem ();
+
+	/// Set resolver passed to retrieveResource.
+	void resolver (const ResourceResolver_t& resolver);
+
+	/// \brief Serve resource uri under another name.
+	///
+	/// Importers deduce formats from file names, so that compressed
+	/// resources are opened under their uncompressed name. An empty
+	/// name removes the alias.
+	void alias (const std::string& name, const std::string& uri);
+
+	/// Reset byte counters.
+	void resetStatistics ();
+
+	/// Bytes read from storage by the streams opened since the last
+	/// reset.
+	size_t storedBytes () const
+	{
+	  return storedBytes_;
+	}
+
+	/// Bytes given to the importer by the streams opened since the
+	/// last reset.
+	size_t bytes () const
+	{
+	  return bytes_;
+	}
+
+	// Check whether a specific file exists
+	bool Exists (const char* file) const;
+
+	// Get the path delimiter character we'd like to see
+	char getOsSeparator () const;
+
+	// ... and finally a method to open a custom stream
+	Assimp::IOStream* Open (const char* file, const char* mode);
+
+	void Close (Assimp::IOStream* stream);
+
+      private:
+	ResourceResolver_t resolver_;
+	std::string aliasName_;
+	std::string aliasUri_;
+	size_t storedBytes_;
+	size_t bytes_;
+      }; // class ResourceIOSystem
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_RESOURCE
@@ -0,0 +1,268 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/shared-mesh-store.cc
+///
+/// \brief Implementation of meshes shared between processes.
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+#include <hpp/fcl/BV/BV.h>
+#include <hpp/fcl/BVH/BVH_model.h>
+
+#include <hpp/util/debug.hh>
+
+#include "shared-mesh-store.hh"
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Names of the parts of a mesh in the segment. The completion
+	/// marker is constructed last, so that meshes being stored are not
+	/// found.
+	/// \{
+	std::string verticesName (const std::string& key)
+	{
+	  return "vertices " + key;
+	}
+
+	std::string trianglesName (const std::string& key)
+	{
+	  return "triangles " + key;
+	}
+
+	std::string completeName (const std::string& key)
+	{
+	  return "complete " + key;
+	}
+	/// \}
+
+	/// \brief Interface of polyhedra using shared vertices.
+	class SharedGeometry
+	{
+	public:
+	  virtual ~SharedGeometry ()
+	  {}
+
+	  virtual void detach () = 0;
+
+	  virtual bool mesh (SharedMesh& mesh) const = 0;
+	}; // class SharedGeometry
+
+	/// \brief Polyhedron reading vertices and triangles from a
+	/// SharedMeshStore.
+	///
+	/// fcl keeps the bounding volume hierarchy in private arrays, so
+	/// that only vertices and triangles can be shared. They are left
+	/// untouched by the construction of the hierarchy, the arrays
+	/// allocated by fcl are then replaced by the shared ones.
+	template <typename BV>
+	class SharedPolyhedron : public fcl::BVHModel <BV>,
+				 public SharedGeometry
+	{
+	public:
+	  SharedPolyhedron (const boost::shared_ptr <SharedMeshStore>& store,
+			    const SharedMesh& mesh)
+	    : store_ (store), shared_ (false)
+	  {
+	    std::vector <fcl::Vec3f> vertices
+	      (mesh.vertices, mesh.vertices + mesh.nbVertices);
+	    std::vector <fcl::Triangle> triangles
+	      (mesh.triangles, mesh.triangles + mesh.nbTriangles);
+	    int res = this->beginModel ();
+	    if (res != fcl::BVH_OK) {
+	      std::ostringstream error;
+	      error << "fcl BVHReturnCode = " << res;
+	      throw std::runtime_error (error.str ());
+	    }
+	    this->addSubModel (vertices, triangles);
+	    res = this->endModel ();
+	    if (res != fcl::BVH_OK) {
+	      std::ostringstream error;
+	      error << "fcl BVHReturnCode = " << res;
+	      throw std::runtime_error (error.str ());
+	    }
+
+	    delete [] this->vertices;
+	    delete [] this->tri_indices;
+	    this->vertices = const_cast <fcl::Vec3f*> (mesh.vertices);
+	    this->tri_indices = const_cast <fcl::Triangle*> (mesh.triangles);
+	    shared_ = true;
+	  }
+
+	  virtual ~SharedPolyhedron ()
+	  {
+	    // Shared arrays must not be freed by fcl.
+	    if (shared_) {
+	      this->vertices = 0;
+	      this->tri_indices = 0;
+	    }
+	  }
+
+	  virtual void detach ()
+	  {
+	    if (!shared_) return;
+	    fcl::Vec3f* vertices = new fcl::Vec3f [this->num_vertices];
+	    std::copy (this->vertices, this->vertices + this->num_vertices,
+		       vertices);
+	    fcl::Triangle* triangles = new fcl::Triangle [this->num_tris];
+	    std::copy (this->tri_indices, this->tri_indices + this->num_tris,
+		       triangles);
+	    this->vertices = vertices;
+	    this->tri_indices = triangles;
+	    shared_ = false;
+	    store_.reset ();
+	  }
+
+	  virtual bool mesh (SharedMesh& mesh) const
+	  {
+	    if (!shared_) return false;
+	    mesh.vertices = this->vertices;
+	    mesh.nbVertices = this->num_vertices;
+	    mesh.triangles = this->tri_indices;
+	    mesh.nbTriangles = this->num_tris;
+	    return true;
+	  }
+
+	private:
+	  boost::shared_ptr <SharedMeshStore> store_;
+	  bool shared_;
+	}; // class SharedPolyhedron
+      } // end of anonymous namespace.
+
+      SharedMeshStore::SharedMeshStore (const std::string& name,
+					std::size_t size)
+	: name_ (name),
+	  segment_ (boost::interprocess::open_or_create, name.c_str (), size),
+	  mutex_ (segment_.find_or_construct
+		  <boost::interprocess::interprocess_mutex> ("lock") ())
+      {
+	hppDout (info, "Opened shared mesh store " << name << ", "
+		 << segment_.get_free_memory () << " bytes free");
+      }
+
+      bool SharedMeshStore::find (const std::string& key, SharedMesh& mesh)
+      {
+	if (!segment_.find <char> (completeName (key).c_str ()).first) {
+	  return false;
+	}
+	std::pair <fcl::Vec3f*, std::size_t> vertices =
+	  segment_.find <fcl::Vec3f> (verticesName (key).c_str ());
+	std::pair <fcl::Triangle*, std::size_t> triangles =
+	  segment_.find <fcl::Triangle> (trianglesName (key).c_str ());
+	mesh.vertices = vertices.first;
+	mesh.nbVertices = vertices.second;
+	mesh.triangles = triangles.first;
+	mesh.nbTriangles = triangles.second;
+	return true;
+      }
+
+      SharedMesh SharedMeshStore::insert
+      (const std::string& key, const std::vector <fcl::Vec3f>& vertices,
+       const std::vector <fcl::Triangle>& triangles)
+      {
+	boost::interprocess::scoped_lock
+	  <boost::interprocess::interprocess_mutex> lock (*mutex_);
+	SharedMesh mesh;
+	if (find (key, mesh)) return mesh;
+
+	// Remove parts left by a process that stopped while storing the
+	// mesh.
+	segment_.destroy <fcl::Vec3f> (verticesName (key).c_str ());
+	segment_.destroy <fcl::Triangle> (trianglesName (key).c_str ());
+	try {
+	  fcl::Vec3f* v = segment_.construct <fcl::Vec3f>
+	    (verticesName (key).c_str ()) [vertices.size ()] ();
+	  std::copy (vertices.begin (), vertices.end (), v);
+	  fcl::Triangle* t = segment_.construct <fcl::Triangle>
+	    (trianglesName (key).c_str ()) [triangles.size ()] ();
+	  std::copy (triangles.begin (), triangles.end (), t);
+	  segment_.construct <char> (completeName (key).c_str ()) (0);
+	  mesh.vertices = v;
+	  mesh.nbVertices = vertices.size ();
+	  mesh.triangles = t;
+	  mesh.nbTriangles = triangles.size ();
+	} catch (const boost::interprocess::bad_alloc&) {
+	  segment_.destroy <fcl::Vec3f> (verticesName (key).c_str ());
+	  segment_.destroy <fcl::Triangle> (trianglesName (key).c_str ());
+	  throw;
+	}
+	return mesh;
+      }
+
+      bool SharedMeshStore::remove (const std::string& name)
+      {
+	return boost::interprocess::shared_memory_object::remove
+	  (name.c_str ());
+      }
+
+      fcl::CollisionGeometryPtr_t createSharedPolyhedron
+      (fcl::NODE_TYPE type, const boost::shared_ptr <SharedMeshStore>& store,
+       const SharedMesh& mesh)
+      {
+	switch (type) {
+	case fcl::BV_AABB:
+	  return fcl::CollisionGeometryPtr_t
+	    (new SharedPolyhedron <fcl::AABB> (store, mesh));
+	case fcl::BV_OBB:
+	  return fcl::CollisionGeometryPtr_t
+	    (new SharedPolyhedron <fcl::OBB> (store, mesh));
+	case fcl::BV_RSS:
+	  return fcl::CollisionGeometryPtr_t
+	    (new SharedPolyhedron <fcl::RSS> (store, mesh));
+	case fcl::BV_kIOS:
+	  return fcl::CollisionGeometryPtr_t
+	    (new SharedPolyhedron <fcl::kIOS> (store, mesh));
+	case fcl::BV_OBBRSS:
+	  return fcl::CollisionGeometryPtr_t
+	    (new SharedPolyhedron <fcl::OBBRSS> (store, mesh));
+	default:
+	  std::ostringstream error;
+	  error << "Unsupported bounding volume type " << type;
+	  throw std::runtime_error (error.str ());
+	}
+      }
+
+      bool sharedPolyhedronMesh (const fcl::CollisionGeometry* geometry,
+				 SharedMesh& mesh)
+      {
+	const SharedGeometry* shared =
+	  dynamic_cast <const SharedGeometry*> (geometry);
+	return shared && shared->mesh (mesh);
+      }
+
+      void detachSharedPolyhedron (const fcl::CollisionGeometryPtr_t&
+				   geometry)
+      {
+	SharedGeometry* shared =
+	  dynamic_cast <SharedGeometry*> (geometry.get ());
+	if (shared) shared->detach ();
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
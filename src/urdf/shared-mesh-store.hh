@@ -0,0 +1,131 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/shared-mesh-store.hh
+///
+/// \brief Meshes shared between processes through shared memory.
+
+#ifndef HPP_MODEL_URDF_SHARED_MESH_STORE
+# define HPP_MODEL_URDF_SHARED_MESH_STORE
+
+# include <string>
+# include <vector>
+
+# include <boost/interprocess/managed_shared_memory.hpp>
+# include <boost/interprocess/sync/interprocess_mutex.hpp>
+# include <boost/shared_ptr.hpp>
+
+# include <hpp/fcl/math.h>
+
+# include <hpp/model/urdf/parser.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      /// \brief Vertices and triangles of a mesh in a SharedMeshStore.
+      struct SharedMesh
+      {
+	const fcl::Vec3f* vertices;
+	std::size_t nbVertices;
+	const fcl::Triangle* triangles;
+	std::size_t nbTriangles;
+      };
+
+      /// \brief Welded meshes stored in a named shared memory segment.
+      ///
+      /// Processes loading the same robot on one host open the same
+      /// segment. The first process importing a mesh copies it into the
+      /// segment, the others map it without importing it again. Meshes
+      /// are never modified once stored.
+      /// \note Thread and process safe.
+      class SharedMeshStore
+      {
+      public:
+	/// \brief Open segment, creating it if it does not exist.
+	///
+	/// \param name name of the segment,
+	/// \param size size in bytes of the segment if it is created.
+	/// \throw boost::interprocess::interprocess_exception if the
+	///        segment cannot be opened or created.
+	SharedMeshStore (const std::string& name, std::size_t size);
+
+	const std::string& name () const
+	{
+	  return name_;
+	}
+
+	/// \brief Find a mesh stored by this or another process.
+	///
+	/// \return false if no complete mesh is stored under key.
+	bool find (const std::string& key, SharedMesh& mesh);
+
+	/// \brief Store a copy of a mesh.
+	///
+	/// If another thread or process stored a mesh under the same key
+	/// in the mean time, this mesh is returned instead.
+	/// \throw boost::interprocess::bad_alloc if the segment is full.
+	SharedMesh insert (const std::string& key,
+			   const std::vector <fcl::Vec3f>& vertices,
+			   const std::vector <fcl::Triangle>& triangles);
+
+	/// \brief Remove a segment from the system.
+	///
+	/// Processes that opened the segment keep it mapped until they
+	/// release it.
+	static bool remove (const std::string& name);
+
+      private:
+	std::string name_;
+	boost::interprocess::managed_shared_memory segment_;
+	/// Mutex in the segment serializing insertions.
+	boost::interprocess::interprocess_mutex* mutex_;
+      }; // class SharedMeshStore
+
+      /// \brief Create polyhedron whose vertices and triangles are those
+      /// of a shared mesh.
+      ///
+      /// The bounding volume hierarchy is built and owned by the
+      /// polyhedron, vertices and triangles are read from the segment,
+      /// which stays mapped for the life of the polyhedron.
+      /// \param type one of fcl::BV_AABB, fcl::BV_OBB, fcl::BV_RSS,
+      ///        fcl::BV_kIOS, fcl::BV_OBBRSS.
+      fcl::CollisionGeometryPtr_t createSharedPolyhedron
+      (fcl::NODE_TYPE type, const boost::shared_ptr <SharedMeshStore>& store,
+       const SharedMesh& mesh);
+
+      /// \brief Get the shared mesh of a polyhedron.
+      ///
+      /// \return false if the vertices and triangles of the geometry are
+      ///         not read from a SharedMeshStore.
+      bool sharedPolyhedronMesh (const fcl::CollisionGeometry* geometry,
+				 SharedMesh& mesh);
+
+      /// \brief Give a polyhedron private copies of its shared vertices
+      /// and triangles, so that it can be refilled.
+      ///
+      /// Does nothing for other geometries.
+      void detachSharedPolyhedron (const fcl::CollisionGeometryPtr_t&
+				   geometry);
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_SHARED_MESH_STORE
@@ -0,0 +1,175 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file src/urdf/topology.cc
+///
+/// \brief Implementation of flat kinematic trees.
+
+#include <limits>
+#include <utility>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/topology.hh>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace
+      {
+	/// Move inertia of a body from its center of mass to the joint
+	/// origin (parallel axis theorem).
+	matrix3_t inertiaAboutOrigin (double mass, const vector3_t& com,
+				      const matrix3_t& inertia)
+	{
+	  double x = com [0], y = com [1], z = com [2];
+	  return inertia + matrix3_t (y*y + z*z, -x*y, -x*z,
+				      -x*y, x*x + z*z, -y*z,
+				      -x*z, -y*z, x*x + y*y) * mass;
+	}
+      } // end of anonymous namespace.
+
+      const std::size_t Topology::noParent;
+
+      void Topology::clear ()
+      {
+	joints.clear ();
+	parent.clear ();
+	subtreeEnd.clear ();
+	rankInConfiguration.clear ();
+	configSize.clear ();
+	rankInVelocity.clear ();
+	numberDof.clear ();
+	positionInParentFrame.clear ();
+	mass.clear ();
+	subtreeMass.clear ();
+	firstMoment.clear ();
+	inertia.clear ();
+	lowerBound.clear ();
+	upperBound.clear ();
+	bounded.clear ();
+	boundedRanges.clear ();
+      }
+
+      Topology topology (const DevicePtr_t& robot)
+      {
+	Topology result;
+	JointPtr_t root = robot->rootJoint ();
+	if (!root) return result;
+
+	std::size_t size = robot->getJointVector ().size ();
+	result.joints.reserve (size);
+	result.parent.reserve (size);
+	result.subtreeEnd.reserve (size);
+	result.rankInConfiguration.reserve (size);
+	result.configSize.reserve (size);
+	result.rankInVelocity.reserve (size);
+	result.numberDof.reserve (size);
+	result.positionInParentFrame.reserve (size);
+	result.mass.reserve (size);
+	result.firstMoment.reserve (size);
+	result.inertia.reserve (size);
+
+	// Joints to visit with the index of their parent. Children are
+	// pushed in reverse order so that they are visited in order.
+	std::vector <std::pair <JointPtr_t, std::size_t> > stack;
+	stack.push_back (std::make_pair (root, Topology::noParent));
+	while (!stack.empty ()) {
+	  JointPtr_t joint = stack.back ().first;
+	  std::size_t parent = stack.back ().second;
+	  stack.pop_back ();
+
+	  std::size_t index = result.joints.size ();
+	  result.joints.push_back (joint);
+	  result.parent.push_back (parent);
+	  result.subtreeEnd.push_back (index + 1);
+	  result.rankInConfiguration.push_back (joint->rankInConfiguration ());
+	  result.configSize.push_back (joint->configSize ());
+	  result.rankInVelocity.push_back (joint->rankInVelocity ());
+	  result.numberDof.push_back (joint->numberDof ());
+	  result.positionInParentFrame.push_back
+	    (joint->positionInParentFrame ());
+	  Body* body = joint->linkedBody ();
+	  if (body) {
+	    result.mass.push_back (body->mass ());
+	    result.firstMoment.push_back (body->localCenterOfMass () *
+					  body->mass ());
+	    result.inertia.push_back (inertiaAboutOrigin
+				      (body->mass (),
+				       body->localCenterOfMass (),
+				       body->inertiaMatrix ()));
+	  } else {
+	    matrix3_t zero;
+	    zero.setZero ();
+	    result.mass.push_back (0);
+	    result.firstMoment.push_back (vector3_t (0, 0, 0));
+	    result.inertia.push_back (zero);
+	  }
+
+	  for (std::size_t i = joint->numberChildJoints (); i > 0; --i) {
+	    stack.push_back (std::make_pair (joint->childJoint (i - 1),
+					     index));
+	  }
+	}
+
+	// A subtree ends where the subtree of its last descendant ends.
+	// Walking backwards, descendants are complete before their parent.
+	result.subtreeMass = result.mass;
+	for (std::size_t i = result.joints.size (); i > 1; --i) {
+	  std::size_t parent = result.parent [i - 1];
+	  if (result.subtreeEnd [parent] < result.subtreeEnd [i - 1]) {
+	    result.subtreeEnd [parent] = result.subtreeEnd [i - 1];
+	  }
+	  result.subtreeMass [parent] += result.subtreeMass [i - 1];
+	}
+
+	// Gather bounds of the configuration components of each joint.
+	std::size_t configSize = robot->configSize ();
+	double infinity = std::numeric_limits <double>::infinity ();
+	result.lowerBound.assign (configSize, -infinity);
+	result.upperBound.assign (configSize, infinity);
+	result.bounded.assign (configSize, 0);
+	for (std::size_t i = 0; i < result.joints.size (); ++i) {
+	  const JointPtr_t& joint = result.joints [i];
+	  std::size_t rank = result.rankInConfiguration [i];
+	  for (std::size_t k = 0; k < result.configSize [i]; ++k) {
+	    // Joints may hold finite bounds for unbounded components.
+	    if (!joint->isBounded (k)) continue;
+	    result.lowerBound [rank + k] = joint->lowerBound (k);
+	    result.upperBound [rank + k] = joint->upperBound (k);
+	    result.bounded [rank + k] = 1;
+	  }
+	}
+	for (std::size_t r = 0; r < configSize;) {
+	  if (!result.bounded [r]) {
+	    ++r;
+	    continue;
+	  }
+	  std::size_t first = r;
+	  while (r < configSize && result.bounded [r]) ++r;
+	  result.boundedRanges.push_back (std::make_pair (first, r));
+	}
+	return result;
+      }
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
@@ -20,15 +20,76 @@
 ///
 /// \brief Implementation of utility functions.
 
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <hpp/util/debug.hh>
 #include <hpp/model/urdf/util.hh>
 
+#include "resource.hh"
+
 namespace hpp
 {
   namespace model
   {
     namespace urdf
     {
+      namespace
+      {
+	std::string readResource (const std::string& uri)
+	{
+	  Resource resource = retrieveResource (uri);
+	  return std::string (reinterpret_cast <const char*> (resource.data ()),
+			      resource.size ());
+	}
+
+	void parseSemanticDescription (srdf::Parser* srdfParser,
+				       const std::string& urdfDescription,
+				       const std::string& srdfPath,
+				       const DevicePtr_t& robot,
+				       boost::exception_ptr* error)
+	{
+	  try {
+	    srdfParser->parseDescription (urdfDescription,
+					  readResource (srdfPath), robot);
+	  } catch (...) {
+	    *error = boost::current_exception ();
+	  }
+	}
+
+	/// Build robot from URDF file and parse SRDF file.
+	///
+	/// The SRDF file is fetched and parsed by another thread while the
+	/// robot is built, its meshes being fetched in the background by the
+	/// URDF parser. Collision pairs are added by the caller through
+	/// srdf::Parser::processSemanticDescription, once the robot is
+	/// complete.
+	void parseRobotFiles (Parser& urdfParser, srdf::Parser& srdfParser,
+			      const std::string& urdfPath,
+			      const std::string& srdfPath,
+			      const DevicePtr_t& robot)
+	{
+	  std::string urdfDescription = readResource (urdfPath);
+	  boost::exception_ptr error;
+	  boost::thread thread (boost::bind (&parseSemanticDescription,
+					     &srdfParser,
+					     boost::cref (urdfDescription),
+					     boost::cref (srdfPath),
+					     boost::cref (robot), &error));
+	  try {
+	    // Build robot model from URDF.
+	    urdfParser.parseString (urdfDescription);
+	  } catch (...) {
+	    thread.join ();
+	    throw;
+	  }
+	  hppDout (notice, "Finished parsing URDF file.");
+	  thread.join ();
+	  if (error) boost::rethrow_exception (error);
+	}
+      } // end of anonymous namespace.
+
       void loadRobotModel (const DevicePtr_t& robot,
 			   const std::string& rootJointType,
 			   const std::string& package,
@@ -44,14 +105,27 @@ namespace hpp
 	std::string srdfPath = "package://" + package + "/srdf/"
 	  + modelName + srdfSuffix + ".srdf";
 
-	// Build robot model from URDF.
-	urdfParser.parse (urdfPath);
-	hppDout (notice, "Finished parsing URDF file.");
+	parseRobotFiles (urdfParser, srdfParser, urdfPath, srdfPath, robot);
 	// Set Collision Check Pairs
-	srdfParser.parse (urdfPath, srdfPath, robot);
+	srdfParser.processSemanticDescription ();
 	hppDout (notice, "Finished parsing SRDF file.");
       }
 
+      GeometryLoaderPtr_t loadRobotModelAsync
+      (const DevicePtr_t& robot, const std::string& rootJointType,
+       const std::string& package, const std::string& modelName,
+       const std::string& urdfSuffix, const std::string& srdfSuffix,
+       bool background, const GeometryLoader::Callback_t& callback)
+      {
+	std::string urdfPath = "package://" + package + "/urdf/"
+	  + modelName + urdfSuffix + ".urdf";
+	std::string srdfPath = "package://" + package + "/srdf/"
+	  + modelName + srdfSuffix + ".srdf";
+
+	return GeometryLoader::create (robot, rootJointType, urdfPath,
+				       srdfPath, background, callback);
+      }
+
       void loadHumanoidModel (const model::HumanoidRobotPtr_t& robot,
 			      const std::string& rootJointType,
 			      const std::string& package,
@@ -67,17 +141,14 @@ namespace hpp
 	std::string srdfPath = "package://" + package + "/srdf/"
 	  + modelName + srdfSuffix + ".srdf";
 
-	// Build robot model from URDF.
-	urdfParser.parse (urdfPath);
-	hppDout (notice, "Finished parsing URDF file.");
+	parseRobotFiles (urdfParser, srdfParser, urdfPath, srdfPath, robot);
 	// Look for special joints and attach them to the model.
 	urdfParser.setSpecialJoints ();
 	// Fill gaze position and direction.
 	urdfParser.fillGaze ();
 
-
 	// Set Collision Check Pairs
-	srdfParser.parse (urdfPath, srdfPath, robot);
+	srdfParser.processSemanticDescription ();
 	hppDout (notice, "Finished parsing SRDF file.");
       }
 
@@ -118,6 +189,47 @@ namespace hpp
 	urdfParser.fillGaze ();
       }
 
+      void loadRobotModelFromString (const DevicePtr_t& robot,
+				     const std::string& rootJointType,
+				     const std::string& urdfDescription,
+				     const std::string& srdfDescription,
+				     const ResourceResolver_t& resolver)
+      {
+	hpp::model::urdf::Parser urdfParser (rootJointType, robot);
+	hpp::model::srdf::Parser srdfParser;
+
+	// Build robot model from URDF.
+	urdfParser.resourceResolver (resolver);
+	urdfParser.parseString (urdfDescription);
+	hppDout (notice, "Finished parsing URDF description.");
+	// Set Collision Check Pairs
+	srdfParser.parseString (urdfDescription, srdfDescription, robot);
+	hppDout (notice, "Finished parsing SRDF description.");
+      }
+
+      void loadHumanoidModelFromString
+      (const model::HumanoidRobotPtr_t& robot,
+       const std::string& rootJointType,
+       const std::string& urdfDescription,
+       const std::string& srdfDescription,
+       const ResourceResolver_t& resolver)
+      {
+	hpp::model::urdf::Parser urdfParser (rootJointType, robot);
+	hpp::model::srdf::Parser srdfParser;
+
+	// Build robot model from URDF.
+	urdfParser.resourceResolver (resolver);
+	urdfParser.parseString (urdfDescription);
+	hppDout (notice, "Finished parsing URDF description.");
+	// Set Collision Check Pairs
+	srdfParser.parseString (urdfDescription, srdfDescription, robot);
+	hppDout (notice, "Finished parsing SRDF description.");
+	// Look for special joints and attach them to the model.
+	urdfParser.setSpecialJoints ();
+	// Fill gaze position and direction.
+	urdfParser.fillGaze ();
+      }
+
       void loadUrdfModel (const DevicePtr_t& robot,
 			  const std::string& rootJointType,
 			  const std::string& package,
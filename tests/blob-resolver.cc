@@ -0,0 +1,150 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE blob-resolver
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/resource-resolver.hh>
+#include <hpp/model/urdf/util.hh>
+
+#include "urdf/mesh.hh"
+#include "urdf/resource.hh"
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::ResourceBlobs_t;
+using hpp::model::urdf::ResourceIOSystem;
+using hpp::model::urdf::ResourceResolver_t;
+
+namespace
+{
+  /// Mesh only known to the resolver, there is no such file.
+  const char* meshUri = "package://blob_description/meshes/arm.obj";
+
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  std::string urdfDescription ()
+  {
+    return std::string
+      ("<robot name=\"blob\">\n"
+       "<link name=\"base_link\">\n"
+       " <collision>\n"
+       "  <geometry><box size=\"0.2 0.2 0.2\"/></geometry>\n"
+       " </collision>\n"
+       "</link>\n"
+       "<joint name=\"shoulder\" type=\"revolute\">\n"
+       " <parent link=\"base_link\"/>\n"
+       " <child link=\"arm\"/>\n"
+       " <origin xyz=\"0 0 1\"/>\n"
+       " <axis xyz=\"1 0 0\"/>\n"
+       " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+       "</joint>\n"
+       "<link name=\"arm\">\n"
+       " <collision>\n"
+       "  <geometry><mesh filename=\"") + meshUri + "\"/></geometry>\n"
+      " </collision>\n"
+      "</link>\n"
+      "</robot>\n";
+  }
+
+  const char* srdfDescription = "<robot name=\"blob\"/>\n";
+
+  ResourceResolver_t resolver ()
+  {
+    ResourceBlobs_t blobs;
+    blobs [meshUri] = octahedron;
+    return hpp::model::urdf::blobResolver (blobs);
+  }
+} // end of anonymous namespace.
+
+// Load a robot whose mesh is only served from memory.
+BOOST_AUTO_TEST_CASE (load_from_string)
+{
+  DevicePtr_t robot = Device::create ("blob");
+  hpp::model::urdf::loadRobotModelFromString
+    (robot, "anchor", urdfDescription (), srdfDescription, resolver ());
+  JointPtr_t shoulder = robot->getJointByName ("shoulder");
+  BOOST_REQUIRE (shoulder && shoulder->linkedBody ());
+  const hpp::model::ObjectVector_t& objects =
+    shoulder->linkedBody ()->innerObjects (hpp::model::COLLISION);
+  BOOST_REQUIRE_EQUAL (objects.size (), 1);
+  BOOST_CHECK_EQUAL (static_cast <const Parser::PolyhedronType*>
+		     (objects.front ()->fcl ()->collisionGeometry ().get ())->
+		     num_tris, 8);
+  // The base and the arm are paired.
+  BOOST_CHECK_EQUAL (robot->collisionPairs (hpp::model::COLLISION).size (),
+		     1);
+
+  // Without the resolver, the mesh cannot be found.
+  DevicePtr_t other = Device::create ("blob");
+  BOOST_CHECK_THROW (hpp::model::urdf::loadRobotModelFromString
+		     (other, "anchor", urdfDescription (), srdfDescription),
+		     std::exception);
+}
+
+// Assimp reads resources served from memory.
+BOOST_AUTO_TEST_CASE (assimp_io_system)
+{
+  ResourceIOSystem system;
+  system.resolver (resolver ());
+  BOOST_CHECK (system.Exists (meshUri));
+  BOOST_CHECK (!system.Exists
+	       ("package://blob_description/meshes/none.obj"));
+
+  Assimp::IOStream* stream = system.Open (meshUri, "rb");
+  BOOST_REQUIRE (stream);
+  const std::string expected (octahedron);
+  BOOST_CHECK_EQUAL (stream->FileSize (), expected.size ());
+  std::vector <char> content (expected.size ());
+  BOOST_CHECK_EQUAL (stream->Read (&content [0], 1, content.size ()),
+		     content.size ());
+  BOOST_CHECK (std::string (content.begin (), content.end ()) == expected);
+  system.Close (stream);
+
+  // Aliases serve a resource under another name.
+  system.alias ("alias.obj", meshUri);
+  BOOST_CHECK (system.Exists ("alias.obj"));
+  stream = system.Open ("alias.obj", "rb");
+  BOOST_REQUIRE (stream);
+  BOOST_CHECK_EQUAL (stream->FileSize (), expected.size ());
+  system.Close (stream);
+
+  // Import by assimp rather than by the built-in reader.
+  hpp::model::urdf::MeshBuffers mesh;
+  Parser::MeshStatistics statistics;
+  ::urdf::Vector3 scale (1, 1, 1);
+  hpp::model::urdf::loadMesh (meshUri, scale, 1e-6, false, mesh, statistics,
+			      resolver ());
+  BOOST_CHECK_EQUAL (mesh.vertices.size (), 6);
+  BOOST_CHECK_EQUAL (mesh.triangles.size (), 8);
+}
@@ -0,0 +1,122 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE bounding-volume
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/parser.hh>
+#include <hpp/model/srdf/parser.hh>
+
+using hpp::model::DevicePtr_t;
+using hpp::model::JointVector_t;
+using hpp::model::vector_t;
+
+namespace
+{
+  const std::string urdfPath
+  ("package://romeo_description/urdf/romeo.urdf");
+  const std::string srdfPath
+  ("package://romeo_description/srdf/romeo.srdf");
+  const std::size_t nbConfigurations = 1000;
+
+  /// Shoot configurations uniformly within joint bounds. Unbounded
+  /// degrees of freedom keep their initial value.
+  void shootConfigurations (const DevicePtr_t& robot,
+			    std::vector <vector_t>& configurations)
+  {
+    std::srand (1);
+    const JointVector_t& joints = robot->getJointVector ();
+    for (std::size_t k = 0; k < nbConfigurations; ++k) {
+      vector_t q = robot->currentConfiguration ();
+      for (JointVector_t::const_iterator it = joints.begin ();
+	   it != joints.end (); ++it) {
+	for (std::size_t i = 0; i < (*it)->configSize (); ++i) {
+	  if (!(*it)->isBounded (i)) continue;
+	  double lower = (*it)->lowerBound (i);
+	  double upper = (*it)->upperBound (i);
+	  q [(*it)->rankInConfiguration () + i] = lower +
+	    (upper - lower) * std::rand () / RAND_MAX;
+	}
+      }
+      configurations.push_back (q);
+    }
+  }
+
+  double seconds (std::clock_t start)
+  {
+    return double (std::clock () - start) / CLOCKS_PER_SEC;
+  }
+} // end of anonymous namespace.
+
+// Compare throughput of collision and distance queries on romeo for each
+// bounding volume type of meshes.
+BOOST_AUTO_TEST_CASE (bounding_volume)
+{
+  const fcl::NODE_TYPE types [] = {
+    fcl::BV_AABB, fcl::BV_OBB, fcl::BV_RSS, fcl::BV_kIOS, fcl::BV_OBBRSS
+  };
+  const char* names [] = { "AABB", "OBB", "RSS", "kIOS", "OBBRSS" };
+  std::vector <std::size_t> collisions;
+
+  for (std::size_t t = 0; t < sizeof (types) / sizeof (types [0]); ++t) {
+    DevicePtr_t robot = hpp::model::Device::create (names [t]);
+    hpp::model::urdf::Parser urdfParser ("anchor", robot);
+    hpp::model::srdf::Parser srdfParser;
+    urdfParser.boundingVolume (types [t]);
+    std::clock_t start = std::clock ();
+    urdfParser.parse (urdfPath);
+    double loading = seconds (start);
+    srdfParser.parse (urdfPath, srdfPath, robot);
+
+    std::vector <vector_t> configurations;
+    shootConfigurations (robot, configurations);
+
+    std::size_t nbCollisions = 0;
+    double collision = 0, distance = 0;
+    for (std::size_t k = 0; k < configurations.size (); ++k) {
+      robot->currentConfiguration (configurations [k]);
+      robot->computeForwardKinematics ();
+      start = std::clock ();
+      if (robot->collisionTest ()) ++nbCollisions;
+      collision += seconds (start);
+      // fcl computes no distance between meshes made of AABB or OBB.
+      if (types [t] == fcl::BV_AABB || types [t] == fcl::BV_OBB) continue;
+      start = std::clock ();
+      robot->computeDistances ();
+      distance += seconds (start);
+    }
+    std::cout << names [t] << ": loading " << loading << "s, "
+	      << configurations.size () / collision << " collision tests/s, ";
+    if (distance > 0) {
+      std::cout << configurations.size () / distance
+		<< " distance queries/s, ";
+    }
+    std::cout << nbCollisions << " configurations in collision" << std::endl;
+    collisions.push_back (nbCollisions);
+    // Collision checking is exact whatever the bounding volume.
+    BOOST_CHECK_EQUAL (nbCollisions, collisions.front ());
+  }
+}
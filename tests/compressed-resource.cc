@@ -0,0 +1,152 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE compressed-resource
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+#ifdef HPP_MODEL_URDF_WITH_ZSTD
+# include <zstd.h>
+#endif // HPP_MODEL_URDF_WITH_ZSTD
+
+#include <boost/test/unit_test.hpp>
+
+#include "urdf/resource.hh"
+#include "test-utils.hh"
+
+using hpp::model::urdf::Resource;
+using hpp::model::urdf::retrieveResource;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  std::string readFile (const std::string& name)
+  {
+    FILE* file = std::fopen (path (name).c_str (), "rb");
+    if (!file) throw std::runtime_error ("Failed to read " + name);
+    std::string content;
+    char buffer [4096];
+    std::size_t n;
+    while ((n = std::fread (buffer, 1, sizeof (buffer), file)) > 0) {
+      content.append (buffer, n);
+    }
+    std::fclose (file);
+    return content;
+  }
+
+  /// Append a gzip member to a file.
+  void writeGzip (const std::string& name, const std::string& content,
+		  const char* mode)
+  {
+    gzFile file = gzopen (path (name).c_str (), mode);
+    if (!file) throw std::runtime_error ("Failed to write " + name);
+    gzwrite (file, content.data (), content.size ());
+    gzclose (file);
+  }
+
+  std::string content (const Resource& resource)
+  {
+    return std::string (reinterpret_cast <const char*> (resource.data ()),
+			resource.size ());
+  }
+
+  /// Text compressing far beyond the initial size of the buffers.
+  std::string repeated (const std::string& line, std::size_t n)
+  {
+    std::string result;
+    result.reserve (line.size () * n);
+    for (std::size_t i = 0; i < n; ++i) result += line;
+    return result;
+  }
+} // end of anonymous namespace.
+
+// gzip resources are decompressed, members may be concatenated.
+BOOST_AUTO_TEST_CASE (gzip)
+{
+  const std::string first = repeated ("v 0 0 0\n", 1 << 17);
+  const std::string second = "f 1 2 3\n";
+  writeGzip ("mesh.obj.gz", first, "wb");
+  Resource resource = retrieveResource (fileUri ("mesh.obj.gz"));
+  BOOST_CHECK (content (resource) == first);
+  BOOST_CHECK (resource.storedSize () < resource.size ());
+
+  writeGzip ("mesh.obj.gz", second, "ab");
+  BOOST_CHECK (content (retrieveResource (fileUri ("mesh.obj.gz"))) ==
+	       first + second);
+
+  // Truncated data is reported.
+  std::string compressed = readFile ("mesh.obj.gz");
+  writeFile ("truncated.obj.gz",
+	     compressed.substr (0, compressed.size () / 2));
+  BOOST_CHECK_THROW (retrieveResource (fileUri ("truncated.obj.gz")),
+		     std::runtime_error);
+
+  // Content without the gzip magic number is returned as is.
+  writeFile ("plain.obj.gz", second);
+  BOOST_CHECK_EQUAL (content (retrieveResource (fileUri ("plain.obj.gz"))),
+		     second);
+
+  std::remove (path ("mesh.obj.gz").c_str ());
+  std::remove (path ("truncated.obj.gz").c_str ());
+  std::remove (path ("plain.obj.gz").c_str ());
+}
+
+// zstd resources are decompressed if zstd support is built.
+BOOST_AUTO_TEST_CASE (zstd)
+{
+  const std::string first = repeated ("v 0 0 0\n", 1 << 17);
+  const std::string second = "f 1 2 3\n";
+#ifdef HPP_MODEL_URDF_WITH_ZSTD
+  std::string frames;
+  const std::string* parts [] = { &first, &second };
+  for (std::size_t i = 0; i < 2; ++i) {
+    std::vector <char> buffer (ZSTD_compressBound (parts [i]->size ()));
+    std::size_t n = ZSTD_compress (&buffer [0], buffer.size (),
+				   parts [i]->data (), parts [i]->size (), 3);
+    BOOST_REQUIRE (!ZSTD_isError (n));
+    frames.append (&buffer [0], n);
+    if (i == 0) writeFile ("mesh.obj.zst", frames);
+  }
+  Resource resource = retrieveResource (fileUri ("mesh.obj.zst"));
+  BOOST_CHECK (content (resource) == first);
+  BOOST_CHECK (resource.storedSize () < resource.size ());
+
+  // Frames may be concatenated.
+  writeFile ("mesh.obj.zst", frames);
+  BOOST_CHECK (content (retrieveResource (fileUri ("mesh.obj.zst"))) ==
+	       first + second);
+
+  // Truncated data is reported.
+  writeFile ("truncated.obj.zst", frames.substr (0, frames.size () - 3));
+  BOOST_CHECK_THROW (retrieveResource (fileUri ("truncated.obj.zst")),
+		     std::runtime_error);
+  std::remove (path ("truncated.obj.zst").c_str ());
+#else
+  // Magic number of zstd frames.
+  writeFile ("mesh.obj.zst", std::string ("\x28\xb5\x2f\xfd", 4) + first);
+  BOOST_CHECK_THROW (retrieveResource (fileUri ("mesh.obj.zst")),
+		     std::runtime_error);
+#endif // HPP_MODEL_URDF_WITH_ZSTD
+  std::remove (path ("mesh.obj.zst").c_str ());
+}
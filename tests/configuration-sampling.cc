@@ -0,0 +1,265 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE configuration-sampling
+
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/parser.hh>
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::matrix3_t;
+using hpp::model::urdf::Topology;
+
+namespace
+{
+  const std::size_t nbJoints = 300;
+  const std::size_t nbSamples = 20000;
+
+  /// Chain of revolute, prismatic and continuous joints.
+  std::string chainDescription ()
+  {
+    const char* types [] = { "revolute", "prismatic", "continuous" };
+    std::ostringstream urdf;
+    urdf << "<robot name=\"chain\">\n<link name=\"link_0\"/>\n";
+    for (std::size_t i = 1; i <= nbJoints; ++i) {
+      urdf << "<link name=\"link_" << i << "\"/>\n"
+	   << "<joint name=\"joint_" << i << "\" type=\"" << types [i % 3]
+	   << "\">\n"
+	   << " <parent link=\"link_" << i - 1 << "\"/>\n"
+	   << " <child link=\"link_" << i << "\"/>\n"
+	   << " <origin xyz=\"0 0 0.1\"/>\n"
+	   << " <axis xyz=\"0 0 1\"/>\n"
+	   << " <limit lower=\"-" << i << "\" upper=\"" << i
+	   << "\" effort=\"1\" velocity=\"1\"/>\n"
+	   << "</joint>\n";
+    }
+    urdf << "</robot>\n";
+    return urdf.str ();
+  }
+
+  /// Fill vector with pseudo random numbers in [0, 1).
+  void random (std::vector <double>& u, unsigned long& state)
+  {
+    for (std::size_t i = 0; i < u.size (); ++i) {
+      state = state * 6364136223846793005UL + 1442695040888963407UL;
+      u [i] = double (state >> 11) / double (1UL << 53);
+    }
+  }
+
+  /// Sample bounded components reading bounds from joints.
+  void sampleFromJoints (const DevicePtr_t& robot,
+			 const std::vector <double>& u,
+			 std::vector <double>& q)
+  {
+    BOOST_FOREACH (const JointPtr_t& joint, robot->getJointVector ()) {
+      std::size_t rank = joint->rankInConfiguration ();
+      for (std::size_t k = 0; k < joint->configSize (); ++k) {
+	if (!joint->isBounded (k)) continue;
+	double lower = joint->lowerBound (k);
+	q [rank + k] = lower + u [rank + k] * (joint->upperBound (k) - lower);
+      }
+    }
+  }
+
+  /// Sample bounded components reading bounds from flat arrays.
+  void sampleFromTopology (const Topology& topology,
+			   const std::vector <double>& u,
+			   std::vector <double>& q)
+  {
+    const double* lower = &topology.lowerBound [0];
+    const double* upper = &topology.upperBound [0];
+    for (std::size_t r = 0; r < topology.boundedRanges.size (); ++r) {
+      for (std::size_t i = topology.boundedRanges [r].first;
+	   i < topology.boundedRanges [r].second; ++i) {
+	q [i] = lower [i] + u [i] * (upper [i] - lower [i]);
+      }
+    }
+  }
+
+  /// Base, an arm whose inertial frame is rotated a quarter turn about
+  /// z, and a link without inertial.
+  const char* massDescription =
+    "<robot name=\"arm\">\n"
+    "<link name=\"base\">\n"
+    " <inertial>\n"
+    "  <mass value=\"1\"/>\n"
+    "  <inertia ixx=\"1\" ixy=\"0\" ixz=\"0\" iyy=\"1\" iyz=\"0\""
+    " izz=\"1\"/>\n"
+    " </inertial>\n"
+    "</link>\n"
+    "<joint name=\"shoulder\" type=\"revolute\">\n"
+    " <parent link=\"base\"/><child link=\"arm\"/>\n"
+    " <origin xyz=\"0 0 1\"/><axis xyz=\"1 0 0\"/>\n"
+    " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"arm\">\n"
+    " <inertial>\n"
+    "  <origin xyz=\"0.1 0 0\" rpy=\"0 0 1.5707963267948966\"/>\n"
+    "  <mass value=\"2\"/>\n"
+    "  <inertia ixx=\"1\" ixy=\"0\" ixz=\"0\" iyy=\"2\" iyz=\"0\""
+    " izz=\"3\"/>\n"
+    " </inertial>\n"
+    "</link>\n"
+    "<joint name=\"slider\" type=\"prismatic\">\n"
+    " <parent link=\"arm\"/><child link=\"hand\"/>\n"
+    " <axis xyz=\"1 0 0\"/>\n"
+    " <limit lower=\"0\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"hand\"/>\n"
+    "</robot>\n";
+
+  void checkDiagonal (const matrix3_t& m, double a, double b, double c)
+  {
+    const double d [3] = { a, b, c };
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+	BOOST_CHECK_SMALL (m (i, j) - (i == j ? d [i] : 0), 1e-12);
+      }
+    }
+  }
+} // end of anonymous namespace.
+
+// Compare configuration sampling through joints and through the flat
+// bound arrays of the topology.
+BOOST_AUTO_TEST_CASE (configuration_sampling)
+{
+  DevicePtr_t robot = Device::create ("chain");
+  hpp::model::urdf::Parser parser ("freeflyer", robot);
+  parser.parseString (chainDescription ());
+  const Topology& topology = parser.topology ();
+  const double infinity = std::numeric_limits <double>::infinity ();
+
+  std::size_t size = robot->configSize ();
+  BOOST_REQUIRE_EQUAL (topology.configurationSize (), size);
+  for (std::size_t i = 0; i < topology.size (); ++i) {
+    const JointPtr_t& joint = topology.joints [i];
+    for (std::size_t k = 0; k < joint->configSize (); ++k) {
+      std::size_t rank = joint->rankInConfiguration () + k;
+      BOOST_CHECK_EQUAL (bool (topology.bounded [rank]),
+			 joint->isBounded (k));
+      if (joint->isBounded (k)) {
+	BOOST_CHECK_EQUAL (topology.lowerBound [rank], joint->lowerBound (k));
+	BOOST_CHECK_EQUAL (topology.upperBound [rank], joint->upperBound (k));
+      } else {
+	BOOST_CHECK_EQUAL (topology.lowerBound [rank], -infinity);
+	BOOST_CHECK_EQUAL (topology.upperBound [rank], infinity);
+      }
+    }
+  }
+
+  std::vector <double> u (size), q1 (size, 0), q2 (size, 0);
+  unsigned long state = 1;
+  std::clock_t start = std::clock ();
+  for (std::size_t i = 0; i < nbSamples; ++i) {
+    random (u, state);
+    sampleFromJoints (robot, u, q1);
+  }
+  double jointTime = double (std::clock () - start) / CLOCKS_PER_SEC;
+
+  state = 1;
+  start = std::clock ();
+  for (std::size_t i = 0; i < nbSamples; ++i) {
+    random (u, state);
+    sampleFromTopology (topology, u, q2);
+  }
+  double topologyTime = double (std::clock () - start) / CLOCKS_PER_SEC;
+
+  std::cout << "Configuration size " << size << ", "
+	    << topology.boundedRanges.size () << " bounded ranges: joints "
+	    << nbSamples / jointTime << " samples/s, topology "
+	    << nbSamples / topologyTime << " samples/s" << std::endl;
+  BOOST_CHECK (q1 == q2);
+}
+
+// Mass tables of the topology, inertia being rotated by the inertial
+// origin.
+BOOST_AUTO_TEST_CASE (mass_tables)
+{
+  DevicePtr_t robot = Device::create ("arm");
+  hpp::model::urdf::Parser parser ("anchor", robot);
+  parser.parseString (massDescription);
+  const Topology& topology = parser.topology ();
+  BOOST_REQUIRE_EQUAL (topology.size (), 3);
+  BOOST_REQUIRE_EQUAL (topology.joints [1]->name (), "shoulder");
+  BOOST_REQUIRE_EQUAL (topology.joints [2]->name (), "slider");
+
+  BOOST_CHECK_EQUAL (topology.mass [0], 1);
+  BOOST_CHECK_EQUAL (topology.mass [1], 2);
+  BOOST_CHECK_EQUAL (topology.mass [2], 0);
+  BOOST_CHECK_EQUAL (topology.subtreeMass [0], 3);
+  BOOST_CHECK_EQUAL (topology.subtreeMass [1], 2);
+  BOOST_CHECK_EQUAL (topology.subtreeMass [2], 0);
+  BOOST_CHECK_EQUAL (topology.totalMass (), 3);
+
+  // Center of mass at 0.1 along x.
+  BOOST_CHECK_SMALL ((topology.firstMoment [1] -
+		      hpp::model::vector3_t (0.2, 0, 0)).length (), 1e-12);
+  BOOST_CHECK_SMALL (topology.firstMoment [2].length (), 1e-12);
+
+  // The principal axes of the arm are swapped by the inertial origin.
+  checkDiagonal (topology.joints [1]->linkedBody ()->inertiaMatrix (),
+		 2, 1, 3);
+  // Moved to the joint origin: m (|c|^2 I - c c^T) is added.
+  checkDiagonal (topology.inertia [1], 2, 1.02, 3.02);
+  checkDiagonal (topology.inertia [0], 1, 1, 1);
+}
+
+// Unbounded components keep infinite bounds whatever the bounds held by
+// the joint, and the topology is a snapshot of the robot.
+BOOST_AUTO_TEST_CASE (unbounded_components)
+{
+  DevicePtr_t robot = Device::create ("chain");
+  hpp::model::urdf::Parser parser ("freeflyer", robot);
+  parser.parseString (chainDescription ());
+  const double infinity = std::numeric_limits <double>::infinity ();
+
+  // joint_2 is continuous, joint_3 revolute.
+  JointPtr_t continuous = robot->getJointByName ("joint_2");
+  JointPtr_t revolute = robot->getJointByName ("joint_3");
+  BOOST_REQUIRE (continuous && revolute);
+  BOOST_REQUIRE (!continuous->isBounded (0));
+  BOOST_REQUIRE (revolute->isBounded (0));
+  continuous->lowerBound (0, -1);
+  continuous->upperBound (0, 1);
+  revolute->upperBound (0, 0.5);
+
+  Topology topology = hpp::model::urdf::topology (robot);
+  std::size_t rank = continuous->rankInConfiguration ();
+  BOOST_CHECK (!topology.bounded [rank]);
+  BOOST_CHECK_EQUAL (topology.lowerBound [rank], -infinity);
+  BOOST_CHECK_EQUAL (topology.upperBound [rank], infinity);
+  rank = revolute->rankInConfiguration ();
+  BOOST_CHECK_EQUAL (topology.upperBound [rank], 0.5);
+  // The topology of the parser was computed before the modification.
+  BOOST_CHECK_EQUAL (parser.topology ().upperBound [rank], 3);
+}
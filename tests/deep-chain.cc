@@ -0,0 +1,99 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE deep-chain
+
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/parser.hh>
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+
+namespace
+{
+  const std::size_t nbJoints = 50000;
+  const double jointOffset = 1e-3;
+
+  /// Chain of links connected by revolute joints, each joint being
+  /// above the previous one.
+  std::string chainDescription ()
+  {
+    std::ostringstream urdf;
+    urdf << "<robot name=\"chain\">\n<link name=\"link_0\"/>\n";
+    for (std::size_t i = 1; i <= nbJoints; ++i) {
+      urdf << "<link name=\"link_" << i << "\"/>\n"
+	   << "<joint name=\"joint_" << i << "\" type=\"revolute\">\n"
+	   << " <parent link=\"link_" << i - 1 << "\"/>\n"
+	   << " <child link=\"link_" << i << "\"/>\n"
+	   << " <origin xyz=\"0 0 " << jointOffset << "\"/>\n"
+	   << " <axis xyz=\"0 0 1\"/>\n"
+	   << " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+	   << "</joint>\n";
+    }
+    urdf << "</robot>\n";
+    return urdf.str ();
+  }
+} // end of anonymous namespace.
+
+// Load a chain deep enough to overflow the stack with recursive
+// traversals.
+BOOST_AUTO_TEST_CASE (deep_chain)
+{
+  std::string description = chainDescription ();
+  DevicePtr_t robot = Device::create ("chain");
+  hpp::model::urdf::Parser parser ("anchor", robot);
+
+  std::clock_t start = std::clock ();
+  parser.parseString (description);
+  std::cout << "Loaded " << nbJoints << " joints in "
+	    << double (std::clock () - start) / CLOCKS_PER_SEC << " s"
+	    << std::endl;
+
+  // Root joint and one joint per URDF joint.
+  BOOST_CHECK_EQUAL (robot->getJointVector ().size (), nbJoints + 1);
+  std::ostringstream lastName;
+  lastName << "joint_" << nbJoints;
+  JointPtr_t last = robot->getJointByName (lastName.str ());
+  BOOST_REQUIRE (last);
+  BOOST_CHECK (std::fabs (last->initialPosition ().getTranslation () [2] -
+			  nbJoints * jointOffset) < 1e-6);
+  std::size_t depth = 0;
+  for (JointPtr_t joint = last; joint->parentJoint ();
+       joint = joint->parentJoint ()) {
+    ++depth;
+  }
+  BOOST_CHECK_EQUAL (depth, nbJoints);
+
+  const hpp::model::urdf::Topology& topology = parser.topology ();
+  BOOST_REQUIRE_EQUAL (topology.size (), nbJoints + 1);
+  BOOST_CHECK_EQUAL (topology.joints.back (), last);
+  BOOST_CHECK_EQUAL (topology.parent [nbJoints], nbJoints - 1);
+  BOOST_CHECK_EQUAL (topology.subtreeEnd [0], nbJoints + 1);
+  BOOST_CHECK (topology.isAncestor (1, nbJoints));
+  BOOST_CHECK (!topology.isAncestor (nbJoints, 1));
+}
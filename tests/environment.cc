@@ -0,0 +1,137 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE environment
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "test-utils.hh"
+
+using hpp::model::CollisionObjectPtr_t;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::ObjectVector_t;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  std::string box (const std::string& link, const char* size)
+  {
+    return "<link name=\"" + link + "\">\n"
+      " <collision><geometry><box size=\"" + size +
+      "\"/></geometry></collision>\n"
+      "</link>\n";
+  }
+
+  std::string joint (const std::string& name, const char* type,
+		     const std::string& parent, const std::string& child,
+		     const char* xyz)
+  {
+    return "<joint name=\"" + name + "\" type=\"" + type + "\">\n"
+      " <parent link=\"" + parent + "\"/><child link=\"" + child +
+      "\"/>\n <origin xyz=\"" + xyz + "\"/>\n"
+      " <axis xyz=\"1 0 0\"/>\n"
+      " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+      "</joint>\n";
+  }
+
+  /// Work cell: floor, table and shelf boxes, a vase mesh, and a door
+  /// with its handle attached by a revolute joint.
+  std::string description ()
+  {
+    std::ostringstream urdf;
+    urdf << "<robot name=\"cell\">\n"
+	 << box ("floor", "4 4 0.1")
+	 << joint ("table_joint", "fixed", "floor", "table", "1 0 0.5")
+	 << box ("table", "1 1 0.05")
+	 << joint ("shelf_joint", "fixed", "floor", "shelf", "-1 0 1")
+	 << box ("shelf", "0.5 1 0.02")
+	 << joint ("vase_joint", "fixed", "table", "vase", "0 0 0.1")
+	 << "<link name=\"vase\">\n"
+	 << " <collision><geometry><mesh filename=\"" << fileUri ("vase.obj")
+	 << "\"/></geometry></collision>\n"
+	 << "</link>\n"
+	 << joint ("door_joint", "revolute", "floor", "door", "0 2 1")
+	 << box ("door", "1 0.05 2")
+	 << joint ("handle_joint", "fixed", "door", "handle", "0.4 0 0")
+	 << box ("handle", "0.02 0.1 0.02")
+	 << "</robot>\n";
+    return urdf.str ();
+  }
+
+  std::size_t triangles (const CollisionObjectPtr_t& object)
+  {
+    return static_cast <const Parser::PolyhedronType*>
+      (object->fcl ()->collisionGeometry ().get ())->num_tris;
+  }
+} // end of anonymous namespace.
+
+// Merge the static links of a work cell into obstacles.
+BOOST_AUTO_TEST_CASE (environment)
+{
+  writeFile ("vase.obj", octahedron);
+
+  DevicePtr_t robot = Device::create ("unused");
+  Parser parser ("anchor", robot);
+  // Three boxes of 12 triangles and the vase. The door and its handle
+  // are skipped.
+  const std::size_t nbTriangles = 3 * 12 + 8;
+
+  ObjectVector_t obstacles = parser.parseEnvironmentString (description ());
+  BOOST_REQUIRE_EQUAL (obstacles.size (), 1);
+  BOOST_CHECK_EQUAL (obstacles.front ()->name (), "cell");
+  BOOST_CHECK_EQUAL (triangles (obstacles.front ()), nbTriangles);
+
+  // Pieces are grouped without being split.
+  const std::size_t maxTriangles = 24;
+  obstacles = parser.parseEnvironmentString (description (), maxTriangles);
+  BOOST_CHECK (obstacles.size () >= 2);
+  std::size_t total = 0, index = 0;
+  BOOST_FOREACH (const CollisionObjectPtr_t& object, obstacles) {
+    std::ostringstream name;
+    name << "cell_" << index++;
+    BOOST_CHECK_EQUAL (object->name (), name.str ());
+    BOOST_CHECK (triangles (object) <= maxTriangles);
+    total += triangles (object);
+  }
+  BOOST_CHECK_EQUAL (total, nbTriangles);
+
+  // A missing mesh is reported.
+  std::remove (path ("vase.obj").c_str ());
+  BOOST_CHECK_THROW (parser.parseEnvironmentString (description ()),
+		     std::exception);
+}
@@ -0,0 +1,251 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE geometry-loader
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/geometry-loader.hh>
+
+#include "test-utils.hh"
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::urdf::GeometryLoader;
+using hpp::model::urdf::GeometryLoaderPtr_t;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  const std::size_t nbLinks = 8;
+
+  /// Sphere-like mesh of 2 * n * (n - 1) triangles.
+  void writeMesh (const std::string& name, std::size_t n)
+  {
+    std::ostringstream obj;
+    obj << "v 0 0 0.1\nv 0 0 -0.1\n";
+    for (std::size_t i = 1; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+	double theta = 3.14159265358979 * i / n;
+	double phi = 2 * 3.14159265358979 * j / n;
+	obj << "v " << 0.1 * std::sin (theta) * std::cos (phi) << " "
+	    << 0.1 * std::sin (theta) * std::sin (phi) << " "
+	    << 0.1 * std::cos (theta) << "\n";
+      }
+    }
+    // Vertex of ring i, index j, counted from 1.
+#define VERTEX(i, j) (3 + ((i) - 1) * n + (j) % n)
+    for (std::size_t j = 0; j < n; ++j) {
+      obj << "f 1 " << VERTEX (1, j) << " " << VERTEX (1, j + 1) << "\n";
+      obj << "f 2 " << VERTEX (n - 1, j + 1) << " " << VERTEX (n - 1, j)
+	  << "\n";
+      for (std::size_t i = 1; i + 1 < n; ++i) {
+	obj << "f " << VERTEX (i, j) << " " << VERTEX (i + 1, j) << " "
+	    << VERTEX (i + 1, j + 1) << "\n";
+	obj << "f " << VERTEX (i, j) << " " << VERTEX (i + 1, j + 1) << " "
+	    << VERTEX (i, j + 1) << "\n";
+      }
+    }
+#undef VERTEX
+    writeFile (name, obj.str ());
+  }
+
+  /// Chain of links holding the same mesh, the last one holding
+  /// lastMesh.
+  void writeUrdf (const std::string& lastMesh)
+  {
+    std::ostringstream urdf;
+    urdf << "<robot name=\"chain\">\n"
+	 << "<link name=\"link_0\"/>\n";
+    for (std::size_t i = 1; i <= nbLinks; ++i) {
+      urdf << "<joint name=\"joint_" << i << "\" type=\"revolute\">\n"
+	   << " <parent link=\"link_" << i - 1 << "\"/>\n"
+	   << " <child link=\"link_" << i << "\"/>\n"
+	   << " <origin xyz=\"0 0 0.3\"/>\n"
+	   << " <axis xyz=\"1 0 0\"/>\n"
+	   << " <limit lower=\"-1\" upper=\"1\" effort=\"1\""
+	   << " velocity=\"1\"/>\n"
+	   << "</joint>\n"
+	   << "<link name=\"link_" << i << "\">\n"
+	   << " <collision>\n"
+	   << "  <geometry><mesh filename=\""
+	   << fileUri (i == nbLinks ? lastMesh : "sphere.obj")
+	   << "\"/></geometry>\n"
+	   << " </collision>\n"
+	   << "</link>\n";
+    }
+    urdf << "</robot>\n";
+    writeFile ("chain.urdf", urdf.str ());
+    writeFile ("chain.srdf", "<robot name=\"chain\"/>\n");
+  }
+
+  std::size_t nbObjects (const DevicePtr_t& robot)
+  {
+    std::size_t result = 0;
+    BOOST_FOREACH (const JointPtr_t& joint, robot->getJointVector ()) {
+      if (joint->linkedBody ()) {
+	result +=
+	  joint->linkedBody ()->innerObjects (hpp::model::COLLISION).size ();
+      }
+    }
+    return result;
+  }
+
+  boost::mutex mutex;
+  std::size_t nbCallbacks = 0;
+
+  void callback ()
+  {
+    boost::mutex::scoped_lock lock (mutex);
+    ++nbCallbacks;
+  }
+
+  boost::promise <GeometryLoader*> waitingLoader;
+  bool waitRejected = false;
+
+  /// Callback calling wait from the background thread.
+  void callWait ()
+  {
+    GeometryLoader* loader = waitingLoader.get_future ().get ();
+    try {
+      loader->wait ();
+    } catch (const std::runtime_error&) {
+      boost::mutex::scoped_lock lock (mutex);
+      waitRejected = true;
+    }
+  }
+} // end of anonymous namespace.
+
+// Load bodies while geometries are built in the background, then wait.
+BOOST_AUTO_TEST_CASE (background)
+{
+  writeMesh ("sphere.obj", 64);
+  writeUrdf ("sphere.obj");
+
+  DevicePtr_t robot = Device::create ("chain");
+  GeometryLoaderPtr_t loader =
+    GeometryLoader::create (robot, "anchor", fileUri ("chain.urdf"),
+			    fileUri ("chain.srdf"), true, callback);
+  // The kinematic tree is available before the geometries.
+  BOOST_REQUIRE (robot->getJointByName ("joint_4"));
+
+  // Loading a body builds its geometry if needed, and attaches it.
+  loader->load ("joint_4");
+  BOOST_CHECK_EQUAL (robot->getJointByName ("joint_4")->linkedBody ()->
+		     innerObjects (hpp::model::COLLISION).size (), 1);
+  loader->load ("joint_4");
+  BOOST_CHECK_EQUAL (robot->getJointByName ("joint_4")->linkedBody ()->
+		     innerObjects (hpp::model::COLLISION).size (), 1);
+  // Collision pairs are only added by wait, even when all geometries
+  // are built.
+  loader->built ().wait ();
+  BOOST_CHECK (loader->ready ());
+  BOOST_CHECK (robot->collisionPairs (hpp::model::COLLISION).empty ());
+
+  loader->wait ();
+  BOOST_CHECK_EQUAL (nbObjects (robot), nbLinks);
+  BOOST_CHECK (!robot->collisionPairs (hpp::model::COLLISION).empty ());
+  {
+    boost::mutex::scoped_lock lock (mutex);
+    BOOST_CHECK_EQUAL (nbCallbacks, 1);
+  }
+  // Waiting again does nothing.
+  std::size_t nbPairs = robot->collisionPairs (hpp::model::COLLISION).size ();
+  loader->wait ();
+  BOOST_CHECK_EQUAL (robot->collisionPairs (hpp::model::COLLISION).size (),
+		     nbPairs);
+  std::remove (path ("chain.urdf").c_str ());
+  std::remove (path ("chain.srdf").c_str ());
+}
+
+// Geometries built on demand only.
+BOOST_AUTO_TEST_CASE (foreground)
+{
+  writeUrdf ("sphere.obj");
+  DevicePtr_t robot = Device::create ("chain");
+  GeometryLoaderPtr_t loader =
+    GeometryLoader::create (robot, "anchor", fileUri ("chain.urdf"),
+			    fileUri ("chain.srdf"), false);
+  BOOST_CHECK (!loader->ready ());
+  BOOST_CHECK_EQUAL (nbObjects (robot), 0);
+  loader->load ("joint_1");
+  BOOST_CHECK_EQUAL (nbObjects (robot), 1);
+  loader->wait ();
+  BOOST_CHECK (loader->ready ());
+  BOOST_CHECK_EQUAL (nbObjects (robot), nbLinks);
+  BOOST_CHECK (!robot->collisionPairs (hpp::model::COLLISION).empty ());
+  std::remove (path ("chain.urdf").c_str ());
+  std::remove (path ("chain.srdf").c_str ());
+}
+
+// The callback cannot wait for the thread calling it.
+BOOST_AUTO_TEST_CASE (wait_in_callback)
+{
+  writeUrdf ("sphere.obj");
+  DevicePtr_t robot = Device::create ("chain");
+  GeometryLoaderPtr_t loader =
+    GeometryLoader::create (robot, "anchor", fileUri ("chain.urdf"),
+			    fileUri ("chain.srdf"), true, callWait);
+  waitingLoader.set_value (loader.get ());
+  loader->wait ();
+  {
+    boost::mutex::scoped_lock lock (mutex);
+    BOOST_CHECK (waitRejected);
+  }
+  BOOST_CHECK_EQUAL (nbObjects (robot), nbLinks);
+  std::remove (path ("chain.urdf").c_str ());
+  std::remove (path ("chain.srdf").c_str ());
+}
+
+// An error raised by the background thread is rethrown by wait.
+BOOST_AUTO_TEST_CASE (error)
+{
+  writeUrdf ("missing.obj");
+  DevicePtr_t robot = Device::create ("chain");
+  GeometryLoaderPtr_t loader =
+    GeometryLoader::create (robot, "anchor", fileUri ("chain.urdf"),
+			    fileUri ("chain.srdf"), true);
+  BOOST_CHECK_THROW (loader->wait (), std::runtime_error);
+  BOOST_CHECK (loader->built ().has_exception ());
+  BOOST_CHECK (robot->collisionPairs (hpp::model::COLLISION).empty ());
+
+  // Without background thread, the future holds the error as well.
+  robot = Device::create ("chain");
+  loader = GeometryLoader::create (robot, "anchor", fileUri ("chain.urdf"),
+				   fileUri ("chain.srdf"), false);
+  BOOST_CHECK_THROW (loader->wait (), std::runtime_error);
+  BOOST_CHECK (loader->built ().has_exception ());
+  std::remove (path ("chain.urdf").c_str ());
+  std::remove (path ("chain.srdf").c_str ());
+  std::remove (path ("sphere.obj").c_str ());
+}
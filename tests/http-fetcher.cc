@@ -0,0 +1,434 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE http-fetcher
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "urdf/http-fetcher.hh"
+#include "urdf/resource.hh"
+
+using hpp::model::urdf::HttpFetcher;
+using hpp::model::urdf::Resource;
+using hpp::model::urdf::ResourcePrefetcher;
+using hpp::model::urdf::ResourceResolver_t;
+
+namespace
+{
+  const std::size_t nbMeshes = 32;
+  /// Time taken by the server to answer a request, in milliseconds.
+  const unsigned latency = 10;
+
+  /// Minimal HTTP/1.1 server keeping connections alive and answering
+  /// conditional requests.
+  class HttpServer
+  {
+  public:
+    HttpServer () : socket_ (::socket (AF_INET, SOCK_STREAM, 0)), port_ (0),
+		    connections_ (0), requests_ (0), notModified_ (0)
+    {
+      sockaddr_in address;
+      std::memset (&address, 0, sizeof (address));
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      socklen_t length = sizeof (address);
+      if (socket_ < 0 ||
+	  bind (socket_, (sockaddr*) &address, sizeof (address)) != 0 ||
+	  getsockname (socket_, (sockaddr*) &address, &length) != 0 ||
+	  listen (socket_, 64) != 0) {
+	throw std::runtime_error ("Failed to start http server");
+      }
+      port_ = ntohs (address.sin_port);
+      threads_.create_thread (boost::bind (&HttpServer::accept, this));
+    }
+
+    ~HttpServer ()
+    {
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	shutdown (socket_, SHUT_RDWR);
+	for (std::size_t i = 0; i < clients_.size (); ++i) {
+	  shutdown (clients_ [i], SHUT_RDWR);
+	}
+      }
+      threads_.join_all ();
+      close (socket_);
+    }
+
+    std::string url (const std::string& path) const
+    {
+      std::ostringstream url;
+      url << "http://127.0.0.1:" << port_ << path;
+      return url.str ();
+    }
+
+    /// Set content of a resource and change its ETag.
+    void set (const std::string& path, const std::string& content)
+    {
+      boost::mutex::scoped_lock lock (mutex_);
+      std::ostringstream etag;
+      etag << "\"" << path.size () << "-" << content.size () << "-"
+	   << ++version_ [path] << "\"";
+      resources_ [path] = std::make_pair (content, etag.str ());
+    }
+
+    std::size_t connections ()
+    {
+      boost::mutex::scoped_lock lock (mutex_);
+      return connections_;
+    }
+
+    std::size_t requests ()
+    {
+      boost::mutex::scoped_lock lock (mutex_);
+      return requests_;
+    }
+
+    std::size_t notModified ()
+    {
+      boost::mutex::scoped_lock lock (mutex_);
+      return notModified_;
+    }
+
+  private:
+    void accept ()
+    {
+      while (true) {
+	int client = ::accept (socket_, 0, 0);
+	if (client < 0) return;
+	boost::mutex::scoped_lock lock (mutex_);
+	clients_.push_back (client);
+	++connections_;
+	threads_.create_thread (boost::bind (&HttpServer::serve, this,
+					     client));
+      }
+    }
+
+    static std::string header (const std::string& request, const char* name)
+    {
+      std::size_t length = std::strlen (name);
+      for (std::size_t begin = request.find ("\r\n");
+	   begin != std::string::npos; begin = request.find ("\r\n", begin)) {
+	begin += 2;
+	if (strncasecmp (request.c_str () + begin, name, length) == 0) {
+	  std::size_t end = request.find ("\r\n", begin);
+	  std::size_t value = request.find_first_not_of (" ", begin + length);
+	  return request.substr (value, end - value);
+	}
+      }
+      return std::string ();
+    }
+
+    void serve (int client)
+    {
+      std::string buffer;
+      char data [4096];
+      while (true) {
+	std::size_t end = buffer.find ("\r\n\r\n");
+	if (end == std::string::npos) {
+	  ssize_t n = recv (client, data, sizeof (data), 0);
+	  if (n <= 0) break;
+	  buffer.append (data, n);
+	  continue;
+	}
+	std::string request = buffer.substr (0, end + 2);
+	buffer.erase (0, end + 4);
+	std::istringstream line (request);
+	std::string method, path;
+	line >> method >> path;
+	usleep (latency * 1000);
+
+	std::ostringstream response;
+	{
+	  boost::mutex::scoped_lock lock (mutex_);
+	  ++requests_;
+	  std::map <std::string, std::pair <std::string, std::string> >::
+	    const_iterator it = resources_.find (path);
+	  if (it == resources_.end ()) {
+	    response << "HTTP/1.1 404 Not Found\r\n"
+		     << "Content-Length: 0\r\n\r\n";
+	  } else if (header (request, "If-None-Match:") == it->second.second) {
+	    ++notModified_;
+	    response << "HTTP/1.1 304 Not Modified\r\n"
+		     << "ETag: " << it->second.second << "\r\n\r\n";
+	  } else {
+	    response << "HTTP/1.1 200 OK\r\n"
+		     << "ETag: " << it->second.second << "\r\n"
+		     << "Content-Length: " << it->second.first.size ()
+		     << "\r\n\r\n" << it->second.first;
+	  }
+	}
+	std::string bytes = response.str ();
+	for (std::size_t sent = 0; sent < bytes.size (); ) {
+	  ssize_t n = send (client, bytes.data () + sent,
+			    bytes.size () - sent, MSG_NOSIGNAL);
+	  if (n <= 0) return;
+	  sent += n;
+	}
+      }
+    }
+
+    int socket_;
+    unsigned short port_;
+    std::map <std::string, std::pair <std::string, std::string> >
+    resources_;
+    std::map <std::string, unsigned> version_;
+    std::vector <int> clients_;
+    std::size_t connections_;
+    std::size_t requests_;
+    std::size_t notModified_;
+    boost::mutex mutex_;
+    boost::thread_group threads_;
+  }; // class HttpServer
+
+  /// Server whose connections are queued by the system but never
+  /// answered.
+  class StalledServer
+  {
+  public:
+    StalledServer () : socket_ (::socket (AF_INET, SOCK_STREAM, 0)),
+		       port_ (0)
+    {
+      sockaddr_in address;
+      std::memset (&address, 0, sizeof (address));
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      socklen_t length = sizeof (address);
+      if (socket_ < 0 ||
+	  bind (socket_, (sockaddr*) &address, sizeof (address)) != 0 ||
+	  getsockname (socket_, (sockaddr*) &address, &length) != 0 ||
+	  listen (socket_, 64) != 0) {
+	throw std::runtime_error ("Failed to start http server");
+      }
+      port_ = ntohs (address.sin_port);
+    }
+
+    ~StalledServer ()
+    {
+      close (socket_);
+    }
+
+    std::string url (const std::string& path) const
+    {
+      std::ostringstream url;
+      url << "http://127.0.0.1:" << port_ << path;
+      return url.str ();
+    }
+
+  private:
+    int socket_;
+    unsigned short port_;
+  }; // class StalledServer
+
+  typedef std::map <std::string, std::string> Contents_t;
+
+  bool store (const std::string& uri, const Resource& resource,
+	      const std::string& error, Contents_t& contents)
+  {
+    BOOST_CHECK_MESSAGE (error.empty (), error);
+    contents [uri].assign (reinterpret_cast <const char*> (resource.data ()),
+			   resource.size ());
+    return true;
+  }
+
+  double now ()
+  {
+    timeval time;
+    gettimeofday (&time, 0);
+    return time.tv_sec + 1e-6 * time.tv_usec;
+  }
+
+  /// Stop function returning true once a time is reached.
+  struct Deadline
+  {
+    explicit Deadline (double time) : time (time)
+    {}
+
+    bool operator() () const
+    {
+      return now () > time;
+    }
+
+    double time;
+  }; // struct Deadline
+
+  /// Fetch a resource until a deadline.
+  void fetchUntil (HttpFetcher& fetcher, const std::string& uri,
+		   double deadline)
+  {
+    Contents_t contents;
+    fetcher.fetch (std::vector <std::string> (1, uri),
+		   boost::bind (&store, _1, _2, _3, boost::ref (contents)),
+		   Deadline (deadline));
+  }
+
+  std::string meshName (std::size_t i)
+  {
+    std::ostringstream name;
+    name << "/meshes/link_" << i << ".stl";
+    return name.str ();
+  }
+
+  std::string meshContent (std::size_t i, char fill)
+  {
+    return std::string (16384 + 1024 * i, char (fill + i % 16));
+  }
+} // end of anonymous namespace.
+
+// Fetch meshes from a local server, then revalidate them against the
+// cache.
+BOOST_AUTO_TEST_CASE (http_fetcher)
+{
+  HttpServer server;
+  std::vector <std::string> uris;
+  for (std::size_t i = 0; i < nbMeshes; ++i) {
+    server.set (meshName (i), meshContent (i, 'a'));
+    uris.push_back (server.url (meshName (i)));
+  }
+  char directory [] = "/tmp/hpp-model-urdf-http-XXXXXX";
+  BOOST_REQUIRE (mkdtemp (directory));
+  const std::size_t maxConnections = 4;
+
+  {
+    HttpFetcher fetcher (directory, maxConnections);
+    Contents_t contents;
+    double start = now ();
+    fetcher.fetch (uris, boost::bind (&store, _1, _2, _3,
+				      boost::ref (contents)));
+    double fetchTime = now () - start;
+    BOOST_CHECK_EQUAL (contents.size (), nbMeshes);
+    for (std::size_t i = 0; i < nbMeshes; ++i) {
+      BOOST_CHECK (contents [uris [i]] == meshContent (i, 'a'));
+    }
+    BOOST_CHECK_EQUAL (fetcher.statistics ().requests, nbMeshes);
+    BOOST_CHECK_EQUAL (fetcher.statistics ().notModified, 0u);
+    BOOST_CHECK (server.connections () <= maxConnections);
+
+    // Connections are kept open, cached meshes are not sent again.
+    std::size_t connections = server.connections ();
+    contents.clear ();
+    start = now ();
+    fetcher.fetch (uris, boost::bind (&store, _1, _2, _3,
+				      boost::ref (contents)));
+    double revalidateTime = now () - start;
+    for (std::size_t i = 0; i < nbMeshes; ++i) {
+      BOOST_CHECK (contents [uris [i]] == meshContent (i, 'a'));
+    }
+    BOOST_CHECK_EQUAL (server.connections (), connections);
+    BOOST_CHECK_EQUAL (server.notModified (), nbMeshes);
+    BOOST_CHECK_EQUAL (fetcher.statistics ().notModified, nbMeshes);
+
+    // Modified meshes are sent again.
+    server.set (meshName (0), meshContent (0, 'A'));
+    Resource resource = fetcher.fetch (uris [0]);
+    BOOST_CHECK (std::string (reinterpret_cast <const char*>
+			      (resource.data ()), resource.size ()) ==
+		 meshContent (0, 'A'));
+    BOOST_CHECK_EQUAL (server.notModified (), nbMeshes);
+    BOOST_CHECK_THROW (fetcher.fetch (server.url ("/missing.stl")),
+		       std::runtime_error);
+    BOOST_CHECK_EQUAL (server.connections (), connections);
+
+    std::cout << nbMeshes << " meshes, " << latency << " ms latency, "
+	      << connections << " connections: fetched in " << fetchTime
+	      << " s, revalidated in " << revalidateTime << " s" << std::endl;
+  }
+
+  // Sequential requests over a single connection, for comparison.
+  {
+    HttpFetcher fetcher (std::string (), 1);
+    Contents_t contents;
+    double start = now ();
+    for (std::size_t i = 0; i < nbMeshes; ++i) {
+      Resource resource = fetcher.fetch (uris [i]);
+      contents [uris [i]].assign (reinterpret_cast <const char*>
+				  (resource.data ()), resource.size ());
+    }
+    std::cout << "Sequential requests: " << now () - start << " s, "
+	      << fetcher.statistics ().connections << " connections"
+	      << std::endl;
+    BOOST_CHECK_EQUAL (fetcher.statistics ().connections, 1u);
+    BOOST_CHECK (contents [uris [1]] == meshContent (1, 'a'));
+  }
+
+  std::system ((std::string ("rm -rf ") + directory).c_str ());
+}
+
+// Transfers to a server that does not answer are aborted on request.
+BOOST_AUTO_TEST_CASE (stop)
+{
+  StalledServer server;
+  std::vector <std::string> uris;
+  uris.push_back (server.url ("/meshes/a.stl"));
+  uris.push_back (server.url ("/meshes/b.stl"));
+
+  HttpFetcher fetcher ((std::string ()));
+  Contents_t contents;
+  double start = now ();
+  fetcher.fetch (uris, boost::bind (&store, _1, _2, _3,
+				    boost::ref (contents)),
+		 Deadline (start + 0.2));
+  BOOST_CHECK (now () - start < 2);
+  BOOST_CHECK (contents.empty ());
+
+  // Destroying a prefetcher aborts its pending transfers.
+  setenv ("HPP_MODEL_URDF_HTTP_CACHE", "", 1);
+  start = now ();
+  {
+    ResourcePrefetcher prefetcher (uris, ResourceResolver_t ());
+    boost::this_thread::sleep (boost::posix_time::milliseconds (200));
+  }
+  BOOST_CHECK (now () - start < 2);
+}
+
+// A call waiting for a stalled server does not delay calls of other
+// threads.
+BOOST_AUTO_TEST_CASE (concurrent_calls)
+{
+  StalledServer stalled;
+  HttpServer server;
+  server.set (meshName (0), meshContent (0, 'a'));
+  HttpFetcher fetcher ((std::string ()));
+  double start = now ();
+  boost::thread thread (boost::bind (&fetchUntil, boost::ref (fetcher),
+				     stalled.url (meshName (0)), start + 2));
+  boost::this_thread::sleep (boost::posix_time::milliseconds (100));
+  Resource resource = fetcher.fetch (server.url (meshName (0)));
+  BOOST_CHECK (now () - start < 1);
+  BOOST_CHECK_EQUAL (resource.size (), meshContent (0, 'a').size ());
+  thread.join ();
+}
@@ -0,0 +1,293 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE mesh-reader
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "urdf/mesh.hh"
+#include "test-utils.hh"
+
+using hpp::model::urdf::MeshBuffers;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+
+namespace
+{
+  const std::size_t nbLatitudes = 200;
+  const std::size_t nbLongitudes = 400;
+  const std::size_t nbLoads = 5;
+
+  /// Unit sphere made of triangles at the poles and quads elsewhere.
+  struct Sphere
+  {
+    std::vector <float> vertices;
+    std::vector <std::vector <std::size_t> > faces;
+
+    Sphere ()
+    {
+      const double pi = std::acos (-1.);
+      addVertex (0, 0, 1);
+      for (std::size_t i = 1; i < nbLatitudes; ++i) {
+	double theta = pi * i / nbLatitudes;
+	for (std::size_t j = 0; j < nbLongitudes; ++j) {
+	  double phi = 2 * pi * j / nbLongitudes;
+	  addVertex (std::sin (theta) * std::cos (phi),
+		     std::sin (theta) * std::sin (phi), std::cos (theta));
+	}
+      }
+      addVertex (0, 0, -1);
+      const std::size_t south = vertices.size () / 3 - 1;
+      for (std::size_t j = 0; j < nbLongitudes; ++j) {
+	std::size_t next = (j + 1) % nbLongitudes;
+	addFace (0, 1 + j, 1 + next);
+	for (std::size_t i = 1; i + 1 < nbLatitudes; ++i) {
+	  std::size_t ring = 1 + (i - 1) * nbLongitudes;
+	  addFace (ring + j, ring + nbLongitudes + j,
+		   ring + nbLongitudes + next, ring + next);
+	}
+	std::size_t ring = 1 + (nbLatitudes - 2) * nbLongitudes;
+	addFace (south, ring + next, ring + j);
+      }
+    }
+
+    void addVertex (double x, double y, double z)
+    {
+      vertices.push_back (float (x));
+      vertices.push_back (float (y));
+      vertices.push_back (float (z));
+    }
+
+    void addFace (std::size_t a, std::size_t b, std::size_t c,
+		  std::size_t d = std::size_t (-1))
+    {
+      std::vector <std::size_t> face;
+      face.push_back (a); face.push_back (b); face.push_back (c);
+      if (d != std::size_t (-1)) face.push_back (d);
+      faces.push_back (face);
+    }
+
+    /// Faces split in triangles.
+    std::vector <std::vector <std::size_t> > triangles () const
+    {
+      std::vector <std::vector <std::size_t> > result;
+      for (std::size_t f = 0; f < faces.size (); ++f) {
+	for (std::size_t k = 2; k < faces [f].size (); ++k) {
+	  std::vector <std::size_t> triangle;
+	  triangle.push_back (faces [f][0]);
+	  triangle.push_back (faces [f][k - 1]);
+	  triangle.push_back (faces [f][k]);
+	  result.push_back (triangle);
+	}
+      }
+      return result;
+    }
+  }; // struct Sphere
+
+  FILE* open (const std::string& name)
+  {
+    FILE* file = std::fopen (path (name).c_str (), "wb");
+    if (!file) throw std::runtime_error ("Failed to create " + name);
+    return file;
+  }
+
+  void writeUint32 (uint32_t value, FILE* file)
+  {
+    unsigned char bytes [4] = {
+      (unsigned char) value, (unsigned char) (value >> 8),
+      (unsigned char) (value >> 16), (unsigned char) (value >> 24)
+    };
+    std::fwrite (bytes, 1, 4, file);
+  }
+
+  /// \param title start of the header,
+  /// \param padding number of bytes written after the last facet.
+  void writeBinaryStl (const Sphere& sphere, const std::string& name,
+		       const char* title = "binary sphere",
+		       std::size_t padding = 0)
+  {
+    std::vector <std::vector <std::size_t> > triangles = sphere.triangles ();
+    FILE* file = open (name);
+    char header [80] = { 0 };
+    std::strncpy (header, title, sizeof (header) - 1);
+    std::fwrite (header, 1, sizeof (header), file);
+    writeUint32 (triangles.size (), file);
+    const float normal [3] = { 0, 0, 0 };
+    const uint16_t attribute = 0;
+    for (std::size_t t = 0; t < triangles.size (); ++t) {
+      std::fwrite (normal, sizeof (float), 3, file);
+      for (std::size_t k = 0; k < 3; ++k) {
+	std::fwrite (&sphere.vertices [3 * triangles [t][k]], sizeof (float), 3,
+		     file);
+      }
+      std::fwrite (&attribute, sizeof (attribute), 1, file);
+    }
+    for (std::size_t i = 0; i < padding; ++i) std::fputc (0, file);
+    std::fclose (file);
+  }
+
+  void writeAsciiStl (const Sphere& sphere, const std::string& name)
+  {
+    std::vector <std::vector <std::size_t> > triangles = sphere.triangles ();
+    FILE* file = open (name);
+    std::fprintf (file, "solid sphere\n");
+    for (std::size_t t = 0; t < triangles.size (); ++t) {
+      std::fprintf (file, "facet normal 0 0 0\n outer loop\n");
+      for (std::size_t k = 0; k < 3; ++k) {
+	const float* v = &sphere.vertices [3 * triangles [t][k]];
+	std::fprintf (file, "  vertex %.9g %.9g %.9g\n", v [0], v [1], v [2]);
+      }
+      std::fprintf (file, " endloop\nendfacet\n");
+    }
+    std::fprintf (file, "endsolid sphere\n");
+    std::fclose (file);
+  }
+
+  void writeObj (const Sphere& sphere, const std::string& name)
+  {
+    FILE* file = open (name);
+    std::fprintf (file, "# sphere\no sphere\n");
+    for (std::size_t i = 0; i < sphere.vertices.size (); i += 3) {
+      std::fprintf (file, "v %.9g %.9g %.9g\n", sphere.vertices [i],
+		    sphere.vertices [i + 1], sphere.vertices [i + 2]);
+    }
+    for (std::size_t f = 0; f < sphere.faces.size (); ++f) {
+      std::fprintf (file, "f");
+      for (std::size_t k = 0; k < sphere.faces [f].size (); ++k) {
+	std::fprintf (file, " %lu//", (unsigned long) sphere.faces [f][k] + 1);
+      }
+      std::fprintf (file, "\n");
+    }
+    std::fclose (file);
+  }
+
+  /// Average time to load a mesh in seconds.
+  double load (const std::string& uri, bool native,
+	       Parser::MeshStatistics& statistics)
+  {
+    ::urdf::Vector3 scale (1, 1, 1);
+    MeshBuffers mesh;
+    std::clock_t start = std::clock ();
+    for (std::size_t i = 0; i < nbLoads; ++i) {
+      hpp::model::urdf::loadMesh (uri, scale, 1e-6, native, mesh,
+				  statistics);
+    }
+    return double (std::clock () - start) / CLOCKS_PER_SEC / nbLoads;
+  }
+} // end of anonymous namespace.
+
+// Compare built-in readers and assimp on the same sphere written in each
+// supported format.
+BOOST_AUTO_TEST_CASE (mesh_reader)
+{
+  Sphere sphere;
+  const std::size_t nbVertices = sphere.vertices.size () / 3;
+  const std::size_t nbTriangles = sphere.triangles ().size ();
+  const char* files [] = { "sphere-binary.stl", "sphere-ascii.stl",
+			   "sphere.obj" };
+  writeBinaryStl (sphere, files [0]);
+  writeAsciiStl (sphere, files [1]);
+  writeObj (sphere, files [2]);
+
+  for (std::size_t i = 0; i < sizeof (files) / sizeof (files [0]); ++i) {
+    std::string uri = fileUri (files [i]);
+    Parser::MeshStatistics native, assimp;
+    double nativeTime = load (uri, true, native);
+    double assimpTime = load (uri, false, assimp);
+    std::cout << files [i] << ": native " << nativeTime * 1e3 << " ms, "
+	      << "assimp " << assimpTime * 1e3 << " ms, "
+	      << native.originalVertices << " -> " << native.vertices
+	      << " vertices, " << native.originalTriangles << " -> "
+	      << native.triangles << " triangles" << std::endl;
+    BOOST_CHECK_EQUAL (native.vertices, nbVertices);
+    BOOST_CHECK_EQUAL (native.triangles, nbTriangles);
+    BOOST_CHECK_EQUAL (native.vertices, assimp.vertices);
+    BOOST_CHECK_EQUAL (native.triangles, assimp.triangles);
+  }
+}
+
+// Read binary STL files whose header starts with "solid" or that have
+// bytes after the last facet.
+BOOST_AUTO_TEST_CASE (binary_stl_variants)
+{
+  Sphere sphere;
+  const std::size_t nbTriangles = sphere.triangles ().size ();
+  writeBinaryStl (sphere, "sphere-solid.stl", "solid sphere", 16);
+  Parser::MeshStatistics statistics;
+  load (fileUri ("sphere-solid.stl"), true, statistics);
+  BOOST_CHECK_EQUAL (statistics.originalTriangles, nbTriangles);
+  BOOST_CHECK_EQUAL (statistics.triangles, nbTriangles);
+  std::remove (path ("sphere-solid.stl").c_str ());
+}
+
+// Weld coincident vertices, remove degenerate and duplicate triangles,
+// keep reversed twins.
+BOOST_AUTO_TEST_CASE (weld_mesh)
+{
+  MeshBuffers mesh;
+  mesh.vertices.push_back (fcl::Vec3f (0, 0, 0));
+  mesh.vertices.push_back (fcl::Vec3f (1, 0, 0));
+  mesh.vertices.push_back (fcl::Vec3f (1, 1, 0));
+  mesh.vertices.push_back (fcl::Vec3f (0, 1, 0));
+  // Coincident with vertex 1.
+  mesh.vertices.push_back (fcl::Vec3f (1 + 1e-8, 0, 0));
+  // Aligned with vertices 0 and 1.
+  mesh.vertices.push_back (fcl::Vec3f (2, 0, 0));
+  // Unused.
+  mesh.vertices.push_back (fcl::Vec3f (5, 5, 5));
+
+  mesh.triangles.push_back (fcl::Triangle (0, 1, 2));
+  mesh.triangles.push_back (fcl::Triangle (0, 2, 3));
+  // Rotation of the first triangle once welded.
+  mesh.triangles.push_back (fcl::Triangle (4, 2, 0));
+  // Reversed twin of the first triangle.
+  mesh.triangles.push_back (fcl::Triangle (2, 1, 0));
+  // Two identical indices once welded.
+  mesh.triangles.push_back (fcl::Triangle (0, 1, 4));
+  // Zero area.
+  mesh.triangles.push_back (fcl::Triangle (0, 1, 5));
+
+  hpp::model::urdf::weldMesh (mesh, 1e-6);
+  BOOST_CHECK_EQUAL (mesh.vertices.size (), 4);
+  BOOST_REQUIRE_EQUAL (mesh.triangles.size (), 3);
+  std::size_t up = 0, down = 0;
+  for (std::size_t i = 0; i < mesh.triangles.size (); ++i) {
+    const fcl::Triangle& t = mesh.triangles [i];
+    BOOST_REQUIRE (t [0] < mesh.vertices.size () &&
+		   t [1] < mesh.vertices.size () &&
+		   t [2] < mesh.vertices.size ());
+    double z = (mesh.vertices [t [1]] - mesh.vertices [t [0]]).cross
+      (mesh.vertices [t [2]] - mesh.vertices [t [0]]) [2];
+    if (z > 0) ++up;
+    if (z < 0) ++down;
+  }
+  BOOST_CHECK_EQUAL (up, 2);
+  BOOST_CHECK_EQUAL (down, 1);
+}
@@ -0,0 +1,322 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE mesh-split
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/fcl/collision.h>
+#include <hpp/fcl/shape/geometric_shapes.h>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+
+#include "urdf/mesh.hh"
+#include "test-utils.hh"
+
+using hpp::model::CollisionObjectPtr_t;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::urdf::MeshChunks_t;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  /// Number of vertices along each side of the terrain.
+  const std::size_t gridSize = 501;
+  const std::size_t nbChunks = 16;
+  const std::size_t nbQueries = 500;
+
+  /// Height field over [-1, 1]^2, two triangles per cell.
+  struct Terrain
+  {
+    std::vector <fcl::Vec3f> vertices;
+    std::vector <fcl::Triangle> triangles;
+
+    Terrain ()
+    {
+      for (std::size_t i = 0; i < gridSize; ++i) {
+	for (std::size_t j = 0; j < gridSize; ++j) {
+	  double x = 2. * i / (gridSize - 1) - 1;
+	  double y = 2. * j / (gridSize - 1) - 1;
+	  vertices.push_back (fcl::Vec3f (x, y, 0.05 * std::sin (7 * x) *
+					  std::cos (5 * y)));
+	}
+      }
+      for (std::size_t i = 0; i + 1 < gridSize; ++i) {
+	for (std::size_t j = 0; j + 1 < gridSize; ++j) {
+	  std::size_t v = i * gridSize + j;
+	  triangles.push_back (fcl::Triangle (v, v + 1, v + gridSize));
+	  triangles.push_back (fcl::Triangle (v + 1, v + gridSize + 1,
+					      v + gridSize));
+	}
+      }
+    }
+  }; // struct Terrain
+
+  void writeObj (const Terrain& terrain, const std::string& name)
+  {
+    FILE* file = std::fopen (path (name).c_str (), "wb");
+    if (!file) throw std::runtime_error ("Failed to create " + name);
+    std::fprintf (file, "o terrain\n");
+    for (std::size_t i = 0; i < terrain.vertices.size (); ++i) {
+      const fcl::Vec3f& v = terrain.vertices [i];
+      std::fprintf (file, "v %.9g %.9g %.9g\n", v [0], v [1], v [2]);
+    }
+    for (std::size_t i = 0; i < terrain.triangles.size (); ++i) {
+      const fcl::Triangle& t = terrain.triangles [i];
+      std::fprintf (file, "f %lu %lu %lu\n", (unsigned long) t [0] + 1,
+		    (unsigned long) t [1] + 1, (unsigned long) t [2] + 1);
+    }
+    std::fclose (file);
+  }
+
+  /// Octahedron of 8 triangles whose vertices are at distance size
+  /// from the origin.
+  std::string octahedron (const char* size)
+  {
+    std::ostringstream obj;
+    obj << "v " << size << " 0 0\nv -" << size << " 0 0\n"
+	<< "v 0 " << size << " 0\nv 0 -" << size << " 0\n"
+	<< "v 0 0 " << size << "\nv 0 0 -" << size << "\n"
+	<< "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+	<< "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+    return obj.str ();
+  }
+
+  double now ()
+  {
+    timeval time;
+    gettimeofday (&time, 0);
+    return time.tv_sec + 1e-6 * time.tv_usec;
+  }
+
+  /// Pseudo random number in [lower, upper).
+  double random (double lower, double upper, unsigned long& state)
+  {
+    state = state * 6364136223846793005UL + 1442695040888963407UL;
+    return lower + (upper - lower) * double (state >> 11) /
+      double (1UL << 53);
+  }
+
+  bool collide (const fcl::CollisionObject& o1, const fcl::CollisionObject& o2)
+  {
+    fcl::CollisionRequest request;
+    fcl::CollisionResult result;
+    fcl::collide (&o1, &o2, request, result);
+    return result.isCollision ();
+  }
+} // end of anonymous namespace.
+
+// Build the hierarchy of a large mesh in one piece and in chunks on an
+// increasing number of threads, then check that collision checks give
+// the same results.
+BOOST_AUTO_TEST_CASE (mesh_split)
+{
+  Terrain terrain;
+  double start = now ();
+  fcl::CollisionGeometryPtr_t whole = hpp::model::urdf::createPolyhedron
+    (fcl::BV_OBBRSS, terrain.vertices, terrain.triangles);
+  double wholeTime = now () - start;
+
+  start = now ();
+  MeshChunks_t chunks;
+  hpp::model::urdf::splitMesh (terrain.vertices, terrain.triangles,
+			       nbChunks, chunks);
+  double splitTime = now () - start;
+  BOOST_REQUIRE_EQUAL (chunks.size (), nbChunks);
+  std::size_t nbTriangles = 0;
+  for (std::size_t i = 0; i < chunks.size (); ++i) {
+    nbTriangles += chunks [i].triangles.size ();
+  }
+  BOOST_CHECK_EQUAL (nbTriangles, terrain.triangles.size ());
+
+  std::cout << terrain.triangles.size () << " triangles: whole mesh "
+	    << wholeTime << " s, split in " << nbChunks << " chunks "
+	    << splitTime << " s" << std::endl;
+  std::vector <fcl::CollisionGeometryPtr_t> geometries;
+  for (std::size_t nbThreads = 1; nbThreads <= 8; nbThreads *= 2) {
+    start = now ();
+    geometries = hpp::model::urdf::createPolyhedra (fcl::BV_OBBRSS, chunks,
+						    nbThreads);
+    std::cout << nbThreads << " threads: " << now () - start << " s"
+	      << std::endl;
+  }
+  BOOST_REQUIRE_EQUAL (geometries.size (), nbChunks);
+
+  // Boxes of random size, position and orientation around the terrain.
+  fcl::CollisionObject wholeObject (whole, fcl::Transform3f ());
+  std::vector <fcl::CollisionObject*> chunkObjects;
+  BOOST_FOREACH (const fcl::CollisionGeometryPtr_t& geometry, geometries) {
+    chunkObjects.push_back (new fcl::CollisionObject (geometry,
+						      fcl::Transform3f ()));
+  }
+  unsigned long state = 1;
+  std::size_t nbCollisions = 0;
+  for (std::size_t i = 0; i < nbQueries; ++i) {
+    fcl::CollisionGeometryPtr_t box
+      (new fcl::Box (random (0.01, 0.2, state), random (0.01, 0.2, state),
+		     random (0.01, 0.2, state)));
+    double q [4];
+    double norm = 0;
+    for (std::size_t k = 0; k < 4; ++k) {
+      q [k] = random (-1, 1, state);
+      norm += q [k] * q [k];
+    }
+    norm = std::sqrt (norm);
+    fcl::Quaternion3f rotation (q [0] / norm, q [1] / norm, q [2] / norm,
+				q [3] / norm);
+    fcl::Vec3f position (random (-1.1, 1.1, state),
+			 random (-1.1, 1.1, state),
+			 random (-0.2, 0.2, state));
+    fcl::CollisionObject object (box, fcl::Transform3f (rotation, position));
+
+    bool expected = collide (wholeObject, object);
+    bool found = false;
+    BOOST_FOREACH (const fcl::CollisionObject* chunk, chunkObjects) {
+      found = found || collide (*chunk, object);
+    }
+    BOOST_CHECK_EQUAL (found, expected);
+    if (expected) ++nbCollisions;
+  }
+  BOOST_FOREACH (fcl::CollisionObject* chunk, chunkObjects) delete chunk;
+  std::cout << nbCollisions << " collisions out of " << nbQueries
+	    << " queries" << std::endl;
+  BOOST_CHECK (nbCollisions > 0 && nbCollisions < nbQueries);
+}
+
+// Split a mesh loaded by the parser into one collision object per chunk.
+BOOST_AUTO_TEST_CASE (parser_split)
+{
+  Terrain terrain;
+  writeObj (terrain, "terrain.obj");
+  std::ostringstream urdf;
+  urdf << "<robot name=\"terrain\">\n"
+       << "<link name=\"terrain\">\n"
+       << " <collision>\n"
+       << "  <geometry><mesh filename=\"" << fileUri ("terrain.obj")
+       << "\"/></geometry>\n"
+       << " </collision>\n"
+       << "</link>\n"
+       << "</robot>\n";
+
+  DevicePtr_t robot = Device::create ("terrain");
+  Parser parser ("anchor", robot);
+  const std::size_t maxTriangles = terrain.triangles.size () / nbChunks + 1;
+  parser.splitMeshes (maxTriangles);
+  BOOST_CHECK_EQUAL (parser.splitMeshes (), maxTriangles);
+  double start = now ();
+  parser.parseString (urdf.str ());
+  std::cout << "Parsed terrain in " << now () - start << " s" << std::endl;
+
+  std::size_t nbObjects = 0;
+  std::size_t nbTriangles = 0;
+  BOOST_FOREACH (const JointPtr_t& joint, robot->getJointVector ()) {
+    if (!joint->linkedBody ()) continue;
+    BOOST_FOREACH (const CollisionObjectPtr_t& object,
+		   joint->linkedBody ()->innerObjects (hpp::model::COLLISION)) {
+      std::ostringstream name;
+      name << "terrain_" << nbObjects++;
+      BOOST_CHECK_EQUAL (object->name (), name.str ());
+      nbTriangles += static_cast <const Parser::PolyhedronType*>
+	(object->fcl ()->collisionGeometry ().get ())->num_tris;
+    }
+  }
+  BOOST_CHECK_EQUAL (nbObjects, nbChunks);
+  BOOST_CHECK_EQUAL (nbTriangles, terrain.triangles.size ());
+}
+
+// Updating a split mesh refills the objects created for its chunks only.
+BOOST_AUTO_TEST_CASE (parser_split_update)
+{
+  writeFile ("split.obj", octahedron ("0.1"));
+  std::ostringstream urdf;
+  urdf << "<robot name=\"split\">\n"
+       << "<link name=\"split\">\n"
+       << " <collision>\n"
+       << "  <geometry><mesh filename=\"" << fileUri ("split.obj")
+       << "\"/></geometry>\n"
+       << " </collision>\n"
+       << "</link>\n"
+       << "</robot>\n";
+  writeFile ("split.urdf", urdf.str ());
+
+  DevicePtr_t robot = Device::create ("split");
+  Parser parser ("anchor", robot);
+  parser.splitMeshes (2);
+  parser.parse (fileUri ("split.urdf"));
+  hpp::model::Body* body = robot->rootJoint ()->linkedBody ();
+  BOOST_REQUIRE (body);
+  const std::size_t nbObjects =
+    body->innerObjects (hpp::model::COLLISION).size ();
+  BOOST_REQUIRE (nbObjects > 1);
+
+  // An object added afterwards is named like a chunk.
+  fcl::CollisionGeometryPtr_t box (new fcl::Box (1, 1, 1));
+  std::ostringstream name;
+  name << "split_" << nbObjects;
+  body->addInnerObject (hpp::model::CollisionObject::create
+			(box, fcl::Transform3f (), name.str ()), true, true);
+
+  writeFile ("split.obj", octahedron ("0.25"));
+  std::vector <std::string> changed = parser.update (fileUri ("split.urdf"));
+  BOOST_REQUIRE_EQUAL (changed.size (), 1);
+  BOOST_CHECK_EQUAL (changed.front (), "split");
+
+  std::size_t index = 0, nbTriangles = 0;
+  BOOST_FOREACH (const CollisionObjectPtr_t& object,
+		 body->innerObjects (hpp::model::COLLISION)) {
+    const fcl::CollisionGeometry* geometry =
+      object->fcl ()->collisionGeometry ().get ();
+    if (index++ == nbObjects) {
+      BOOST_CHECK (geometry == box.get ());
+      BOOST_CHECK_EQUAL (static_cast <const fcl::Box*> (geometry)->side [0],
+			 1);
+      continue;
+    }
+    const Parser::PolyhedronType* model =
+      static_cast <const Parser::PolyhedronType*> (geometry);
+    nbTriangles += model->num_tris;
+    for (int i = 0; i < model->num_vertices; ++i) {
+      const fcl::Vec3f& v = model->vertices [i];
+      BOOST_CHECK_CLOSE (std::fabs (v [0]) + std::fabs (v [1]) +
+			 std::fabs (v [2]), 0.25, 1e-6);
+    }
+  }
+  BOOST_CHECK_EQUAL (index, nbObjects + 1);
+  BOOST_CHECK_EQUAL (nbTriangles, 8);
+  std::remove (path ("split.obj").c_str ());
+  std::remove (path ("split.urdf").c_str ());
+}
@@ -0,0 +1,344 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE pair-cost
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/srdf/parser.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "test-utils.hh"
+
+using hpp::model::CollisionPair_t;
+using hpp::model::CollisionPairs_t;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::vector_t;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+typedef hpp::model::srdf::Parser SrdfParser;
+
+namespace
+{
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  /// Box base, mesh arm above it and box cart sliding along x.
+  std::string urdfDescription ()
+  {
+    return std::string
+      ("<robot name=\"cart\">\n"
+       "<link name=\"base_link\">\n"
+       " <collision><geometry><box size=\"0.2 0.2 0.2\"/></geometry>"
+       "</collision>\n"
+       "</link>\n"
+       "<joint name=\"shoulder\" type=\"revolute\">\n"
+       " <parent link=\"base_link\"/><child link=\"arm\"/>\n"
+       " <origin xyz=\"0 0 1\"/><axis xyz=\"1 0 0\"/>\n"
+       " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+       "</joint>\n"
+       "<link name=\"arm\">\n"
+       " <collision><geometry><mesh filename=\"") + fileUri ("arm.obj") +
+      "\"/></geometry></collision>\n"
+      "</link>\n"
+      "<joint name=\"slide\" type=\"prismatic\">\n"
+      " <parent link=\"base_link\"/><child link=\"cart\"/>\n"
+      " <origin xyz=\"3 0 0\"/><axis xyz=\"1 0 0\"/>\n"
+      " <limit lower=\"-10\" upper=\"10\" effort=\"1\" velocity=\"1\"/>\n"
+      "</joint>\n"
+      "<link name=\"cart\">\n"
+      " <collision><geometry><box size=\"0.2 0.2 0.2\"/></geometry>"
+      "</collision>\n"
+      "</link>\n"
+      "</robot>\n";
+  }
+
+  /// Robot of urdfDescription with a hand carrying a second mesh and a
+  /// camera without collision geometry.
+  std::string cameraUrdfDescription ()
+  {
+    std::string description = urdfDescription ();
+    description.erase (description.rfind ("</robot>"));
+    return description +
+      "<joint name=\"wrist\" type=\"revolute\">\n"
+      " <parent link=\"arm\"/><child link=\"hand\"/>\n"
+      " <origin xyz=\"0 0 0.5\"/><axis xyz=\"1 0 0\"/>\n"
+      " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+      "</joint>\n"
+      "<link name=\"hand\">\n"
+      " <collision><geometry><mesh filename=\"" + fileUri ("arm.obj") +
+      "\"/></geometry></collision>\n"
+      "</link>\n"
+      "<joint name=\"pan\" type=\"revolute\">\n"
+      " <parent link=\"base_link\"/><child link=\"camera\"/>\n"
+      " <origin xyz=\"0 0 0.5\"/><axis xyz=\"0 0 1\"/>\n"
+      " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+      "</joint>\n"
+      "<link name=\"camera\">\n"
+      " <inertial><mass value=\"0.1\"/>"
+      "<inertia ixx=\"0.001\" ixy=\"0\" ixz=\"0\" iyy=\"0.001\" iyz=\"0\""
+      " izz=\"0.001\"/></inertial>\n"
+      "</link>\n"
+      "</robot>\n";
+  }
+
+  const char* srdfDescription = "<robot name=\"cart\"/>\n";
+
+  /// Description where the base and the cart are not paired.
+  const char* disabledSrdfDescription =
+    "<robot name=\"cart\">\n"
+    " <disable_collisions link1=\"base_link\" link2=\"cart\"/>\n"
+    "</robot>\n";
+
+  /// Load the robot and add its collision pairs in the given order.
+  DevicePtr_t load (SrdfParser& srdfParser, SrdfParser::PairOrder order,
+		    double slide = 0)
+  {
+    DevicePtr_t robot = Device::create ("cart");
+    hpp::model::urdf::Parser parser ("anchor", robot);
+    parser.parseString (urdfDescription ());
+    // The configuration is changed without computing forward
+    // kinematics.
+    vector_t q = robot->currentConfiguration ();
+    q [robot->getJointByName ("slide")->rankInConfiguration ()] = slide;
+    robot->currentConfiguration (q);
+    srdfParser.pairOrder (order);
+    srdfParser.parseString (urdfDescription (), srdfDescription, robot);
+    return robot;
+  }
+
+  bool sameJoints (const SrdfParser::PairCost& cost,
+		   const CollisionPair_t& pair)
+  {
+    JointPtr_t joint1 = pair.first->joint ();
+    JointPtr_t joint2 = pair.second->joint ();
+    return (joint1 == cost.joint1 && joint2 == cost.joint2) ||
+      (joint1 == cost.joint2 && joint2 == cost.joint1);
+  }
+
+  /// Check that pairs are added to the robot in the order of the costs.
+  void checkRobotOrder (const SrdfParser& srdfParser,
+			const DevicePtr_t& robot)
+  {
+    const SrdfParser::PairCosts_t& costs = srdfParser.pairCosts ();
+    const CollisionPairs_t& pairs =
+      robot->collisionPairs (hpp::model::COLLISION);
+    BOOST_REQUIRE_EQUAL (pairs.size (), costs.size ());
+    std::size_t i = 0;
+    for (CollisionPairs_t::const_iterator it = pairs.begin ();
+	 it != pairs.end (); ++it, ++i) {
+      BOOST_CHECK (sameJoints (costs [i], *it));
+    }
+  }
+
+  const SrdfParser::PairCost& find (const SrdfParser& srdfParser,
+				    const DevicePtr_t& robot,
+				    const std::string& name1,
+				    const std::string& name2)
+  {
+    JointPtr_t joint1 = name1 == "anchor" ?
+      robot->rootJoint () : robot->getJointByName (name1);
+    JointPtr_t joint2 = robot->getJointByName (name2);
+    const SrdfParser::PairCosts_t& costs = srdfParser.pairCosts ();
+    for (std::size_t i = 0; i < costs.size (); ++i) {
+      if ((costs [i].joint1 == joint1 && costs [i].joint2 == joint2) ||
+	  (costs [i].joint1 == joint2 && costs [i].joint2 == joint1)) {
+	return costs [i];
+      }
+    }
+    throw std::runtime_error ("No pair " + name1 + ", " + name2);
+  }
+} // end of anonymous namespace.
+
+// Costs of the pairs and the orders in which they are added.
+BOOST_AUTO_TEST_CASE (pair_costs)
+{
+  writeFile ("arm.obj", octahedron);
+
+  // Pairs follow the joint vector by default.
+  SrdfParser srdfParser;
+  BOOST_CHECK_EQUAL (srdfParser.pairOrder (), SrdfParser::JOINT_ORDER);
+  DevicePtr_t robot = load (srdfParser, SrdfParser::JOINT_ORDER);
+  const SrdfParser::PairCosts_t& costs = srdfParser.pairCosts ();
+  BOOST_REQUIRE_EQUAL (costs.size (), 3);
+  checkRobotOrder (srdfParser, robot);
+
+  const SrdfParser::PairCost& baseArm =
+    find (srdfParser, robot, "anchor", "shoulder");
+  BOOST_CHECK_EQUAL (baseArm.triangles, 8);
+  BOOST_CHECK_EQUAL (baseArm.primitives, 1);
+  BOOST_CHECK (baseArm.depth > 0);
+  BOOST_CHECK_EQUAL (baseArm.cost, baseArm.depth + 1);
+  const SrdfParser::PairCost& baseCart =
+    find (srdfParser, robot, "anchor", "slide");
+  BOOST_CHECK_EQUAL (baseCart.triangles, 0);
+  BOOST_CHECK_EQUAL (baseCart.primitives, 2);
+  BOOST_CHECK_EQUAL (baseCart.depth, 0);
+  BOOST_CHECK_EQUAL (baseCart.cost, 2);
+  // Bounding spheres of the base and the cart, 3 apart, have a radius
+  // of sqrt (3) / 10.
+  BOOST_CHECK_CLOSE (baseCart.clearance, 3 - 0.2 * std::sqrt (3.), 1e-6);
+  BOOST_CHECK (baseArm.clearance > 0);
+  BOOST_CHECK (baseArm.clearance < baseCart.clearance);
+  const SrdfParser::PairCost& armCart =
+    find (srdfParser, robot, "shoulder", "slide");
+  BOOST_CHECK (armCart.clearance > baseCart.clearance);
+
+  // Cheapest pairs first.
+  robot = load (srdfParser, SrdfParser::CHEAPEST_FIRST);
+  BOOST_REQUIRE_EQUAL (costs.size (), 3);
+  checkRobotOrder (srdfParser, robot);
+  for (std::size_t i = 1; i < costs.size (); ++i) {
+    BOOST_CHECK (costs [i - 1].cost <= costs [i].cost);
+  }
+  BOOST_CHECK_EQUAL (costs.front ().primitives, 2);
+
+  // Closest pairs first.
+  robot = load (srdfParser, SrdfParser::CLOSEST_FIRST);
+  BOOST_REQUIRE_EQUAL (costs.size (), 3);
+  checkRobotOrder (srdfParser, robot);
+  for (std::size_t i = 1; i < costs.size (); ++i) {
+    BOOST_CHECK (costs [i - 1].clearance <= costs [i].clearance);
+  }
+  BOOST_CHECK_EQUAL (costs.front ().triangles, 8);
+
+  // Clearances are estimated at the current configuration, where the
+  // cart overlaps the base.
+  robot = load (srdfParser, SrdfParser::CLOSEST_FIRST, -3);
+  checkRobotOrder (srdfParser, robot);
+  const SrdfParser::PairCost& overlap =
+    find (srdfParser, robot, "anchor", "slide");
+  BOOST_CHECK (overlap.clearance < 0);
+  BOOST_CHECK_EQUAL (costs.front ().clearance, overlap.clearance);
+
+  std::remove (path ("arm.obj").c_str ());
+}
+
+// Pairs enabled by an update take their place in the order of the
+// pairs.
+BOOST_AUTO_TEST_CASE (update_order)
+{
+  writeFile ("arm.obj", octahedron);
+  writeFile ("cart.urdf", urdfDescription ());
+  const SrdfParser::PairOrder orders [] = {
+    SrdfParser::JOINT_ORDER, SrdfParser::CLOSEST_FIRST
+  };
+  for (std::size_t i = 0; i < 2; ++i) {
+    writeFile ("cart.srdf", disabledSrdfDescription);
+    DevicePtr_t robot = Device::create ("cart");
+    hpp::model::urdf::Parser parser ("anchor", robot);
+    parser.parse (fileUri ("cart.urdf"));
+    SrdfParser srdfParser;
+    srdfParser.pairOrder (orders [i]);
+    srdfParser.parse (fileUri ("cart.urdf"), fileUri ("cart.srdf"), robot);
+    BOOST_CHECK_EQUAL (srdfParser.pairCosts ().size (), 2);
+    checkRobotOrder (srdfParser, robot);
+
+    writeFile ("cart.srdf", srdfDescription);
+    srdfParser.update (fileUri ("cart.urdf"), fileUri ("cart.srdf"));
+    const SrdfParser::PairCosts_t& costs = srdfParser.pairCosts ();
+    BOOST_REQUIRE_EQUAL (costs.size (), 3);
+    checkRobotOrder (srdfParser, robot);
+    const SrdfParser::PairCost& baseCart =
+      find (srdfParser, robot, "anchor", "slide");
+    BOOST_CHECK_EQUAL (baseCart.primitives, 2);
+    if (orders [i] == SrdfParser::JOINT_ORDER) {
+      // Joints are ordered as anchor, shoulder, slide.
+      BOOST_CHECK (costs [1].joint1 == baseCart.joint1 &&
+		   costs [1].joint2 == baseCart.joint2);
+    } else {
+      for (std::size_t j = 1; j < costs.size (); ++j) {
+	BOOST_CHECK (costs [j - 1].clearance <= costs [j].clearance);
+      }
+    }
+
+    writeFile ("cart.srdf", disabledSrdfDescription);
+    srdfParser.update (fileUri ("cart.urdf"), fileUri ("cart.srdf"));
+    BOOST_CHECK_EQUAL (srdfParser.pairCosts ().size (), 2);
+    checkRobotOrder (srdfParser, robot);
+  }
+  std::remove (path ("arm.obj").c_str ());
+  std::remove (path ("cart.urdf").c_str ());
+  std::remove (path ("cart.srdf").c_str ());
+}
+
+// Bodies without collision objects yield no pair, meshes of a load share
+// the same scratch buffers.
+BOOST_AUTO_TEST_CASE (empty_pairs)
+{
+  writeFile ("arm.obj", octahedron);
+
+  DevicePtr_t robot = Device::create ("cart");
+  hpp::model::urdf::Parser armParser ("anchor", robot);
+  armParser.parseString (urdfDescription ());
+  hpp::model::urdf::Parser::ScratchStatistics arm =
+    armParser.scratchStatistics ();
+  BOOST_CHECK_EQUAL (arm.meshes, 1);
+  BOOST_CHECK (arm.allocations > 0);
+  BOOST_CHECK (arm.peakBytes > 0);
+
+  robot = Device::create ("cart");
+  hpp::model::urdf::Parser parser ("anchor", robot);
+  parser.parseString (cameraUrdfDescription ());
+  // The hand mesh is as large as the arm mesh and is imported in the
+  // buffers of the arm mesh, without allocating.
+  hpp::model::urdf::Parser::ScratchStatistics scratch =
+    parser.scratchStatistics ();
+  BOOST_CHECK_EQUAL (scratch.meshes, 2);
+  BOOST_CHECK_EQUAL (scratch.allocations, arm.allocations);
+  BOOST_CHECK_EQUAL (scratch.peakBytes, arm.peakBytes);
+
+  // The camera has a body but no collision object. Its 4 pairs are not
+  // added, the 6 pairs of the other bodies are.
+  SrdfParser srdfParser;
+  srdfParser.parseString (cameraUrdfDescription (), srdfDescription, robot);
+  JointPtr_t camera = robot->getJointByName ("pan");
+  BOOST_REQUIRE (camera->linkedBody ());
+  BOOST_CHECK (camera->linkedBody ()->innerObjects
+	       (hpp::model::COLLISION).empty ());
+  const hpp::model::Request_t requests [] = {
+    hpp::model::COLLISION, hpp::model::DISTANCE
+  };
+  for (std::size_t i = 0; i < 2; ++i) {
+    BOOST_CHECK_EQUAL (srdfParser.emptyPairs (requests [i]), 4);
+    const CollisionPairs_t& pairs = robot->collisionPairs (requests [i]);
+    BOOST_CHECK_EQUAL (pairs.size (), 6);
+    for (CollisionPairs_t::const_iterator it = pairs.begin ();
+	 it != pairs.end (); ++it) {
+      BOOST_CHECK (it->first->joint () != camera);
+      BOOST_CHECK (it->second->joint () != camera);
+    }
+  }
+  std::remove (path ("arm.obj").c_str ());
+}
@@ -0,0 +1,209 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE parser-stream
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/parser.hh>
+
+using hpp::model::Body;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::ObjectVector_t;
+using hpp::model::Transform3f;
+using hpp::model::urdf::Parser;
+
+namespace
+{
+  /// Elements are out of order: joints and links come before their
+  /// parent. base_footprint_joint is not attached to the root link.
+  const char* description =
+    "<?xml version=\"1.0\"?>\n"
+    "<robot name=\"stream\">\n"
+    "<!-- <link name=\"commented\"/> -->\n"
+    "<joint name=\"wrist\" type=\"revolute\">\n"
+    " <parent link=\"arm\"/>\n"
+    " <child link=\"hand\"/>\n"
+    " <origin xyz=\"0 0 0.4\" rpy=\"0.3 0 0\"/>\n"
+    " <axis xyz=\"0 1 1\"/>\n"
+    " <limit lower=\"-1\" upper=\"2\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"hand\">\n"
+    " <inertial>\n"
+    "  <origin xyz=\"0.01 0.02 0.03\"/>\n"
+    "  <mass value=\"0.5\"/>\n"
+    "  <inertia ixx=\"1\" ixy=\"0\" ixz=\"0\" iyy=\"2\" iyz=\"0\""
+    " izz=\"3\"/>\n"
+    " </inertial>\n"
+    " <visual><geometry><box size=\"1 1 1\"/></geometry></visual>\n"
+    " <collision>\n"
+    "  <origin xyz=\"0 0.1 0\" rpy=\"0 0.2 0\"/>\n"
+    "  <geometry><box size=\"0.1 0.2 0.3\"/></geometry>\n"
+    " </collision>\n"
+    "</link>\n"
+    "<link name=\"world\"/>\n"
+    "<joint name=\"mount\" type=\"fixed\">\n"
+    " <parent link=\"world\"/>\n"
+    " <child link=\"base_footprint\"/>\n"
+    " <origin xyz=\"0 0 1\"/>\n"
+    "</joint>\n"
+    "<link name=\"base_footprint\"/>\n"
+    "<joint name=\"base_footprint_joint\" type=\"fixed\">\n"
+    " <parent link=\"base_footprint\"/>\n"
+    " <child link=\"base_link\"/>\n"
+    " <origin xyz=\"0.5 0 0\"/>\n"
+    "</joint>\n"
+    "<link name=\"base_link\">\n"
+    " <collision>\n"
+    "  <geometry><cylinder radius=\"0.2\" length=\"0.5\"/></geometry>\n"
+    " </collision>\n"
+    "</link>\n"
+    "<joint name=\"shoulder\" type=\"continuous\">\n"
+    " <parent link=\"base_link\"/>\n"
+    " <child link=\"upper_arm\"/>\n"
+    " <origin xyz=\"0 0.2 0.3\" rpy=\"0 0 1\"/>\n"
+    " <axis xyz=\"1 0 0\"/>\n"
+    "</joint>\n"
+    "<link name=\"upper_arm\">\n"
+    " <inertial>\n"
+    "  <origin xyz=\"0 0 0.2\"/>\n"
+    "  <mass value=\"2\"/>\n"
+    "  <inertia ixx=\"0.1\" ixy=\"0\" ixz=\"0\" iyy=\"0.1\" iyz=\"0\""
+    " izz=\"0.01\"/>\n"
+    " </inertial>\n"
+    "</link>\n"
+    "<joint name=\"elbow\" type=\"prismatic\">\n"
+    " <parent link=\"upper_arm\"/>\n"
+    " <child link=\"arm\"/>\n"
+    " <origin xyz=\"0 0 0.3\"/>\n"
+    " <axis xyz=\"0 0 1\"/>\n"
+    " <limit lower=\"0\" upper=\"0.2\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"arm\"/>\n"
+    "</robot>\n";
+
+  const double epsilon = 1e-12;
+
+  bool sameTransform (const Transform3f& t1, const Transform3f& t2)
+  {
+    if ((t1.getTranslation () - t2.getTranslation ()).length () > epsilon)
+      return false;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+	if (std::fabs (t1.getRotation () (i, j) - t2.getRotation () (i, j)) >
+	    epsilon) return false;
+      }
+    }
+    return true;
+  }
+
+  void checkSameBody (const Body* b1, const Body* b2)
+  {
+    BOOST_REQUIRE_EQUAL (!b1, !b2);
+    if (!b1) return;
+    BOOST_CHECK_EQUAL (b1->name (), b2->name ());
+    BOOST_CHECK_EQUAL (b1->mass (), b2->mass ());
+    BOOST_CHECK ((b1->localCenterOfMass () - b2->localCenterOfMass ()).
+		 length () < epsilon);
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+	BOOST_CHECK_CLOSE (b1->inertiaMatrix () (i, j) + 1,
+			   b2->inertiaMatrix () (i, j) + 1, 1e-10);
+      }
+    }
+    const ObjectVector_t& o1 = b1->innerObjects (hpp::model::COLLISION);
+    const ObjectVector_t& o2 = b2->innerObjects (hpp::model::COLLISION);
+    BOOST_REQUIRE_EQUAL (o1.size (), o2.size ());
+    ObjectVector_t::const_iterator it2 = o2.begin ();
+    for (ObjectVector_t::const_iterator it1 = o1.begin (); it1 != o1.end ();
+	 ++it1, ++it2) {
+      BOOST_CHECK_EQUAL ((*it1)->name (), (*it2)->name ());
+      BOOST_CHECK (sameTransform ((*it1)->positionInJointFrame (),
+				  (*it2)->positionInJointFrame ()));
+      BOOST_CHECK (sameTransform ((*it1)->getTransform (),
+				  (*it2)->getTransform ()));
+    }
+  }
+} // end of anonymous namespace.
+
+// Build the same robot with parse and parseStream.
+BOOST_AUTO_TEST_CASE (parser_stream)
+{
+  char directory [4096];
+  BOOST_REQUIRE (getcwd (directory, sizeof (directory)));
+  const std::string filename = std::string (directory) + "/stream.urdf";
+  FILE* file = std::fopen (filename.c_str (), "wb");
+  BOOST_REQUIRE (file);
+  std::fputs (description, file);
+  std::fclose (file);
+
+  DevicePtr_t parsed = Device::create ("parsed");
+  Parser parser ("freeflyer", parsed);
+  parser.parse ("file://" + filename);
+
+  DevicePtr_t streamed = Device::create ("streamed");
+  Parser streamParser ("freeflyer", streamed);
+  streamParser.parseStream ("file://" + filename);
+  std::remove (filename.c_str ());
+
+  BOOST_REQUIRE_EQUAL (parsed->getJointVector ().size (),
+		       streamed->getJointVector ().size ());
+  BOOST_CHECK_EQUAL (parsed->configSize (), streamed->configSize ());
+  BOOST_FOREACH (const JointPtr_t& joint, parsed->getJointVector ()) {
+    JointPtr_t other = streamed->getJointByName (joint->name ());
+    BOOST_REQUIRE_MESSAGE (other, "Missing joint " << joint->name ());
+    BOOST_CHECK_MESSAGE (sameTransform (joint->initialPosition (),
+					other->initialPosition ()),
+			 "Joint " << joint->name () << " moved");
+    BOOST_CHECK (sameTransform (joint->positionInParentFrame (),
+				other->positionInParentFrame ()));
+    BOOST_CHECK_EQUAL (joint->parentJoint () ?
+		       joint->parentJoint ()->name () : std::string (),
+		       other->parentJoint () ?
+		       other->parentJoint ()->name () : std::string ());
+    for (std::size_t k = 0; k < joint->configSize (); ++k) {
+      BOOST_CHECK_EQUAL (joint->isBounded (k), other->isBounded (k));
+      if (!joint->isBounded (k)) continue;
+      BOOST_CHECK_EQUAL (joint->lowerBound (k), other->lowerBound (k));
+      BOOST_CHECK_EQUAL (joint->upperBound (k), other->upperBound (k));
+    }
+    checkSameBody (joint->linkedBody (), other->linkedBody ());
+  }
+
+  // base_footprint_joint is the origin of the positions below it.
+  JointPtr_t shoulder = streamed->getJointByName ("shoulder");
+  BOOST_REQUIRE (shoulder);
+  BOOST_CHECK (std::fabs (shoulder->initialPosition ().getTranslation ()
+			  [2] - 0.3) < epsilon);
+  BOOST_CHECK_EQUAL (parser.topology ().size (),
+		     streamParser.topology ().size ());
+}
@@ -0,0 +1,247 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE resource-prefetcher
+
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/urdf/package.hh>
+#include <hpp/model/urdf/util.hh>
+
+#include "urdf/resource.hh"
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::urdf::Resource;
+using hpp::model::urdf::ResourceBlobs_t;
+using hpp::model::urdf::ResourcePrefetcher;
+using hpp::model::urdf::ResourceResolver_t;
+
+namespace
+{
+  /// Resolver serving blobs slowly and counting its calls.
+  struct SlowResolver
+  {
+    ResourceResolver_t blobs;
+    boost::shared_ptr <boost::mutex> mutex;
+    boost::shared_ptr <std::map <std::string, std::size_t> > calls;
+
+    explicit SlowResolver (const ResourceBlobs_t& content)
+      : blobs (hpp::model::urdf::blobResolver (content)),
+	mutex (new boost::mutex),
+	calls (new std::map <std::string, std::size_t>)
+    {}
+
+    bool operator() (const std::string& uri, std::string& content) const
+    {
+      {
+	boost::mutex::scoped_lock lock (*mutex);
+	++(*calls) [uri];
+      }
+      boost::this_thread::sleep (boost::posix_time::milliseconds (20));
+      return blobs (uri, content);
+    }
+
+    std::size_t count (const std::string& uri) const
+    {
+      boost::mutex::scoped_lock lock (*mutex);
+      std::map <std::string, std::size_t>::const_iterator it =
+	calls->find (uri);
+      return it == calls->end () ? 0 : it->second;
+    }
+  }; // struct SlowResolver
+
+  std::string content (const Resource& resource)
+  {
+    return std::string (reinterpret_cast <const char*> (resource.data ()),
+			resource.size ());
+  }
+
+  std::string currentDirectory ()
+  {
+    char directory [4096];
+    if (!getcwd (directory, sizeof (directory))) {
+      throw std::runtime_error ("Failed to get current directory");
+    }
+    return directory;
+  }
+
+  void writeFile (const std::string& path, const std::string& content)
+  {
+    FILE* file = std::fopen (path.c_str (), "wb");
+    if (!file) throw std::runtime_error ("Failed to write " + path);
+    std::fputs (content.c_str (), file);
+    std::fclose (file);
+  }
+
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  /// Chain of three links holding the same mesh.
+  const char* urdfDescription =
+    "<robot name=\"arm\">\n"
+    "<link name=\"base_link\">\n"
+    " <collision><geometry><mesh filename="
+    "\"package://arm_description/meshes/arm.obj\"/></geometry></collision>\n"
+    "</link>\n"
+    "<joint name=\"shoulder\" type=\"revolute\">\n"
+    " <parent link=\"base_link\"/><child link=\"upper_arm\"/>\n"
+    " <origin xyz=\"0 0 0.5\"/><axis xyz=\"1 0 0\"/>\n"
+    " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"upper_arm\">\n"
+    " <collision><geometry><mesh filename="
+    "\"package://arm_description/meshes/arm.obj\"/></geometry></collision>\n"
+    "</link>\n"
+    "<joint name=\"elbow\" type=\"revolute\">\n"
+    " <parent link=\"upper_arm\"/><child link=\"forearm\"/>\n"
+    " <origin xyz=\"0 0 0.5\"/><axis xyz=\"1 0 0\"/>\n"
+    " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+    "</joint>\n"
+    "<link name=\"forearm\">\n"
+    " <collision><geometry><mesh filename="
+    "\"package://arm_description/meshes/arm.obj\"/></geometry></collision>\n"
+    "</link>\n"
+    "</robot>\n";
+} // end of anonymous namespace.
+
+// Resources are fetched in the background and served once.
+BOOST_AUTO_TEST_CASE (prefetcher)
+{
+  ResourceBlobs_t blobs;
+  blobs ["blob://a"] = "first";
+  blobs ["blob://b"] = "second";
+  blobs ["blob://c"] = "not prefetched";
+  SlowResolver resolver (blobs);
+  std::vector <std::string> uris;
+  uris.push_back ("blob://a");
+  uris.push_back ("blob://b");
+  uris.push_back ("blob://missing");
+  boost::shared_ptr <ResourcePrefetcher> prefetcher
+    (new ResourcePrefetcher (uris, resolver));
+
+  // Getting a resource waits for it.
+  Resource resource;
+  BOOST_REQUIRE (prefetcher->get ("blob://a", resource));
+  BOOST_CHECK_EQUAL (content (resource), "first");
+  BOOST_REQUIRE (prefetcher->get ("blob://b", resource));
+  BOOST_CHECK_EQUAL (content (resource), "second");
+  BOOST_REQUIRE (prefetcher->get ("blob://a", resource));
+  BOOST_CHECK_EQUAL (resolver.count ("blob://a"), 1);
+  // Failed and unknown entries are not served.
+  BOOST_CHECK (!prefetcher->get ("blob://missing", resource));
+  BOOST_CHECK (!prefetcher->get ("blob://c", resource));
+  BOOST_CHECK_EQUAL (resolver.count ("blob://c"), 0);
+
+  // The prefetch resolver falls back to the resolver of the prefetcher.
+  ResourceResolver_t prefetch =
+    hpp::model::urdf::prefetchResolver (prefetcher);
+  std::string text;
+  BOOST_CHECK (prefetch ("blob://b", text));
+  BOOST_CHECK_EQUAL (text, "second");
+  BOOST_CHECK_EQUAL (resolver.count ("blob://b"), 1);
+  BOOST_CHECK (prefetch ("blob://c", text));
+  BOOST_CHECK_EQUAL (text, "not prefetched");
+  BOOST_CHECK_EQUAL (resolver.count ("blob://c"), 1);
+  BOOST_CHECK_EQUAL (content (hpp::model::urdf::retrieveResource
+			      ("blob://a", prefetch)), "first");
+  BOOST_CHECK_THROW (hpp::model::urdf::retrieveResource
+		     ("blob://missing", prefetch), std::exception);
+}
+
+// Destroying a prefetcher stops it without waiting for every resource.
+BOOST_AUTO_TEST_CASE (prefetcher_stop)
+{
+  ResourceBlobs_t blobs;
+  std::vector <std::string> uris;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    std::string uri = std::string ("blob://") + c;
+    blobs [uri] = uri;
+    uris.push_back (uri);
+  }
+  SlowResolver resolver (blobs);
+  {
+    ResourcePrefetcher prefetcher (uris, resolver);
+  }
+  std::size_t fetched = 0;
+  for (std::size_t i = 0; i < uris.size (); ++i)
+    fetched += resolver.count (uris [i]);
+  BOOST_CHECK (fetched < uris.size ());
+}
+
+// The SRDF file is parsed while the robot is built, collision pairs are
+// added once it is complete.
+BOOST_AUTO_TEST_CASE (concurrent_srdf)
+{
+  const std::string package = currentDirectory () + "/arm_description";
+  mkdir (package.c_str (), 0755);
+  mkdir ((package + "/urdf").c_str (), 0755);
+  mkdir ((package + "/srdf").c_str (), 0755);
+  mkdir ((package + "/meshes").c_str (), 0755);
+  writeFile (package + "/urdf/arm.urdf", urdfDescription);
+  writeFile (package + "/meshes/arm.obj", octahedron);
+  writeFile (package + "/srdf/arm.srdf",
+	     "<robot name=\"arm\">\n"
+	     " <disable_collisions link1=\"base_link\" link2=\"upper_arm\"/>\n"
+	     " <disable_collisions link1=\"upper_arm\" link2=\"forearm\"/>\n"
+	     "</robot>\n");
+  hpp::model::urdf::PackagePaths_t paths;
+  paths ["arm_description"] = package;
+  hpp::model::urdf::setPackagePaths (paths);
+
+  DevicePtr_t robot = Device::create ("arm");
+  hpp::model::urdf::loadRobotModel (robot, "anchor", "arm_description",
+				    "arm", "", "");
+  BOOST_CHECK_EQUAL (robot->collisionPairs (hpp::model::COLLISION).size (),
+		     1);
+
+  // Errors of the SRDF thread reach the caller.
+  DevicePtr_t broken = Device::create ("arm");
+  writeFile (package + "/srdf/arm-broken.srdf", "<robot name=\"arm\">\n");
+  BOOST_CHECK_THROW (hpp::model::urdf::loadRobotModel
+		     (broken, "anchor", "arm_description", "arm", "",
+		      "-broken"), std::exception);
+
+  hpp::model::urdf::setPackagePaths (hpp::model::urdf::PackagePaths_t ());
+  std::remove ((package + "/urdf/arm.urdf").c_str ());
+  std::remove ((package + "/meshes/arm.obj").c_str ());
+  std::remove ((package + "/srdf/arm.srdf").c_str ());
+  std::remove ((package + "/srdf/arm-broken.srdf").c_str ());
+  rmdir ((package + "/urdf").c_str ());
+  rmdir ((package + "/srdf").c_str ());
+  rmdir ((package + "/meshes").c_str ());
+  rmdir (package.c_str ());
+}
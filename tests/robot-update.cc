@@ -0,0 +1,334 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE robot-update
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/srdf/parser.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "test-utils.hh"
+
+using hpp::model::CollisionObjectPtr_t;
+using hpp::model::CollisionPair_t;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointPtr_t;
+using hpp::model::Transform3f;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  const double epsilon = 1e-12;
+
+  /// Parameters of the robot description.
+  struct Description
+  {
+    double shoulderZ;
+    double upperArmMass;
+    double elbowUpper;
+    double collisionZ;
+    std::string mesh;
+    bool extraLink;
+    /// Whether a tool is attached to the forearm by a floating joint.
+    bool tool;
+    double toolZ;
+
+    Description () : shoulderZ (0.3), upperArmMass (1), elbowUpper (1),
+		     collisionZ (0), mesh ("arm.obj"), extraLink (false),
+		     tool (false), toolZ (0.2)
+    {}
+  }; // struct Description
+
+  /// Tetrahedron, 4 triangles.
+  const char* tetrahedron =
+    "v 0 0 0\nv 0.1 0 0\nv 0 0.1 0\nv 0 0 0.1\n"
+    "f 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n";
+
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  void writeUrdf (const Description& d)
+  {
+    std::ostringstream urdf;
+    urdf << "<robot name=\"arm\">\n"
+	 << "<link name=\"base_footprint\"/>\n"
+	 << "<joint name=\"base_footprint_joint\" type=\"fixed\">\n"
+	 << " <parent link=\"base_footprint\"/>\n"
+	 << " <child link=\"base_link\"/>\n"
+	 << "</joint>\n"
+	 << "<link name=\"base_link\">\n"
+	 << " <collision>\n"
+	 << "  <geometry><box size=\"0.2 0.2 0.2\"/></geometry>\n"
+	 << " </collision>\n"
+	 << "</link>\n"
+	 << "<joint name=\"shoulder\" type=\"revolute\">\n"
+	 << " <parent link=\"base_link\"/>\n"
+	 << " <child link=\"upper_arm\"/>\n"
+	 << " <origin xyz=\"0 0 " << d.shoulderZ << "\"/>\n"
+	 << " <axis xyz=\"1 0 0\"/>\n"
+	 << " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+	 << "</joint>\n"
+	 << "<link name=\"upper_arm\">\n"
+	 << " <inertial>\n"
+	 << "  <mass value=\"" << d.upperArmMass << "\"/>\n"
+	 << "  <inertia ixx=\"0.1\" ixy=\"0\" ixz=\"0\" iyy=\"0.1\" iyz=\"0\""
+	 << " izz=\"0.1\"/>\n"
+	 << " </inertial>\n"
+	 << " <collision>\n"
+	 << "  <origin xyz=\"0 0 " << d.collisionZ << "\"/>\n"
+	 << "  <geometry><mesh filename=\"" << fileUri (d.mesh)
+	 << "\"/></geometry>\n"
+	 << " </collision>\n"
+	 << "</link>\n"
+	 << "<joint name=\"elbow\" type=\"revolute\">\n"
+	 << " <parent link=\"upper_arm\"/>\n"
+	 << " <child link=\"forearm\"/>\n"
+	 << " <origin xyz=\"0 0 0.4\"/>\n"
+	 << " <axis xyz=\"1 0 0\"/>\n"
+	 << " <limit lower=\"-1\" upper=\"" << d.elbowUpper
+	 << "\" effort=\"1\" velocity=\"1\"/>\n"
+	 << "</joint>\n"
+	 << "<link name=\"forearm\">\n"
+	 << " <collision>\n"
+	 << "  <geometry><box size=\"0.1 0.1 0.3\"/></geometry>\n"
+	 << " </collision>\n"
+	 << "</link>\n";
+    if (d.extraLink) {
+      urdf << "<joint name=\"wrist\" type=\"fixed\">\n"
+	   << " <parent link=\"forearm\"/>\n"
+	   << " <child link=\"hand\"/>\n"
+	   << "</joint>\n"
+	   << "<link name=\"hand\"/>\n";
+    }
+    if (d.tool) {
+      urdf << "<joint name=\"tool_joint\" type=\"floating\">\n"
+	   << " <parent link=\"forearm\"/>\n"
+	   << " <child link=\"tool\"/>\n"
+	   << " <origin xyz=\"0 0 " << d.toolZ << "\"/>\n"
+	   << "</joint>\n"
+	   << "<link name=\"tool\"/>\n";
+    }
+    urdf << "</robot>\n";
+    writeFile ("arm.urdf", urdf.str ());
+  }
+
+  void writeSrdf (bool disableForearm)
+  {
+    std::ostringstream srdf;
+    srdf << "<robot name=\"arm\">\n"
+	 << " <disable_collisions link1=\"base_link\" link2=\"upper_arm\"/>\n"
+	 << " <disable_collisions link1=\"upper_arm\" link2=\"forearm\"/>\n";
+    if (disableForearm) {
+      srdf << " <disable_collisions link1=\"base_link\""
+	   << " link2=\"forearm\"/>\n";
+    }
+    srdf << "</robot>\n";
+    writeFile ("arm.srdf", srdf.str ());
+  }
+
+  std::size_t triangles (const CollisionObjectPtr_t& object)
+  {
+    return static_cast <const Parser::PolyhedronType*>
+      (object->fcl ()->collisionGeometry ().get ())->num_tris;
+  }
+
+  CollisionObjectPtr_t object (const DevicePtr_t& robot,
+			       const std::string& joint)
+  {
+    return robot->getJointByName (joint)->linkedBody ()->
+      innerObjects (hpp::model::COLLISION).front ();
+  }
+
+  bool hasPair (const DevicePtr_t& robot, const std::string& name1,
+		const std::string& name2)
+  {
+    BOOST_FOREACH (const CollisionPair_t& pair,
+		   robot->collisionPairs (hpp::model::COLLISION)) {
+      const std::string& first = pair.first->name ();
+      const std::string& second = pair.second->name ();
+      if ((first == name1 && second == name2) ||
+	  (first == name2 && second == name1)) return true;
+    }
+    return false;
+  }
+
+  bool sameTransform (const Transform3f& t1, const Transform3f& t2)
+  {
+    if ((t1.getTranslation () - t2.getTranslation ()).length () > epsilon)
+      return false;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+	if (std::fabs (t1.getRotation () (i, j) - t2.getRotation () (i, j)) >
+	    epsilon) return false;
+      }
+    }
+    return true;
+  }
+} // end of anonymous namespace.
+
+// Update a robot from modified URDF and SRDF files.
+BOOST_AUTO_TEST_CASE (robot_update)
+{
+  writeFile ("arm.obj", tetrahedron);
+  Description description;
+  writeUrdf (description);
+  writeSrdf (true);
+
+  DevicePtr_t robot = Device::create ("arm");
+  Parser parser ("anchor", robot);
+  parser.parse (fileUri ("arm.urdf"));
+  hpp::model::srdf::Parser srdfParser;
+  srdfParser.parse (fileUri ("arm.urdf"), fileUri ("arm.srdf"), robot);
+
+  JointPtr_t shoulder = robot->getJointByName ("shoulder");
+  JointPtr_t elbow = robot->getJointByName ("elbow");
+  BOOST_REQUIRE (shoulder && elbow);
+  CollisionObjectPtr_t arm = object (robot, "shoulder");
+  BOOST_CHECK_EQUAL (triangles (arm), 4);
+  BOOST_CHECK (!hasPair (robot, "base_link", "forearm"));
+
+  // Nothing changed.
+  BOOST_CHECK (parser.update (fileUri ("arm.urdf")).empty ());
+
+  // Joint origin, bounds and mass.
+  description.shoulderZ = 0.5;
+  description.elbowUpper = 1.5;
+  description.upperArmMass = 2;
+  writeUrdf (description);
+  BOOST_CHECK (parser.update (fileUri ("arm.urdf")).empty ());
+  BOOST_CHECK (std::fabs (shoulder->positionInParentFrame ().
+			  getTranslation () [2] - 0.5) < epsilon);
+  BOOST_CHECK_EQUAL (elbow->upperBound (0), 1.5);
+  BOOST_CHECK_EQUAL (shoulder->linkedBody ()->mass (), 2);
+
+  // Collision origin. The shoulder axis is the x axis of the joint
+  // frame, so that the position in joint frame is the urdf origin.
+  description.collisionZ = 0.2;
+  writeUrdf (description);
+  std::vector <std::string> changed = parser.update (fileUri ("arm.urdf"));
+  BOOST_REQUIRE_EQUAL (changed.size (), 1);
+  BOOST_CHECK_EQUAL (changed [0], "upper_arm");
+  BOOST_CHECK_EQUAL (object (robot, "shoulder"), arm);
+  BOOST_CHECK (std::fabs (arm->positionInJointFrame ().getTranslation () [2]
+			  - 0.2) < epsilon);
+  BOOST_CHECK_EQUAL (triangles (arm), 4);
+
+  // Mesh modified under the same name.
+  writeFile ("arm.obj", octahedron);
+  changed = parser.update (fileUri ("arm.urdf"));
+  BOOST_REQUIRE_EQUAL (changed.size (), 1);
+  BOOST_CHECK_EQUAL (changed [0], "upper_arm");
+  BOOST_CHECK_EQUAL (triangles (arm), 8);
+
+  // A missing mesh leaves the robot unchanged.
+  const Transform3f shoulderPosition = shoulder->positionInParentFrame ();
+  Description missing = description;
+  missing.shoulderZ = 0.7;
+  missing.mesh = "missing.obj";
+  writeUrdf (missing);
+  BOOST_CHECK_THROW (parser.update (fileUri ("arm.urdf")),
+		     std::runtime_error);
+  BOOST_CHECK (sameTransform (shoulder->positionInParentFrame (),
+			      shoulderPosition));
+  BOOST_CHECK_EQUAL (triangles (arm), 8);
+
+  // Structural changes are rejected.
+  Description extended = description;
+  extended.extraLink = true;
+  writeUrdf (extended);
+  BOOST_CHECK_THROW (parser.update (fileUri ("arm.urdf")),
+		     std::runtime_error);
+
+  // Collision pairs.
+  writeUrdf (description);
+  BOOST_CHECK (parser.update (fileUri ("arm.urdf")).empty ());
+  std::size_t nbPairs = robot->collisionPairs (hpp::model::COLLISION).size ();
+  writeSrdf (false);
+  srdfParser.update (fileUri ("arm.urdf"), fileUri ("arm.srdf"));
+  BOOST_CHECK (hasPair (robot, "base_link", "forearm"));
+  BOOST_CHECK_EQUAL (robot->collisionPairs (hpp::model::COLLISION).size (),
+		     nbPairs + 1);
+  writeSrdf (true);
+  srdfParser.update (fileUri ("arm.urdf"), fileUri ("arm.srdf"));
+  BOOST_CHECK (!hasPair (robot, "base_link", "forearm"));
+  BOOST_CHECK_EQUAL (robot->collisionPairs (hpp::model::COLLISION).size (),
+		     nbPairs);
+
+  std::remove (path ("arm.obj").c_str ());
+  std::remove (path ("arm.urdf").c_str ());
+  std::remove (path ("arm.srdf").c_str ());
+}
+
+// Floating joints of the description are resolved before the robot is
+// modified.
+BOOST_AUTO_TEST_CASE (floating_joint_update)
+{
+  writeFile ("arm.obj", tetrahedron);
+  Description description;
+  description.tool = true;
+  writeUrdf (description);
+
+  DevicePtr_t robot = Device::create ("arm");
+  Parser parser ("anchor", robot);
+  parser.parse (fileUri ("arm.urdf"));
+  JointPtr_t shoulder = robot->getJointByName ("shoulder");
+  BOOST_REQUIRE (shoulder);
+
+  // Other joints are updated.
+  description.shoulderZ = 0.5;
+  writeUrdf (description);
+  BOOST_CHECK (parser.update (fileUri ("arm.urdf")).empty ());
+  BOOST_CHECK (std::fabs (shoulder->positionInParentFrame ().
+			  getTranslation () [2] - 0.5) < epsilon);
+
+  // Moving the floating joint is rejected before anything is modified.
+  const Transform3f shoulderPosition = shoulder->positionInParentFrame ();
+  Description moved = description;
+  moved.shoulderZ = 0.7;
+  moved.toolZ = 0.3;
+  writeUrdf (moved);
+  BOOST_CHECK_THROW (parser.update (fileUri ("arm.urdf")),
+		     std::runtime_error);
+  BOOST_CHECK (sameTransform (shoulder->positionInParentFrame (),
+			      shoulderPosition));
+  writeUrdf (description);
+  BOOST_CHECK (parser.update (fileUri ("arm.urdf")).empty ());
+
+  std::remove (path ("arm.obj").c_str ());
+  std::remove (path ("arm.urdf").c_str ());
+}
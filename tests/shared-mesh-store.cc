@@ -0,0 +1,181 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE shared-mesh-store
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/fcl/BV/BV.h>
+#include <hpp/fcl/BVH/BVH_model.h>
+
+#include <hpp/model/device.hh>
+#include <hpp/model/urdf/memory-footprint.hh>
+#include <hpp/model/urdf/parser.hh>
+
+#include "urdf/shared-mesh-store.hh"
+#include "test-utils.hh"
+
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::urdf::MemoryFootprint;
+using hpp::model::urdf::Parser;
+using hpp::model::urdf::SharedMesh;
+using hpp::model::urdf::SharedMeshStore;
+using hpp::model::urdf::test::fileUri;
+using hpp::model::urdf::test::path;
+using hpp::model::urdf::test::writeFile;
+
+namespace
+{
+  /// Octahedron, 8 triangles.
+  const char* octahedron =
+    "v 0.1 0 0\nv -0.1 0 0\nv 0 0.1 0\nv 0 -0.1 0\nv 0 0 0.1\nv 0 0 -0.1\n"
+    "f 1 3 5\nf 3 2 5\nf 2 4 5\nf 4 1 5\n"
+    "f 3 1 6\nf 2 3 6\nf 4 2 6\nf 1 4 6\n";
+
+  /// Tetrahedron, 4 triangles.
+  const char* tetrahedron =
+    "v 0 0 0\nv 0.1 0 0\nv 0 0.1 0\nv 0 0 0.1\n"
+    "f 1 3 2\nf 1 2 4\nf 2 3 4\nf 3 1 4\n";
+
+  /// Segment name unique to the process.
+  std::string segmentName ()
+  {
+    std::ostringstream name;
+    name << "hpp-model-urdf-test-" << getpid ();
+    return name.str ();
+  }
+
+  /// Two links holding the same mesh.
+  std::string urdfDescription ()
+  {
+    std::string mesh = " <collision><geometry><mesh filename=\"" +
+      fileUri ("shared.obj") + "\"/></geometry></collision>\n";
+    return "<robot name=\"shared\">\n"
+      "<link name=\"base_link\">\n" + mesh + "</link>\n"
+      "<joint name=\"shoulder\" type=\"revolute\">\n"
+      " <parent link=\"base_link\"/><child link=\"arm\"/>\n"
+      " <origin xyz=\"0 0 1\"/><axis xyz=\"1 0 0\"/>\n"
+      " <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+      "</joint>\n"
+      "<link name=\"arm\">\n" + mesh + "</link>\n"
+      "</robot>\n";
+  }
+
+  MemoryFootprint load (const std::string& segment)
+  {
+    DevicePtr_t robot = Device::create ("shared");
+    Parser parser ("anchor", robot);
+    parser.sharedMeshStore (segment, 1 << 20);
+    parser.parseString (urdfDescription ());
+    return hpp::model::urdf::memoryFootprint (robot);
+  }
+} // end of anonymous namespace.
+
+// Meshes stored by one store are found by another one.
+BOOST_AUTO_TEST_CASE (store)
+{
+  const std::string name = segmentName ();
+  SharedMeshStore::remove (name);
+  std::vector <fcl::Vec3f> vertices;
+  vertices.push_back (fcl::Vec3f (0, 0, 0));
+  vertices.push_back (fcl::Vec3f (1, 0, 0));
+  vertices.push_back (fcl::Vec3f (0, 1, 0));
+  vertices.push_back (fcl::Vec3f (0, 0, 1));
+  std::vector <fcl::Triangle> triangles;
+  triangles.push_back (fcl::Triangle (0, 2, 1));
+  triangles.push_back (fcl::Triangle (0, 1, 3));
+  triangles.push_back (fcl::Triangle (1, 2, 3));
+  triangles.push_back (fcl::Triangle (2, 0, 3));
+
+  SharedMeshStore first (name, 1 << 20);
+  first.insert ("mesh", vertices, triangles);
+
+  boost::shared_ptr <SharedMeshStore> second
+    (new SharedMeshStore (name, 1 << 20));
+  SharedMesh mesh;
+  BOOST_CHECK (!second->find ("other", mesh));
+  BOOST_REQUIRE (second->find ("mesh", mesh));
+  BOOST_REQUIRE_EQUAL (mesh.nbVertices, vertices.size ());
+  BOOST_REQUIRE_EQUAL (mesh.nbTriangles, triangles.size ());
+  for (std::size_t i = 0; i < vertices.size (); ++i) {
+    BOOST_CHECK (mesh.vertices [i].equal (vertices [i]));
+  }
+  for (std::size_t i = 0; i < triangles.size (); ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      BOOST_CHECK_EQUAL (mesh.triangles [i][j], triangles [i][j]);
+    }
+  }
+  // Inserting again returns the stored mesh.
+  SharedMesh again = second->insert ("mesh", vertices, triangles);
+  BOOST_CHECK (again.vertices == mesh.vertices);
+
+  // Polyhedra read vertices from the segment until they are detached.
+  fcl::CollisionGeometryPtr_t geometry =
+    hpp::model::urdf::createSharedPolyhedron (fcl::BV_OBBRSS, second, mesh);
+  const fcl::BVHModel <fcl::OBBRSS>* model =
+    static_cast <const fcl::BVHModel <fcl::OBBRSS>*> (geometry.get ());
+  BOOST_CHECK_EQUAL (model->num_tris, 4);
+  BOOST_CHECK (model->getNumBVs () > 0);
+  BOOST_CHECK (model->vertices == mesh.vertices);
+  SharedMesh mapped;
+  BOOST_CHECK (hpp::model::urdf::sharedPolyhedronMesh (model, mapped));
+  BOOST_CHECK (mapped.vertices == mesh.vertices);
+
+  hpp::model::urdf::detachSharedPolyhedron (geometry);
+  BOOST_CHECK (model->vertices != mesh.vertices);
+  BOOST_CHECK (model->vertices [1].equal (vertices [1]));
+  BOOST_CHECK (!hpp::model::urdf::sharedPolyhedronMesh (model, mapped));
+
+  BOOST_CHECK (SharedMeshStore::remove (name));
+}
+
+// Shared meshes are reported apart and modified files are stored again.
+BOOST_AUTO_TEST_CASE (parser)
+{
+  const std::string name = segmentName ();
+  SharedMeshStore::remove (name);
+  writeFile ("shared.obj", octahedron);
+
+  MemoryFootprint footprint = load (name);
+  BOOST_CHECK_EQUAL (footprint.geometries.size (), 2);
+  BOOST_CHECK (footprint.geometries.front ().sharedMesh);
+  BOOST_CHECK_EQUAL (footprint.geometries.front ().vertexBytes, 0);
+  BOOST_CHECK (footprint.geometries.front ().sharedMeshBytes > 0);
+  // Both links map the same mesh, which is counted once.
+  BOOST_CHECK_EQUAL (footprint.sharedTriangles, 8);
+  BOOST_CHECK_EQUAL (footprint.sharedVertices, 6);
+  BOOST_CHECK_EQUAL (footprint.triangles, 0);
+  BOOST_CHECK_EQUAL (footprint.vertices, 0);
+
+  // Another parser maps the stored mesh, until the file changes.
+  BOOST_CHECK_EQUAL (load (name).sharedTriangles, 8);
+  writeFile ("shared.obj", tetrahedron);
+  footprint = load (name);
+  BOOST_CHECK_EQUAL (footprint.sharedTriangles, 4);
+
+  std::remove (path ("shared.obj").c_str ());
+  BOOST_CHECK (SharedMeshStore::remove (name));
+}
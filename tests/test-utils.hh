@@ -0,0 +1,110 @@
+// Copyright (C) 2014 CNRS-LAAS
+//
+// This file is part of the hpp-model-urdf.
+//
+// hpp-model-urdf is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// hpp-model-urdf is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with hpp-model-urdf.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/// \file tests/test-utils.hh
+///
+/// \brief Files written by the tests.
+
+#ifndef HPP_MODEL_URDF_TEST_UTILS
+# define HPP_MODEL_URDF_TEST_UTILS
+
+# include <cstdio>
+# include <cstdlib>
+# include <stdexcept>
+# include <string>
+
+# include <stdlib.h>
+
+namespace hpp
+{
+  namespace model
+  {
+    namespace urdf
+    {
+      namespace test
+      {
+	/// \brief Temporary directory removed with its content on
+	/// destruction.
+	class TemporaryDirectory
+	{
+	public:
+	  TemporaryDirectory ()
+	  {
+	    char directory [] = "/tmp/hpp-model-urdf-XXXXXX";
+	    if (!mkdtemp (directory)) {
+	      throw std::runtime_error
+		("Failed to create a temporary directory");
+	    }
+	    path_ = directory;
+	  }
+
+	  ~TemporaryDirectory ()
+	  {
+	    std::system ((std::string ("rm -rf ") + path_).c_str ());
+	  }
+
+	  const std::string& path () const
+	  {
+	    return path_;
+	  }
+
+	private:
+	  TemporaryDirectory (const TemporaryDirectory&);
+	  TemporaryDirectory& operator= (const TemporaryDirectory&);
+
+	  std::string path_;
+	}; // class TemporaryDirectory
+
+	/// \brief Directory of the files written by a test program.
+	///
+	/// Each program gets its own directory, so that tests run
+	/// concurrently do not overwrite each other's files. The directory
+	/// is created on first use and removed at exit.
+	inline const std::string& directory ()
+	{
+	  static TemporaryDirectory directory;
+	  return directory.path ();
+	}
+
+	/// Path of a file of the test directory.
+	inline std::string path (const std::string& name)
+	{
+	  return directory () + "/" + name;
+	}
+
+	/// file:// uri of a file of the test directory.
+	inline std::string fileUri (const std::string& name)
+	{
+	  return "file://" + path (name);
+	}
+
+	/// Write a file of the test directory.
+	inline void writeFile (const std::string& name,
+			       const std::string& content)
+	{
+	  FILE* file = std::fopen (path (name).c_str (), "wb");
+	  if (!file) throw std::runtime_error ("Failed to write " + name);
+	  std::fwrite (content.data (), 1, content.size (), file);
+	  std::fclose (file);
+	}
+      } // end of namespace test.
+    } // end of namespace urdf.
+  } // end of namespace model.
+} // end of namespace hpp.
+
+#endif // HPP_MODEL_URDF_TEST_UTILS